@@ -62,6 +62,9 @@ typedef enum {
 	AD9959_CHANNEL_3 = 0x80,
 } AD9559_Channel;
 
+#define AD9959_CHANNEL_ALL	0xF0
+#define AD9959_CHANNEL_COUNT	4
+
 #define ASK_MOD 0x400000
 #define FSK_MOD 0x800000
 #define PSK_MOD 0xc00000
@@ -71,12 +74,33 @@ typedef enum {
 #define LEVEL_4  0x0000100
 #define LEVEL_2  0x0000000
 
+//CFR 位定义
+#define CFR_DAC_FULL_SCALE		0x000300
+#define CFR_AUTOCLEAR_PHASE		0x000004
+
+typedef enum {
+	AD9959_MOD_NONE = 0,
+	AD9959_MOD_ASK = ASK_MOD,
+	AD9959_MOD_FSK = FSK_MOD,
+	AD9959_MOD_PSK = PSK_MOD,
+} AD9959_Modulation;
+
 void AD9959_Init(void);
 void AD9959_Reset(void);
 void AD9959_SetFreq(uint8_t channel, uint32_t freq);
 void AD9959_SetPhase(uint8_t channel, float phase);
 void AD9959_SetAmp(uint8_t channel, uint16_t amp);
 
+//多通道缓冲配置: 先暂存各通道寄存器, 再用一次IO_UPDATE同时生效
+void AD9959_StageFreq(uint8_t channels, uint32_t freq);
+void AD9959_StagePhase(uint8_t channels, float phase);
+void AD9959_StageAmp(uint8_t channels, uint16_t amp);
+void AD9959_StagePhaseGroup(uint8_t channels, float phase, float step);
+void AD9959_StageModulation(uint8_t channels, AD9959_Modulation mod, float value);
+void AD9959_Commit(void);
+void AD9959_CommitCoherent(void);
+void AD9959_SetProfilePins(uint8_t channels);
+
 //void AD9959_SingleOutput(uint8_t channel, uint32_t freq, float phase, uint16_t amp);
 
 void AD9959_SweepFreq(
@@ -85,4 +109,5 @@ void AD9959_SweepFreq(
 	uint16_t timeStep);
 
 static void WriteReg(uint8_t reg, uint32_t data);
+static void WriteStagedRegs(void);
 static inline void AD9959_Update(void);
\ No newline at end of file
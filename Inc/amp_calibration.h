@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file       amp_calibration.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.2
+  * @brief      Output amplitude calibration store for PE4302 + AD9959 chain
+  *
+  * @note       Each band holds one calibrated {attenuation, DDS code} pair per
+  *             2mV level from 100mV down to 4mV, measured at the band's centre
+  *             frequency. Lookups interpolate the chain gain across levels and
+  *             between neighbouring bands, so any amplitude at any frequency
+  *             maps to a code. Tables are persisted in W25Qxx flash with a
+  *             CRC-protected header and loaded into RAM by AmpCal_Init().
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define AMP_CAL_FLASH_ADDR          0x1F0000U       //Last 64KB block of W25Q16
+#define AMP_CAL_MAGIC               0x4C414341U     //"ACAL"
+#define AMP_CAL_VERSION             1
+
+#define AMP_CAL_MAX_BANDS           8
+#define AMP_CAL_LEVEL_COUNT         49
+#define AMP_CAL_MAX_LEVEL           100             //mV, level 0
+#define AMP_CAL_LEVEL_STEP          2               //mV between levels
+
+/* Entries pack attenuation (0.5dB units, 6 bits) and DDS code (10 bits) */
+#define AMP_CAL_ENTRY(ATT, CODE)    ((uint16_t)(((ATT) << 10) | ((CODE) & 0x3FF)))
+#define AMP_CAL_ENTRY_ATT(E)        ((uint8_t)((E) >> 10))
+#define AMP_CAL_ENTRY_CODE(E)       ((uint16_t)((E) & 0x3FF))
+
+#define AMP_CAL_HEADER_SIZE         16
+#define AMP_CAL_BAND_SIZE           (4 + 2 * AMP_CAL_LEVEL_COUNT)
+#define AMP_CAL_IMAGE_MAX_SIZE      (AMP_CAL_HEADER_SIZE + AMP_CAL_MAX_BANDS * AMP_CAL_BAND_SIZE)
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Frequency;                         //Band centre frequency (kHz)
+    uint16_t Entries[AMP_CAL_LEVEL_COUNT];      //Packed by AMP_CAL_ENTRY()
+
+} AmpCal_BandTypeDef;
+
+typedef struct
+{
+    uint8_t BandCount;                          //Bands sorted by ascending frequency
+    AmpCal_BandTypeDef Bands[AMP_CAL_MAX_BANDS];
+
+} AmpCal_TableTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void AmpCal_Init(void);
+void AmpCal_LoadDefaults(AmpCal_TableTypeDef *table);
+HAL_StatusTypeDef AmpCal_Load(void);
+HAL_StatusTypeDef AmpCal_Save(void);
+
+AmpCal_TableTypeDef *AmpCal_GetTable(void);
+HAL_StatusTypeDef AmpCal_SetBand(uint32_t freq, const uint16_t *entries);
+
+void AmpCal_Lookup(uint32_t freq, float amp_mv, uint8_t *att, uint16_t *code);
+
+uint32_t AmpCal_Serialize(const AmpCal_TableTypeDef *table, uint8_t *buffer, uint32_t size);
+HAL_StatusTypeDef AmpCal_Deserialize(AmpCal_TableTypeDef *table, const uint8_t *buffer, uint32_t size);
@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file       crc32.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.2
+  * @brief      Software CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320)
+  *
+  * @note       Matches zlib crc32(), so images and packets can be checked on
+  *             the host with standard tools. The on-chip CRC unit computes a
+  *             different (non-reflected) variant and is not used here.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define CRC32_INIT_VALUE        0x00000000U
+
+/* Public Function Prototypes ------------------------------------------------*/
+uint32_t CRC32_Update(uint32_t crc, const uint8_t *data, uint32_t length);
@@ -8,6 +8,22 @@
   * @note       You need to initialize LCD driver before use this module
   *             If you're using framebuffer, when time is opportune, call
   *             CurveChart_FrameUpdate() to update chart area to screen.
+  *             Grid background lookup tables are shared, so only the chart
+  *             initialized last can be erased correctly, and its size must not
+  *             exceed CHART_MAX_WIDTH x CHART_MAX_HEIGHT.
+  *             Traces set with CurveChart_SetTrace() are owned by the chart:
+  *             CurveChart_UpdateTraces() remembers the rows each trace covers
+  *             in every column and only rewrites columns that changed, and
+  *             the Recover functions restore traces under erased lines and
+  *             rects instead of bare grid. Callers don't need to keep the
+  *             previous values to erase a trace.
+  *             Chart pixels can be read back with CurveChart_ReadPixel() and
+  *             CurveChart_ReadLine(), e.g. for XOR cursors or screenshots.
+  *             CurveChart_SaveBmpToFile() saves the chart area that way.
+  *             Without framebuffer or shadow they come from slow GRAM reads.
+  *             With an indexed framebuffer, CurveChart_FrameUpdate() expands
+  *             the dirty tiles and returns when the last line is sent, so
+  *             chart drawing never waits for a flush.
   ******************************************************************************
   */
 
@@ -22,11 +38,38 @@
 /* Note that if the whole screen area is using frambuffer, it will be redundant for chart to enable this */
 #if LCD_USE_FRAMEBUFFER
 #define CHART_USE_FRAMEBUFFER           0
+#define CHART_FRAMEBUFFER_INDEX_BITS    0
+#define CHART_USE_SHADOW                0
 #else
 #define CHART_USE_FRAMEBUFFER           1
+/* Set to 4 or 8 to store palette indices in chart framebuffer instead of RGB565
+ * pixels, taking width * height / 2 or width * height bytes. Indices are
+ * expanded to RGB565 line by line while flushing. 4-bit keeps 8 colors and
+ * their inverses exactly, 8-bit keeps 128, other colors are approximated */
+#define CHART_FRAMEBUFFER_INDEX_BITS    0
+/* Set CHART_USE_FRAMEBUFFER to 0 and this to 1 to draw the chart straight to GRAM
+ * while keeping a 4-bit palette copy of it in SRAM, taking width * height / 2
+ * bytes instead of a framebuffer's width * height * 2. Pixels can be read back
+ * from it without GRAM reads. Only 8 colors and their inverses are kept
+ * exactly, other colors (e.g. in bitmaps) are approximated in the copy */
+#define CHART_USE_SHADOW                0
 #endif
 
+/* Largest chart area covered by grid background lookup tables */
+#define CHART_MAX_WIDTH                 800
+#define CHART_MAX_HEIGHT                480
+
+/* Traces managed by chart, history takes 4B per column per trace */
+#define CHART_MAX_TRACES                4
+
 /* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    const uint16_t *Values;     //One value per column counted from chart bottom, NULL if hidden
+    uint16_t Color;
+
+} CurveChart_TraceTypeDef;
+
 typedef struct
 {
     uint16_t X;
@@ -44,12 +87,16 @@ typedef struct
     uint16_t CoarseGridColor;
     uint16_t FineGridColor;
 
+    /* Later traces are drawn over earlier ones */
+    CurveChart_TraceTypeDef Traces[CHART_MAX_TRACES];
+
 } CurveChartTypeDef;
 
 /* Public Function Prototypes ------------------------------------------------*/
 void CurveChart_Init(CurveChartTypeDef *chart);
 void CurveChart_DrawBitmap(const CurveChartTypeDef *chart,
                            uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap_buffer);
+void CurveChart_DrawSprite(const CurveChartTypeDef *chart, int16_t x, uint16_t y, const SpriteTypeDef *sprite);
 void CurveChart_RecoverRect(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 void CurveChart_DrawCurve(const CurveChartTypeDef *chart, const uint16_t *data, uint16_t color);
 void CurveChart_DrawLineX(const CurveChartTypeDef *chart, uint16_t x, uint16_t color);
@@ -59,10 +106,51 @@ void CurveChart_DrawDashedLineY(const CurveChartTypeDef *chart, uint16_t y, uint
 void CurveChart_RecoverGrid(const CurveChartTypeDef *chart, const uint16_t *data);
 void CurveChart_RecoverLineX(const CurveChartTypeDef *chart, uint16_t x);
 void CurveChart_RecoverLineY(const CurveChartTypeDef *chart, uint16_t y);
+void CurveChart_SetTrace(CurveChartTypeDef *chart, uint8_t trace, const uint16_t *values, uint16_t color);
+void CurveChart_UpdateTraces(const CurveChartTypeDef *chart);
+uint16_t CurveChart_ReadPixel(const CurveChartTypeDef *chart, uint16_t x, uint16_t y);
+void CurveChart_ReadLine(const CurveChartTypeDef *chart, uint16_t y, uint16_t *buffer);
+void CurveChart_XorLineX(const CurveChartTypeDef *chart, uint16_t x);
+void CurveChart_XorLineY(const CurveChartTypeDef *chart, uint16_t y);
 
 #if CHART_USE_FRAMEBUFFER
 void CurveChart_FrameUpdate(void);
+uint8_t CurveChart_IsFrameBusy(void);
 #endif // LCD_USE_FRAMEBUFFER
 
+#if LCD_USE_FATFS
+HAL_StatusTypeDef CurveChart_SaveBmpToFile(const CurveChartTypeDef *chart, const uint8_t *file_name);
+#endif // LCD_USE_FATFS
+
 /* Private Function Prototypes -----------------------------------------------*/
-static inline uint16_t CurveChart_GetRecoverPixelColor(const CurveChartTypeDef *chart, uint16_t x0, uint16_t y0);
\ No newline at end of file
+static inline uint16_t CurveChart_GetRecoverPixelColor(const CurveChartTypeDef *chart, uint16_t x0, uint16_t y0);
+static inline const uint16_t *CurveChart_GetBackgroundColumn(uint16_t x0);
+static inline uint8_t CurveChart_GetGridClass(const uint8_t *table, uint16_t i);
+static void CurveChart_BuildBackground(const CurveChartTypeDef *chart);
+static void CurveChart_ResetTraces(CurveChartTypeDef *chart);
+static const uint16_t *CurveChart_ComposeColumn(uint16_t x, uint16_t top, uint16_t bottom);
+static void CurveChart_WriteColumn(const CurveChartTypeDef *chart, uint16_t x, uint16_t top, uint16_t bottom);
+static inline uint8_t CurveChart_GetColumnSpan(const CurveChartTypeDef *chart, const uint16_t *data, uint16_t x, uint16_t *top, uint16_t *bottom);
+static void CurveChart_XorSpan(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+#if LCD_USE_FATFS
+static void CurveChart_ReadBmpLine(const void *source, uint16_t y, uint16_t *buffer);
+#endif // LCD_USE_FATFS
+
+#if CHART_USE_SHADOW || CHART_FRAMEBUFFER_INDEX_BITS
+static void CurveChart_ResetIndices(const CurveChartTypeDef *chart);
+static uint8_t CurveChart_GetPaletteIndex(uint16_t color);
+static void CurveChart_FillIndex(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t index);
+static inline void CurveChart_WriteIndex(uint16_t x, uint16_t y, uint8_t index);
+static inline uint8_t CurveChart_ReadIndex(uint16_t x, uint16_t y);
+#endif // CHART_USE_SHADOW || CHART_FRAMEBUFFER_INDEX_BITS
+
+#if CHART_USE_FRAMEBUFFER && CHART_FRAMEBUFFER_INDEX_BITS
+static inline void CurveChart_WriteIndexedPixel(uint16_t x, uint16_t y, uint16_t color);
+static void CurveChart_FlushIndexed(void);
+#endif // CHART_USE_FRAMEBUFFER && CHART_FRAMEBUFFER_INDEX_BITS
+
+#if !CHART_USE_FRAMEBUFFER
+static void CurveChart_DrawTraceSpans(const CurveChartTypeDef *chart, const uint16_t *data, uint16_t color, uint8_t recover);
+static void CurveChart_WriteSpan(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color, uint8_t recover);
+#endif // !CHART_USE_FRAMEBUFFER
\ No newline at end of file
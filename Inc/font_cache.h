@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file       font_cache.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      External SRAM cache of font library glyphs
+  *
+  * @note       Keeps glyph bitmaps read from the SD card font library files in
+  *             external SRAM, so drawing a label again does not go back to the
+  *             card. Entries are keyed by font type, size and character code;
+  *             when all slots are taken the least recently used one is
+  *             replaced. Only built with LCD_USE_FONTLIB.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define FONT_CACHE_SLOTS            320
+#define FONT_CACHE_SLOT_SIZE        200             //Largest glyph, 40x40 GB2312
+
+/* Cache key of a glyph, index is the glyph number in the font library file */
+#define FONT_CACHE_KEY(TYPE, IS_GB2312, SIZE, INDEX) \
+    (((uint32_t)(TYPE) << 28) | ((uint32_t)(IS_GB2312) << 24) | ((uint32_t)(SIZE) << 16) | (INDEX))
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Hits;
+    uint32_t Misses;
+
+} FontCache_StatsTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void FontCache_Init(void);
+void FontCache_Invalidate(void);
+HAL_StatusTypeDef FontCache_Read(uint32_t key, uint8_t *buffer, uint16_t size);
+void FontCache_Write(uint32_t key, const uint8_t *buffer, uint16_t size);
+void FontCache_GetStats(FontCache_StatsTypeDef *stats);
+void FontCache_ResetStats(void);
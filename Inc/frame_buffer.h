@@ -9,6 +9,13 @@
   *             positions are within the window when performing read/write.
   *             Call FrameBuffer_Update() to flush all pixels in buffer to
   *             destination memory address (e.g. GRAM).
+  *             FrameBuffer_UpdateAsync() returns right after starting the
+  *             transfer. The LCD bus belongs to DMA until the flush completes,
+  *             so call FrameBuffer_WaitBus() before sending other LCD commands.
+  *             Without a back buffer, wait for FrameBuffer_IsFlushing() to
+  *             clear before drawing into the buffer again.
+  *             Only 16x16 tiles touched since last flush are sent to GRAM.
+  *             Code writing PixelData directly must call FrameBuffer_MarkDirty().
   ******************************************************************************
   */
 
@@ -21,8 +28,18 @@
 /* Public Marcos -------------------------------------------------------------*/
 #define FRAME_BUFFER_USE_DMA           1
 
+/* Dirty tile tracking, tile size is (1 << FRAME_BUFFER_TILE_SHIFT) pixels square */
+#define FRAME_BUFFER_TILE_SHIFT        4
+#define FRAME_BUFFER_MAX_WIDTH         800
+#define FRAME_BUFFER_MAX_HEIGHT        480
+
+#define FRAME_BUFFER_TILE_SIZE         (1U << FRAME_BUFFER_TILE_SHIFT)
+#define FRAME_BUFFER_MAX_TILES         (((FRAME_BUFFER_MAX_WIDTH + FRAME_BUFFER_TILE_SIZE - 1) >> FRAME_BUFFER_TILE_SHIFT) \
+                                        * ((FRAME_BUFFER_MAX_HEIGHT + FRAME_BUFFER_TILE_SIZE - 1) >> FRAME_BUFFER_TILE_SHIFT))
+#define FRAME_BUFFER_TILE_WORDS        ((FRAME_BUFFER_MAX_TILES + 31) / 32)
+
 /* Public Types --------------------------------------------------------------*/
-typedef struct
+typedef struct FrameBufferTypeDef
 {
     uint16_t X;
     uint16_t Y;
@@ -31,23 +48,107 @@ typedef struct
     __IO uint16_t *PixelData;
     __IO uint16_t *DstAddr;
 
+    /* Optional second buffer, swapped with PixelData on each async flush */
+    __IO uint16_t *BackPixelData;
+    __IO uint8_t Flushing;
+    void (*FlushCpltCallback)(struct FrameBufferTypeDef *fb);
+
+    /* One bit per tile, row major */
+    uint16_t TileCols;
+    uint16_t TileRows;
+    uint32_t DirtyTiles[FRAME_BUFFER_TILE_WORDS];
+
 } FrameBufferTypeDef;
 
 /* Public Function Prototypes ------------------------------------------------*/
 void FrameBuffer_Init(FrameBufferTypeDef *fb, 
-                      const uint16_t *base_addr, const uint16_t *dst_addr,
+                      __IO uint16_t *base_addr, __IO uint16_t *dst_addr,
                       uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 
+void FrameBuffer_SetBackBuffer(FrameBufferTypeDef *fb, const uint16_t *back_addr);
 void FrameBuffer_Clear(FrameBufferTypeDef *fb, uint16_t color);
+void FrameBuffer_FillRect(FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color);
+void FrameBuffer_FillGram(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color);
+void FrameBuffer_WriteGram(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels);
+void FrameBuffer_WriteGramStride(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels, int32_t stride);
+void FrameBuffer_StreamGram(const uint16_t *pixels, uint32_t pixel_count);
+void FrameBuffer_MarkDirty(FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 void FrameBuffer_Update(FrameBufferTypeDef *fb);
+HAL_StatusTypeDef FrameBuffer_UpdateAsync(FrameBufferTypeDef *fb);
+HAL_StatusTypeDef FrameBuffer_WaitFlush(FrameBufferTypeDef *fb, uint32_t timeout);
+HAL_StatusTypeDef FrameBuffer_WaitBus(void);
 
 /* Public Inline Functions ---------------------------------------------------*/
+
+/**
+  * @brief  Checks whether an async flush of the framebuffer is in progress
+  * @param  fb: Pointer to pixel buffer structure
+  * @retval Non-zero while DMA is still reading the flushed buffer
+  */
+static inline uint8_t FrameBuffer_IsFlushing(const FrameBufferTypeDef *fb)
+{
+    return fb->Flushing;
+}
+
 static inline void FrameBuffer_WritePixel(FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t color)
 {
+    uint32_t tile = (y >> FRAME_BUFFER_TILE_SHIFT) * fb->TileCols + (x >> FRAME_BUFFER_TILE_SHIFT);
+
     fb->PixelData[fb->Width * y + x] = color;
+    fb->DirtyTiles[tile >> 5] |= 1UL << (tile & 31);
 }
 
 static inline uint16_t FrameBuffer_ReadPixel(const FrameBufferTypeDef *fb, uint16_t x, uint16_t y)
 {
     return fb->PixelData[fb->Width * y + x];
-}
\ No newline at end of file
+}
+
+/**
+  * @brief  Copies a row of pixels into the framebuffer
+  * @note   PixelData is volatile (external SRAM, read by DMA), so this copies
+  *         halfword by halfword instead of through memcpy(). Tiles are not
+  *         marked, call FrameBuffer_MarkDirty() for the whole rectangle.
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  x, y: Row start position
+  * @param  width: Pixel count
+  * @param  buffer: Source pixels (RGB565 format)
+  * @retval None
+  */
+static inline void FrameBuffer_WriteLine(FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t width, const uint16_t *buffer)
+{
+    __IO uint16_t *dst = fb->PixelData + fb->Width * y + x;
+
+    while (width--) {
+        *dst++ = *buffer++;
+    }
+}
+
+/**
+  * @brief  Copies a row of pixels out of the framebuffer
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  x, y: Row start position
+  * @param  width: Pixel count
+  * @param  buffer: Returns the pixels (RGB565 format)
+  * @retval None
+  */
+static inline void FrameBuffer_ReadLine(const FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t width, uint16_t *buffer)
+{
+    const __IO uint16_t *src = fb->PixelData + fb->Width * y + x;
+
+    while (width--) {
+        *buffer++ = *src++;
+    }
+}
+
+/* Private Function Prototypes -----------------------------------------------*/
+static uint8_t FrameBuffer_NextDirtyRegion(const FrameBufferTypeDef *fb,
+                                           uint16_t *x, uint16_t *y, uint16_t *width, uint16_t *height);
+static void FrameBuffer_SendDirtyRegions(FrameBufferTypeDef *fb);
+#if FRAME_BUFFER_USE_DMA
+static uint8_t FrameBuffer_StartRegion(void);
+static HAL_StatusTypeDef FrameBuffer_StartJob(void);
+static HAL_StatusTypeDef FrameBuffer_StartChunk(void);
+static void FrameBuffer_EndJob(void);
+static void FrameBuffer_DmaXferCplt(DMA_HandleTypeDef *hdma);
+static void FrameBuffer_DmaXferError(DMA_HandleTypeDef *hdma);
+#endif // FRAME_BUFFER_USE_DMA
@@ -1,13 +1,26 @@
 #pragma once
 #include <stm32f4xx_hal.h>
 #include "ad9959.h"
+#include "ads8694.h"
+#include "amp_calibration.h"
+#include "norm_profile.h"
+#include "sweep_export.h"
 
 #define	OUTPUT_CHANNEL		AD9959_CHANNEL_1
+#define	REFERENCE_CHANNEL	AD9959_CHANNEL_0	//矢量模式相位参考输出
 
 #define ADC_SAMPLE_COUNT	8
 #define MAX_SAMPLE_COUNT	2048
 #define MIN_SAMPLE_COUNT	100
 
+//矢量模式: ADS8694 CH0 接被测网络输出, CH1 接参考通道
+#define VECTOR_SAMPLE_COUNT			256			//每个频点每通道的I/Q解调点数
+#define VECTOR_MAX_SAMPLE_COUNT		512
+#define VECTOR_MIN_SAMPLE_COUNT		10
+#define VECTOR_MAX_FREQ				20000U		//Hz, 受ADS8694模拟输入带宽限制
+#define VECTOR_MAX_SAMPLING_RATE	50000U		//单通道最高采样率(两通道交替扫描)
+#define VECTOR_CYCLES_PER_RECORD	8			//每次记录至少包含的信号周期数
+
 #define GRID_X				40
 #define GRID_Y				10
 #define GRID_WIDTH			500
@@ -30,59 +43,6 @@
 
 #define STATUS_LED(X)		GPIOF->BSRR = (uint32_t)GPIO_PIN_10 << ((X) ? 16 : 0)
 
-static const uint16_t amp_table[][2] =
-{
-    { 15, 1018 },	//100mV
-    { 16, 1020 },	//98mV
-    { 16, 1000 },	//96mV
-    { 16, 975 },	//94mV
-    { 17, 1010 },	//92mV
-    { 17, 985 },	//90mV
-    { 18, 1015 },	//88mV
-    { 18, 990 },	//86mV
-    { 19, 1023 },	//84mV
-    { 19, 1003 },	//82mV
-    { 19, 971 },	//80mV
-    { 19, 945 },	//78mV
-    { 20, 1018 },	//76mV
-    { 20, 992 },	//74mV
-    { 21, 1018 },	//72mV
-    { 21, 991 },	//70mV
-    { 22, 1015 },	//68mV
-    { 22, 983 },	//66mV
-    { 23, 1008 },	//64mV
-    { 23, 974 },	//62mV
-    { 24, 1010 },	//60mV
-    { 24, 978 },	//58mV
-    { 25, 994 },	//56mV
-    { 26, 1012 },	//54mV
-    { 27, 1023 },	//52mV
-    { 27, 985 },	//50mV
-    { 28, 1020 },	//48mV
-    { 28, 980 },	//46mV
-    { 29, 990 },	//44mV
-    { 30, 990 },	//42mV
-    { 32, 986 },	//40mV
-    { 33, 1023 },	//38mV
-    { 34, 1017 },	//36mV
-    { 35, 1015 },	//34mV
-    { 35, 956 },	//32mV
-    { 36, 985 },	//30mV
-    { 38, 1023 },	//28mV
-    { 39, 1007 },	//26mV
-    { 40, 1001 },	//24mV
-    { 42, 1023 },	//22mV
-    { 43, 980 },	//20mV
-    { 45, 1023 },	//18mV
-    { 47, 1012 },	//16mV
-    { 50, 1007 },	//14mV
-    { 52, 995 },	//12mV
-    { 56, 1023 },	//10mV
-    { 59, 978 },	//8mV
-    { 63, 942 },	//6mV
-    { 63, 625 },	//4mV
-};
-
 void FreqSweep_Init(void);
 void FreqSweep_Start(void);
 //void FreqPoint_Output(void);
@@ -91,11 +51,21 @@ static void FreqSweepAndSampling(void);
 static void SetFreqParameters(void);
 static void UpdateFreqInfoDispaly(void);
 static void UpdateOutputAmp(void);
+static void SetOutputLevel(uint32_t freq);
+static void CalibrateOutputAmp(void);
+static void UpdateNormalization(void);
+static void BeginSweepExport(void);
+static void VectorSweepAndSampling(void);
+static void VectorDataToDisplay(void);
+static void SwitchSweepMode(void);
+static void IQ_Demodulate(const int32_t *samples, uint32_t freq, uint32_t samplingRate, float *pI, float *pQ);
 //static void GetCodeTable(void);
 
 //Inline Functions
 static inline void FreqParametersDisplay(uint8_t i, _Bool isSlected);
 static inline void CursorParametersDisplay(void);
+static inline void CursorLabelsDisplay(void);
+static inline float WrapPhase(float phase);
 
 //ZLG7290 Keyboard Driver
 extern void ZLG7290_Init();
@@ -104,6 +74,8 @@ extern uint8_t ZLG7290_ReadKey();
 //PE4302 Attenuator
 extern void PE4302_Init(void);
 extern void PE4302_SetAttenuation(uint8_t twoTimes_dB);
+//W25Qxx Flash
+extern void W25QXX_Init(void);
 //AD9959 DDS
 extern void AD9959_Init(void);
 extern void AD9959_SetFreq(uint8_t channel, uint32_t freq);
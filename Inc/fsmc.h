@@ -23,13 +23,62 @@
 #define FSMC_LCD_REG_ADDR			FSMC_LCD_BASE_ADDR 	/* LCD command address */
 #define FSMC_LCD_DATA_ADDR			(FSMC_LCD_BASE_ADDR + (1 << (FSMC_LCD_REG_SELECT + 1))) /* LCD data address */
 
+/* LCD bus access, host builds define FSMC_LCD_HOST to drive the simulated
+ * panel in Tools/host instead */
+#ifdef FSMC_LCD_HOST
+#include "lcd_sim.h"
+#define FSMC_LCD_WRITE_REG(REG)     LCDSim_WriteReg(REG)
+#define FSMC_LCD_WRITE_DATA(DATA)   LCDSim_WriteData(DATA)
+#define FSMC_LCD_READ_DATA()        LCDSim_ReadData()
+#else
+#define FSMC_LCD_WRITE_REG(REG)     (*((__IO uint16_t*)FSMC_LCD_REG_ADDR) = (REG))
+#define FSMC_LCD_WRITE_DATA(DATA)   (*((__IO uint16_t*)FSMC_LCD_DATA_ADDR) = (DATA))
+#define FSMC_LCD_READ_DATA()        (*((__IO uint16_t*)FSMC_LCD_DATA_ADDR))
+#endif // FSMC_LCD_HOST
+
 /* SRAM address mapping */
 #define FSMC_SRAM_BANK              FSMC_NORSRAM_BANK3  /* Bank select NE[1-4] */
 #define FSMC_SRAM_BASE_ADDR		    (0x60000000U | (FSMC_SRAM_BANK << 25))  /* External sram data address */
 
+/* LCD bus statistics, counts every access to the LCD bank when enabled */
+#define FSMC_LCD_BUS_STATS          0
+#define FSMC_LCD_BUS_STATS_PERIOD   64                  /* Frames averaged per report */
+
+/* Cost model in HCLK cycles per access, follows the LCD timings set in FSMC_Init() */
+#define FSMC_LCD_WRITE_CYCLES       (2 + 5 + 1)         /* ADDSET + DATAST + 1 */
+#define FSMC_LCD_READ_CYCLES        (1 + 18 + 2)        /* ADDSET + DATAST + 2 */
+
+#if FSMC_LCD_BUS_STATS
+#define FSMC_LCD_COUNT(FIELD, N)    (fsmc_lcd_bus_stats.FIELD += (N))
+#define FSMC_LCD_FRAME_DONE(TAG)    FSMC_LCD_BusStatsFrameDone(TAG)
+#else
+#define FSMC_LCD_COUNT(FIELD, N)
+#define FSMC_LCD_FRAME_DONE(TAG)
+#endif // FSMC_LCD_BUS_STATS
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct {
+    uint32_t RegSelects;        //Command (register select) writes
+    uint32_t DataWrites;        //Data writes by CPU
+    uint32_t DmaWrites;         //Data writes by DMA, in 16-bit bus accesses
+    uint32_t DataReads;         //Data reads, including dummy reads
+    uint32_t Frames;            //Frames finished since last reset
+} FSMC_LCD_BusStatsTypeDef;
+
+/* Public variables ----------------------------------------------------------*/
+#if FSMC_LCD_BUS_STATS
+extern FSMC_LCD_BusStatsTypeDef fsmc_lcd_bus_stats;
+#endif // FSMC_LCD_BUS_STATS
+
 /* Public function prototypes ------------------------------------------------*/
 void FSMC_Init(void);
 
+#if FSMC_LCD_BUS_STATS
+void FSMC_LCD_ResetBusStats(void);
+uint32_t FSMC_LCD_GetBusCycles(const FSMC_LCD_BusStatsTypeDef *stats);
+void FSMC_LCD_BusStatsFrameDone(const char *tag);
+#endif // FSMC_LCD_BUS_STATS
+
 /* Private function prototypes -----------------------------------------------*/
 static void HAL_FSMC_MspInit(void);
 
@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file       glyph_cache.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      Pre-rasterized glyph cache
+  *
+  * @note       Holds glyphs already expanded to RGB565 row-major blocks, keyed
+  *             by character, font size and colours, so opaque text can be
+  *             burst into GRAM without re-expanding font bitmaps. Blocks live
+  *             in CCM RAM (CPU only, never a DMA source) in one pool per font
+  *             size; a full pool replaces its least recently used glyph.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define GLYPH_CACHE_SLOTS_16        32                  //32 x 256B
+#define GLYPH_CACHE_SLOTS_24        24                  //24 x 576B
+#define GLYPH_CACHE_SLOTS_32        12                  //12 x 1KB
+#define GLYPH_CACHE_SLOTS_40        4                   //4 x 1600B
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint16_t Char;              //Character code, 0 marks an empty slot
+    uint8_t FontSize;
+    uint16_t Color;
+    uint16_t BgColor;
+    uint32_t LastUse;           //Run stamp of the last lookup
+    uint16_t *Pixels;           //FontSize rows of FontSize / 2 pixels
+
+} GlyphCache_EntryTypeDef;
+
+typedef struct
+{
+    uint8_t FontSize;
+    uint8_t Count;
+    GlyphCache_EntryTypeDef *Entries;
+
+} GlyphCache_PoolTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void GlyphCache_Init(void);
+void GlyphCache_Invalidate(void);
+void GlyphCache_BeginRun(void);
+uint16_t* GlyphCache_Find(uint16_t ch, uint8_t font_size, uint16_t color, uint16_t bg_color);
+uint16_t* GlyphCache_Alloc(uint16_t ch, uint8_t font_size, uint16_t color, uint16_t bg_color);
+
+/* Private Function Prototypes -----------------------------------------------*/
+static GlyphCache_PoolTypeDef* GlyphCache_GetPool(uint8_t font_size);
@@ -33,6 +33,7 @@
 #define WRITE_GRAM                  ILI9325_WriteData
 #define WRITE_PIXEL                 ILI9325_WritePixel
 #define READ_PIXEL                  ILI9325_ReadPixel
+#define READ_LINE                   ILI9325_ReadLine
 
 /* Low-Level I/O Functions ---------------------------------------------------*/
 
@@ -43,7 +44,8 @@
   */
 static inline void ILI9325_SelectReg(uint16_t reg)
 {
-    *((__IO uint16_t*)FSMC_LCD_REG_ADDR) = reg;
+    FSMC_LCD_COUNT(RegSelects, 1);
+    FSMC_LCD_WRITE_REG(reg);
 }
 
 /**
@@ -53,7 +55,8 @@ static inline void ILI9325_SelectReg(uint16_t reg)
   */
 static inline void ILI9325_WriteData(uint16_t data)
 {
-    *((__IO uint16_t*)FSMC_LCD_DATA_ADDR) = data;
+    FSMC_LCD_COUNT(DataWrites, 1);
+    FSMC_LCD_WRITE_DATA(data);
 }
 
 /**
@@ -75,7 +78,8 @@ static inline void ILI9325_WriteReg(uint16_t reg, uint16_t data)
   */
 static inline uint16_t ILI9325_ReadData(void)
 {
-    return *((__IO uint16_t*)FSMC_LCD_DATA_ADDR);
+    FSMC_LCD_COUNT(DataReads, 1);
+    return FSMC_LCD_READ_DATA();
 }
 
 /* LCD Interface Functions ---------------------------------------------------*/
@@ -207,4 +211,23 @@ static inline uint16_t ILI9325_ReadPixel(uint16_t x, uint16_t y)
     /* Read pixel color */
     ILI9325_SelectReg(CMD_READ_GRAM);
     return ILI9325_ReadData();
+}
+
+/**
+  * @brief  Reads a horizontal run of pixels from GRAM in one burst
+  * @param  x: Specifies the X left position
+  * @param  y: Specifies the Y position
+  * @param  width: Number of pixels to read
+  * @param  buffer: Where to store the pixels (RGB565 format)
+  * @retval None
+  */
+static inline void ILI9325_ReadLine(uint16_t x, uint16_t y, uint16_t width, uint16_t *buffer)
+{
+    ILI9325_SetWindow(x, y, width, 1);
+    ILI9325_SelectReg(CMD_READ_GRAM);
+    ILI9325_ReadData();  // Dummy
+
+    while (width--) {
+        *(buffer++) = ILI9325_ReadData();
+    }
 }
\ No newline at end of file
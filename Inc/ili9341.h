@@ -33,6 +33,7 @@
 #define WRITE_GRAM                  ILI9341_WriteData
 #define WRITE_PIXEL                 ILI9341_WritePixel
 #define READ_PIXEL                  ILI9341_ReadPixel
+#define READ_LINE                   ILI9341_ReadLine
 
 /* Low-Level I/O Functions ---------------------------------------------------*/
 
@@ -43,7 +44,8 @@
   */
 static inline void ILI9341_SelectReg(uint16_t reg)
 {
-    *((__IO uint16_t*)FSMC_LCD_REG_ADDR) = reg;
+    FSMC_LCD_COUNT(RegSelects, 1);
+    FSMC_LCD_WRITE_REG(reg);
 }
 
 /**
@@ -53,7 +55,8 @@ static inline void ILI9341_SelectReg(uint16_t reg)
   */
 static inline void ILI9341_WriteData(uint16_t data)
 {
-    *((__IO uint16_t*)FSMC_LCD_DATA_ADDR) = data;
+    FSMC_LCD_COUNT(DataWrites, 1);
+    FSMC_LCD_WRITE_DATA(data);
 }
 
 /**
@@ -63,7 +66,8 @@ static inline void ILI9341_WriteData(uint16_t data)
   */
 static inline uint16_t ILI9341_ReadData(void)
 {
-    return *((__IO uint16_t*)FSMC_LCD_DATA_ADDR);
+    FSMC_LCD_COUNT(DataReads, 1);
+    return FSMC_LCD_READ_DATA();
 }
 
 
@@ -204,4 +208,39 @@ static inline uint16_t ILI9341_ReadPixel(uint16_t x, uint16_t y)
     /* return RGB565 pixel color */
     g <<= 8;
     return ((r >> 11) << 11) | ((g >> 10) << 5) | (b >> 11);
+}
+
+/**
+  * @brief  Reads a horizontal run of pixels from GRAM in one burst
+  * @note   GRAM is read back as packed R, G, B bytes, i.e. three bus
+  *         words for every two pixels.
+  * @param  x: Specifies the X left position
+  * @param  y: Specifies the Y position
+  * @param  width: Number of pixels to read
+  * @param  buffer: Where to store the pixels (RGB565 format)
+  * @retval None
+  */
+static inline void ILI9341_ReadLine(uint16_t x, uint16_t y, uint16_t width, uint16_t *buffer)
+{
+    uint16_t rg, br, gb;
+
+    ILI9341_SetWindow(x, y, width, 1);
+    ILI9341_SelectReg(CMD_READ_GRAM);
+    ILI9341_ReadData();  // Dummy
+
+    while (width >= 2)
+    {
+        rg = ILI9341_ReadData();
+        br = ILI9341_ReadData();
+        gb = ILI9341_ReadData();
+        *(buffer++) = (rg & 0xF800) | ((rg & 0x00FC) << 3) | (br >> 11);
+        *(buffer++) = ((br & 0x00F8) << 8) | ((gb >> 5) & 0x07E0) | ((gb & 0x00F8) >> 3);
+        width -= 2;
+    }
+    if (width)
+    {
+        rg = ILI9341_ReadData();
+        br = ILI9341_ReadData();
+        *buffer = (rg & 0xF800) | ((rg & 0x00FC) << 3) | (br >> 11);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file       jdata_conf.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      LibJPEG data source/destination and memory configuration
+  *
+  * @note       JPEG files are read from and written to FatFs files. Included
+  *             by jconfig.h, so it is seen by every LibJPEG source file.
+  *             Memory comes from the SRAM arena in jmemsram.c, not the heap.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include "ff.h"
+
+/* Public Marcos -------------------------------------------------------------*/
+#define JFILE                       FIL
+
+#define JFREAD(FILE, BUF, SIZE)     read_file(FILE, BUF, SIZE)
+#define JFWRITE(FILE, BUF, SIZE)    write_file(FILE, BUF, SIZE)
+
+/* Public Function Prototypes ------------------------------------------------*/
+size_t read_file(JFILE *file, uint8_t *buf, uint32_t sizeofbuf);
+size_t write_file(JFILE *file, uint8_t *buf, uint32_t sizeofbuf);
@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file       jmemsram.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      LibJPEG memory manager backend on an external SRAM arena
+  *
+  * @note       Replaces jmemnobs.c. All LibJPEG objects are carved from one
+  *             bump arena in FSMC SRAM, so decoding and encoding never touch
+  *             the heap. The arena is rewound when the last codec object is
+  *             destroyed, or explicitly with JpegArena_Reset().
+  *             Define JPEG_ARENA_HOST to back the arena with a static array,
+  *             e.g. to measure peak usage of real images in a host build.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define JPEG_ARENA_SIZE             0x0002C000U     //176KB, SRAM_JPEG_ARENA_SIZE in sram.h
+#define JPEG_ARENA_ALIGN            8
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Limit;             //Ceiling of the arena in bytes
+    uint32_t Used;              //Bytes taken now
+    uint32_t Peak;              //Most bytes taken since the last reset
+    uint32_t Allocations;       //Successful allocations since the last reset
+    uint32_t Failures;          //Requests refused for going over Limit
+
+} JpegArena_StatsTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void JpegArena_Reset(void);
+void JpegArena_SetLimit(uint32_t limit);
+void JpegArena_GetStats(JpegArena_StatsTypeDef *stats);
@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stm32f4xx_hal.h>
 #include "fsmc.h"
+#include "sprite.h"
 
 /* Public Marcos -------------------------------------------------------------*/
 
@@ -37,9 +38,11 @@
 #define LCD_USE_FRAMEBUFFER         0
 #define LCD_USE_FATFS               0
 #define LCD_USE_FONTLIB             0
+#define LCD_USE_LIBJPEG             0
 
 #if !LCD_USE_FATFS
 #define LCD_USE_FONTLIB             0
+#define LCD_USE_LIBJPEG             0
 #endif
 
 /* Public Types --------------------------------------------------------------*/
@@ -63,7 +66,8 @@ typedef struct {
     uint8_t FontType;
 } LCD_InfoTypeDef;
 
-#pragma pack(2)
+/* BMP headers are packed to 2 bytes as in the file, later types keep the default */
+#pragma pack(push, 2)
 typedef struct {
     uint16_t bfType;
     uint32_t bfSize;
@@ -85,11 +89,16 @@ typedef struct {
     uint32_t biClrUsed;
     uint32_t biClrImportant;
 } BmpInfoHeader;
+#pragma pack(pop)
+
+/* Fills buffer with row y of an image being saved, rows counted from the top */
+typedef void (*LCD_ReadLineFunc)(const void *source, uint16_t y, uint16_t *buffer);
 
 /* Public Function Prototypes ------------------------------------------------*/
 void LCD_Init(uint8_t orientation);
 void LCD_DisplayOn(void);
 void LCD_DisplayOff(void);
+void LCD_ResetWindow(void);
 void LCD_Clear(uint16_t color);
 void LCD_DrawHLine(uint16_t x, uint16_t y, uint16_t width, uint16_t color);
 void LCD_DrawVLine(uint16_t x, uint16_t y, uint16_t height, uint16_t color);
@@ -99,10 +108,13 @@ void LCD_FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint1
 void LCD_DrawCircle(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color);
 void LCD_FillCircle(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color);
 void LCD_DrawBitmapStream(const uint16_t *stream_buffer, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+void LCD_DrawSprite(const SpriteTypeDef *sprite, uint16_t x, uint16_t y);
 void LCD_DrawNumber(int32_t num, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color);
 void LCD_DrawBigNumber(uint8_t num, uint16_t x, uint16_t y, uint16_t color);
 void LCD_DrawString(const uint8_t *str, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color);
+void LCD_DrawStringOpaque(const uint8_t *str, uint8_t font_size, uint16_t x, uint16_t y, uint16_t width, uint16_t color, uint16_t bg_color);
 void LCD_DrawCharASCII(uint8_t ch, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color);
+const uint8_t* LCD_GetCharASCIIData(uint8_t ch, uint8_t font_size);
 
 #if LCD_USE_FRAMEBUFFER
 void LCD_FrameUpdate(void);
@@ -111,13 +123,42 @@ void LCD_FrameUpdate(void);
 #if LCD_USE_FATFS
 void LCD_DrawBitmapStreamFromFile(const uint8_t* file_name, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 void LCD_DrawBmpFromFile(const uint8_t* file_name, uint16_t x, uint16_t y);
+HAL_StatusTypeDef LCD_SaveBmpToFile(const uint8_t* file_name, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+HAL_StatusTypeDef LCD_SaveBmpLinesToFile(const uint8_t* file_name, uint16_t width, uint16_t height,
+                                         LCD_ReadLineFunc read_line, const void *source);
 #endif // LCD_USE_FATFS
 
+#if LCD_USE_LIBJPEG
+void LCD_DrawJpegFromFile(const uint8_t* file_name, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+#endif // LCD_USE_LIBJPEG
+
 #if LCD_USE_FONTLIB
 void LCD_SetFont(FontType font_type);
 void LCD_DrawCharGB2312(uint8_t* ch_ptr, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color);
 #endif // LCD_USE_GBKFONTLIB 
 
 /* Private Function Prototypes -----------------------------------------------*/
+/* Span fill a shape sends its runs through, picked once per shape */
+typedef void (*LCD_SpanFunc)(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+
+static void LCD_FillSpan(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+static void LCD_FillSpanClipped(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+static LCD_SpanFunc LCD_GetSpanFunc(uint16_t x0, uint16_t y0, uint8_t radius);
+static void LCD_EndSpans(void);
+#if LCD_USE_FATFS
+static void LCD_ReadScreenLine(const void *source, uint16_t y, uint16_t *buffer);
+#endif // LCD_USE_FATFS
+#if LCD_USE_FONTLIB
+static HAL_StatusTypeDef LCD_LoadFontGlyph(_Bool is_gb2312, uint16_t index, uint8_t font_size, uint8_t *buffer);
+static void LCD_CloseFontFiles(void);
+#else
+static const uint16_t* LCD_GetGlyph(uint8_t ch, uint8_t font_size, uint16_t color, uint16_t bg_color);
+#endif // LCD_USE_FONTLIB
+
+#if LCD_USE_LIBJPEG
+struct jpeg_common_struct;
+static void LCD_JpegErrorExit(struct jpeg_common_struct *cinfo);
+static void LCD_JpegOutputMessage(struct jpeg_common_struct *cinfo);
+#endif // LCD_USE_LIBJPEG
 
 /* End of file ---------------------------------------------------------------*/
\ No newline at end of file
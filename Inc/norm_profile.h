@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file       norm_profile.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      Cached sweep normalization profiles
+  *
+  * @note       Profiles are keyed by sweep range, step and output amplitude.
+  *             Point data lives in external SRAM for fast reuse and every slot
+  *             is mirrored to W25Qxx flash, so profiles survive power cycles.
+  *             A request is served from an exact match, or interpolated from
+  *             a profile with the same amplitude whose range covers it. When
+  *             all slots are taken the least recently used one is replaced.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define NORM_PROFILE_SLOTS          8
+#define NORM_PROFILE_MAX_POINTS     2048
+
+#define NORM_PROFILE_FLASH_ADDR     0x1E0000U       //8 slots x 8KB below calibration block
+#define NORM_PROFILE_FLASH_SLOT     0x2000U         //Two 4KB sectors per slot
+#define NORM_PROFILE_MAGIC          0x4652504EU     //"NPRF"
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Start;         //Sweep start frequency
+    uint32_t Stop;          //Sweep stop frequency
+    uint32_t Step;          //Frequency step
+    uint16_t Amplitude;     //Output amplitude setting
+    uint16_t Count;         //Number of points, Start + i * Step
+
+} NormProfile_KeyTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void NormProfile_Init(void);
+HAL_StatusTypeDef NormProfile_Fetch(const NormProfile_KeyTypeDef *key, int16_t *values);
+HAL_StatusTypeDef NormProfile_Store(const NormProfile_KeyTypeDef *key, const int16_t *values);
@@ -74,6 +74,7 @@ static inline void UpdateHorizontalPosInfo(void);
 
 static void AdjustTriggerVoltage(_Bool up_down_select);
 static inline void ConfigSamplingArgs(void);
+static void DrawBaseTag(uint16_t box_x, uint16_t box_y, uint16_t box_width, const uint8_t *tag);
 
 //ZLG7290 KeyBoard Driver
 extern void ZLG7290_Init(void);
@@ -1,31 +1,43 @@
 #pragma once
 
-const uint16_t right_triangle_pattern[] = 
+#include "sprite.h"
+
+/* Generated by sprite_converter from right_triangle.bin, do not edit
+ * 11x11, transparent 0x0000, 212 bytes (raw 242 bytes)
+ */
+static const uint16_t right_triangle_sprite_data[] =
 {
-	0xB5A0, 0x39E0, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0xFFE0, 0xFFE0, 0xB580, 0x4220, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xBDC0, 0x4200, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xB580, 0x39E0, 0x0000, 0x0000, 0x0000,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xB5A0, 0x4A40, 0x0840,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x8420,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xCE40, 0x6300, 0x18C0,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xC600, 0x4A60, 0x0000, 0x0000, 0x0000,
-	0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xCE60, 0x4A60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0xFFE0, 0xFFE0, 0xC620, 0x5AC0, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0xC620, 0x4A60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	1,  0, 2, 0xB5A0, 0x39E0,
+	1,  0, 4, 0xFFE0, 0xFFE0, 0xB580, 0x4220,
+	1,  0, 6, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xBDC0, 0x4200,
+	1,  0, 8, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xB580, 0x39E0,
+	1,  0, 11, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xB5A0, 0x4A40, 0x0840,
+	1,  0, 11, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x8420,
+	1,  0, 11, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xCE40, 0x6300, 0x18C0,
+	1,  0, 8, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xC600, 0x4A60,
+	1,  0, 6, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xCE60, 0x4A60,
+	1,  0, 4, 0xFFE0, 0xFFE0, 0xC620, 0x5AC0,
+	1,  0, 2, 0xC620, 0x4A60,
 };
 
-const uint16_t down_triangle_pattern[] =
+static const SpriteTypeDef right_triangle_sprite = { 11, 11, right_triangle_sprite_data };
+
+/* Generated by sprite_converter from down_triangle.bin, do not edit
+ * 11x11, transparent 0x0000, 212 bytes (raw 242 bytes)
+ */
+static const uint16_t down_triangle_sprite_data[] =
 {
-	0xB5A0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xC620,
-	0x39E0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x4A60,
-	0x0000, 0xB580, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xC620, 0x0000,
-	0x0000, 0x4220, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x5AC0, 0x0000,
-	0x0000, 0x0000, 0xBDC0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xCE60, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x4200, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x4A60, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0xB580, 0xFFE0, 0xFFE0, 0xFFE0, 0xC600, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x39E0, 0xFFE0, 0xFFE0, 0xFFE0, 0x4A60, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0xB5A0, 0xFFE0, 0xCE40, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x4A40, 0xFFE0, 0x6300, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0840, 0x8420, 0x18C0, 0x0000, 0x0000, 0x0000, 0x0000,
+	1,  0, 11, 0xB5A0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xC620,
+	1,  0, 11, 0x39E0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x4A60,
+	1,  1, 9, 0xB580, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xC620,
+	1,  1, 9, 0x4220, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x5AC0,
+	1,  2, 7, 0xBDC0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xCE60,
+	1,  2, 7, 0x4200, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0xFFE0, 0x4A60,
+	1,  3, 5, 0xB580, 0xFFE0, 0xFFE0, 0xFFE0, 0xC600,
+	1,  3, 5, 0x39E0, 0xFFE0, 0xFFE0, 0xFFE0, 0x4A60,
+	1,  4, 3, 0xB5A0, 0xFFE0, 0xCE40,
+	1,  4, 3, 0x4A40, 0xFFE0, 0x6300,
+	1,  4, 3, 0x0840, 0x8420, 0x18C0,
 };
+
+static const SpriteTypeDef down_triangle_sprite = { 11, 11, down_triangle_sprite_data };
@@ -1,5 +1,6 @@
 #pragma once
 #include <stm32f4xx_hal.h>
+#include "sprite.h"
 
 #define MAX_SAMPLE_COUNT		4096
 #define EXTRA_GAIN_FACTOR		0.12700467f
@@ -59,22 +60,27 @@ static void GenerateWindowFunction(float *window, uint16_t length, uint8_t type)
 extern void ZLG7290_Init(void);
 extern uint8_t ZLG7290_ReadKey(void);
 
-static const uint16_t arrow_pattern[] =
+/* Generated by sprite_converter from arrow.bin, do not edit
+ * 16x16, transparent 0x0000, 324 bytes (raw 512 bytes)
+ */
+static const uint16_t arrow_sprite_data[] =
 {
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xB596, 0xCE59, 0x2104, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xFFFF, 0xFFFF, 0x2965, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0861, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x0000, 0x0000, 0x1082, 0x0000,
-	0x5ACB, 0xEF7D, 0x73AE, 0x0000, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x0000, 0x31A6, 0xF79E, 0x94B2,
-	0x8430, 0xFFFF, 0xFFFF, 0x738E, 0x0000, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x0000, 0x39E7, 0xFFFF, 0xFFFF, 0xC638,
-	0x0000, 0x7BCF, 0xFFFF, 0xFFFF, 0x632C, 0x0000, 0x0000, 0xE73C, 0xFFFF, 0x2945, 0x0000, 0x31A6, 0xFFFF, 0xFFFF, 0xAD75, 0x0000,
-	0x0000, 0x0000, 0x7BCF, 0xFFFF, 0xFFFF, 0x632C, 0x0000, 0xDEFB, 0xFFFF, 0x0000, 0x2104, 0xFFFF, 0xFFFF, 0xAD75, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x7BCF, 0xFFFF, 0xFFFF, 0x630C, 0xCE59, 0xFFFF, 0x5ACB, 0xEF7D, 0xFFFF, 0xAD75, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x7BCF, 0xFFFF, 0xFFFF, 0xFFDF, 0xFFFF, 0xFFFF, 0xFFFF, 0xAD75, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x73AE, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xAD55, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x73AE, 0xFFFF, 0xFFFF, 0xAD55, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x94B2, 0xBDF7, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	1,  7, 3, 0xB596, 0xCE59, 0x2104,
+	1,  7, 3, 0xFFFF, 0xFFFF, 0x2965,
+	1,  7, 3, 0xE73C, 0xFFFF, 0x2945,
+	1,  7, 3, 0xE73C, 0xFFFF, 0x2945,
+	1,  7, 3, 0xE73C, 0xFFFF, 0x2945,
+	1,  7, 3, 0xE73C, 0xFFFF, 0x2945,
+	3,  1, 1, 0x0861,  5, 3, 0xE73C, 0xFFFF, 0x2945,  4, 1, 0x1082,
+	3,  0, 3, 0x5ACB, 0xEF7D, 0x73AE,  4, 3, 0xE73C, 0xFFFF, 0x2945,  3, 3, 0x31A6, 0xF79E, 0x94B2,
+	3,  0, 4, 0x8430, 0xFFFF, 0xFFFF, 0x738E,  3, 3, 0xE73C, 0xFFFF, 0x2945,  2, 4, 0x39E7, 0xFFFF, 0xFFFF, 0xC638,
+	3,  1, 4, 0x7BCF, 0xFFFF, 0xFFFF, 0x632C,  2, 3, 0xE73C, 0xFFFF, 0x2945,  1, 4, 0x31A6, 0xFFFF, 0xFFFF, 0xAD75,
+	3,  2, 4, 0x7BCF, 0xFFFF, 0xFFFF, 0x632C,  1, 2, 0xDEFB, 0xFFFF,  1, 4, 0x2104, 0xFFFF, 0xFFFF, 0xAD75,
+	1,  3, 10, 0x7BCF, 0xFFFF, 0xFFFF, 0x630C, 0xCE59, 0xFFFF, 0x5ACB, 0xEF7D, 0xFFFF, 0xAD75,
+	1,  4, 8, 0x7BCF, 0xFFFF, 0xFFFF, 0xFFDF, 0xFFFF, 0xFFFF, 0xFFFF, 0xAD75,
+	1,  5, 6, 0x73AE, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xAD55,
+	1,  6, 4, 0x73AE, 0xFFFF, 0xFFFF, 0xAD55,
+	1,  7, 2, 0x94B2, 0xBDF7,
 };
+
+static const SpriteTypeDef arrow_sprite = { 16, 16, arrow_sprite_data };
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file       sprite.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.11
+  * @brief      Run-length encoded sprites for small UI bitmaps
+  *
+  * @note       Sprite data is a stream of 16-bit words, row by row from the
+  *             top. Each row starts with the number of opaque runs in it,
+  *             followed by every run as (skip, length, length RGB565 pixels),
+  *             skip being the transparent pixels since the end of the previous
+  *             run. Transparent pixels aren't stored, so blitters draw each
+  *             run through one GRAM window and leave the rest untouched.
+  *             Sprite headers are generated by Tools/sprite_converter.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint16_t Width;
+    uint16_t Height;
+    const uint16_t *Data;       //Encoded rows, see file notes
+
+} SpriteTypeDef;
@@ -1,7 +1,26 @@
 #pragma once
 #include <stm32f4xx_hal.h>
 
-#define SRAM_SIZE			0x1024000U		//SRAM size (Bytes)
+#define SRAM_SIZE			0x00100000U		//SRAM size (Bytes)
+
+//SRAM memory map (byte offsets from FSMC_SRAM_BASE_ADDR)
+#define SRAM_FRAMEBUFFER_OFFSET		0x00000000U		//LCD framebuffer
+#define SRAM_FRAMEBUFFER_SIZE		0x000BC000U		//800 x 480 x 2 = 0xBB800 (750KB), rounded to 4KB
+#define SRAM_CHART_OFFSET			SRAM_FRAMEBUFFER_OFFSET	//Chart framebuffer, indices or shadow, only
+#define SRAM_CHART_SIZE				SRAM_FRAMEBUFFER_SIZE	//used while LCD framebuffer is disabled
+#define SRAM_JPEG_ARENA_OFFSET		0x000BC000U		//LibJPEG memory arena
+#define SRAM_JPEG_ARENA_SIZE		0x0002C000U		//176KB, 800x480 takes 55KB to decode, 70KB to encode
+#define SRAM_FONT_CACHE_OFFSET		0x000E8000U		//Font library glyph cache
+#define SRAM_FONT_CACHE_SIZE		0x00010000U		//64KB
+#define SRAM_NORM_PROFILE_OFFSET	0x000F8000U		//Sweep normalization profiles, 8 x 2048 points
+#define SRAM_NORM_PROFILE_SIZE		0x00008000U		//32KB
+
+#if SRAM_FRAMEBUFFER_OFFSET + SRAM_FRAMEBUFFER_SIZE > SRAM_JPEG_ARENA_OFFSET \
+    || SRAM_JPEG_ARENA_OFFSET + SRAM_JPEG_ARENA_SIZE > SRAM_FONT_CACHE_OFFSET \
+    || SRAM_FONT_CACHE_OFFSET + SRAM_FONT_CACHE_SIZE > SRAM_NORM_PROFILE_OFFSET \
+    || SRAM_NORM_PROFILE_OFFSET + SRAM_NORM_PROFILE_SIZE > SRAM_SIZE
+#error "SRAM map regions overlap or exceed the SRAM size"
+#endif
 
 void SRAM_WriteBytes(uint32_t offset, uint8_t* src, uint32_t count);
 void SRAM_ReadBytes(uint32_t offset, uint8_t* dst, uint32_t count);
@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file       strip_renderer.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.10
+  * @brief      Display list renderer drawing a screen area strip by strip
+  *
+  * @note       Draw calls between StripRenderer_Begin() and StripRenderer_End()
+  *             are only recorded. StripRenderer_End() rasterizes the list into
+  *             a strip buffer a few rows high and DMAs it to GRAM, while the
+  *             next strip is drawn into a second buffer. Every pixel of the
+  *             area is written exactly once per frame, so updates are as clean
+  *             as a framebuffer flush without a full-screen buffer or any
+  *             external SRAM access.
+  *             Bitmap pixels and curve values are referenced, not copied, and
+  *             must stay valid until StripRenderer_End() returns. Strings are
+  *             copied. Later calls draw over earlier ones.
+  *             Don't use this on an area covered by LCD framebuffer, the next
+  *             framebuffer flush would overwrite it.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define STRIP_RENDERER_MAX_WIDTH    800
+#define STRIP_RENDERER_ROWS         8               //2 x 800 x 8 x 2B = 25KB of DMA capable SRAM
+#define STRIP_RENDERER_MAX_OPS      128
+#define STRIP_RENDERER_TEXT_POOL    512             //Bytes of string storage per frame
+
+/* Public Types --------------------------------------------------------------*/
+typedef enum {
+    STRIP_OP_FILL_RECT,
+    STRIP_OP_LINE,
+    STRIP_OP_BITMAP,
+    STRIP_OP_CURVE,
+    STRIP_OP_TEXT,
+} StripRenderer_OpType;
+
+typedef struct
+{
+    uint8_t Type;
+    uint8_t FontSize;           //Text only
+    uint16_t Color;
+    int16_t Top;                //Rows covered [Top, Bottom), to skip strips
+    int16_t Bottom;
+    int16_t X0;                 //Top-left corner, or first end of a line
+    int16_t Y0;
+    int16_t X1;                 //Bottom-right corner (exclusive), or second end of a line
+    int16_t Y1;
+    const void *Data;           //Bitmap pixels, curve values or string
+
+} StripRenderer_OpTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void StripRenderer_Begin(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t bg_color);
+HAL_StatusTypeDef StripRenderer_End(void);
+
+void StripRenderer_FillRect(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color);
+void StripRenderer_DrawRect(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color);
+void StripRenderer_DrawHLine(int16_t x, int16_t y, uint16_t width, uint16_t color);
+void StripRenderer_DrawVLine(int16_t x, int16_t y, uint16_t height, uint16_t color);
+void StripRenderer_DrawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+void StripRenderer_DrawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint16_t *pixels);
+void StripRenderer_DrawCurve(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint16_t *values, uint16_t color);
+void StripRenderer_DrawString(const uint8_t *str, uint8_t font_size, int16_t x, int16_t y, uint16_t color);
+
+/* Private Function Prototypes -----------------------------------------------*/
+static StripRenderer_OpTypeDef* StripRenderer_AddOp(uint8_t type, int16_t top, int16_t bottom);
+static void StripRenderer_RasterizeOp(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom);
+static void StripRenderer_RasterizeLine(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom);
+static void StripRenderer_RasterizeCurve(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom);
+static void StripRenderer_RasterizeText(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom);
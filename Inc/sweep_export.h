@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file       sweep_export.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.8
+  * @brief      Streams sweep results over USB CDC as framed binary packets
+  *
+  * @note       Points are batched into packets and queued with
+  *             VCP_TransmitAsync(), so the sweep loop never waits for the
+  *             host. A packet that does not fit the TX queue is dropped and
+  *             counted; the receiver sees it as a sequence number gap.
+  *
+  *             Packet (all fields little-endian):
+  *               0  uint16  Sync 0xA55A
+  *               2  uint8   Type (SWEEP_PACKET_xxx)
+  *               3  uint8   Reserved, 0
+  *               4  uint16  Sequence number
+  *               6  uint16  Payload length N
+  *               8  N bytes Payload
+  *               8+N uint32 CRC-32 of bytes [2, 8+N)
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define SWEEP_PACKET_SYNC               0xA55A
+
+#define SWEEP_PACKET_BEGIN              0x01    //Payload: SweepExport_InfoTypeDef layout
+#define SWEEP_PACKET_POINTS             0x02    //Payload: sweep id, first index, count, points
+#define SWEEP_PACKET_END                0x03    //Payload: sweep id, point count, dropped packets
+
+#define SWEEP_EXPORT_POINTS_PER_PACKET  32
+#define SWEEP_EXPORT_POINT_SIZE         10      //freq(u32) raw(u16) gain(i16, 0.01dB) phase(i16, 0.01deg)
+
+#define SWEEP_MODE_MAGNITUDE            0
+#define SWEEP_MODE_VECTOR               1
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Start;         //Hz
+    uint32_t Stop;          //Hz
+    uint32_t Step;          //Hz
+    uint16_t Count;         //Number of points
+    uint16_t Amplitude;     //Output amplitude (mV)
+    uint8_t Mode;           //SWEEP_MODE_xxx
+
+} SweepExport_InfoTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void SweepExport_Begin(const SweepExport_InfoTypeDef *info);
+void SweepExport_AddPoint(uint32_t freq, uint16_t raw, float gain_db, float phase_deg);
+void SweepExport_End(void);
+uint32_t SweepExport_GetDroppedCount(void);
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file       text_label.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      Retained text label UI control
+  *
+  * @note       You need to initialize LCD driver before use this module.
+  *             A label remembers the string last drawn in it, and an update
+  *             only redraws the character cells that changed, without
+  *             clearing the whole field first. Labels are meant for ASCII
+  *             readouts, where every character takes one cell.
+  *             Call TextLabel_Invalidate() after the screen under a label was
+  *             drawn over or its colors were changed.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stm32f4xx_hal.h>
+#include "lcd.h"
+
+/* Public Marcos -------------------------------------------------------------*/
+#define TEXT_LABEL_MAX_LENGTH           24
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint16_t X;
+    uint16_t Y;
+    uint16_t Width;                 //Field width cleared on a full redraw
+    uint8_t FontSize;
+
+    uint16_t Color;
+    uint16_t BgColor;
+
+    uint8_t Text[TEXT_LABEL_MAX_LENGTH + 1];    //String currently on screen
+    uint8_t Length;
+    _Bool IsValid;                  //0 forces a full redraw on next update
+
+} TextLabelTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void TextLabel_Init(TextLabelTypeDef *label, uint16_t x, uint16_t y, uint16_t width, uint8_t font_size,
+                    uint16_t color, uint16_t bg_color);
+void TextLabel_Update(TextLabelTypeDef *label, const uint8_t *str);
+void TextLabel_Invalidate(TextLabelTypeDef *label);
+
+/* Private Function Prototypes -----------------------------------------------*/
+static inline uint8_t TextLabel_GetCell(const uint8_t *str, uint8_t length, uint8_t i);
@@ -2,7 +2,8 @@
 #include "usbd_cdc.h"
 
 #define VCP_RX_BUFFER_SIZE 1024
-#define VCP_TX_BUFFER_SIZE 1024
+#define VCP_TX_BUFFER_SIZE 4096
+#define VCP_TX_PACKET_SIZE 1024     //Bytes handed to the IN endpoint per SOF
 
 #define VCP_TIMEOUT     500
 
@@ -10,6 +11,11 @@
 size_t VCP_Transmit(const uint8_t* buffer, size_t size);
 size_t VCP_Recieve(uint8_t* buffer, size_t size);
 
+/* Non-blocking TX queue, drained from the SOF interrupt */
+size_t VCP_TransmitAsync(const uint8_t* buffer, size_t size);
+size_t VCP_GetTxFreeSpace(void);
+void VCP_PollTransmit(void);
+
 /** CDC Interface callback. */
 static int8_t CDC_Init_FS(void);
 static int8_t CDC_DeInit_FS(void);
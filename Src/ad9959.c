@@ -2,6 +2,29 @@
 
 static uint8_t reg_length[25] = { 1,3,2,3,4,2,3,2,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4 };
 
+//暂存的通道寄存器映像, 按 staged_regs 的顺序排列
+static const uint8_t staged_regs[] = { CFR, CFTW0, CPOW0, ACR, CW1 };
+#define STAGED_REG_COUNT	(sizeof(staged_regs) / sizeof(staged_regs[0]))
+
+typedef struct {
+	uint32_t Reg[STAGED_REG_COUNT];
+	uint8_t Dirty;		//每个暂存寄存器一位
+} ChannelImage;
+
+static ChannelImage channel_image[AD9959_CHANNEL_COUNT];
+
+enum { IMG_CFR, IMG_CFTW0, IMG_CPOW0, IMG_ACR, IMG_CW1 };
+
+static inline void StageReg(uint8_t channels, uint8_t index, uint32_t value)
+{
+    for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+        if (channels & (AD9959_CHANNEL_0 << i)) {
+            channel_image[i].Reg[index] = value;
+            channel_image[i].Dirty |= 1 << index;
+        }
+    }
+}
+
 void AD9959_Init(void)
 {
     GPIO_InitTypeDef GPIO_InitStruct;
@@ -22,6 +45,16 @@ void AD9959_Init(void)
 
     AD9959_Reset();
     WriteReg(FR1, 0xD00000);
+
+    //与复位后的寄存器状态保持一致
+    for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+        channel_image[i].Reg[IMG_CFR] = CFR_DAC_FULL_SCALE;
+        channel_image[i].Reg[IMG_CFTW0] = 0;
+        channel_image[i].Reg[IMG_CPOW0] = 0;
+        channel_image[i].Reg[IMG_ACR] = 0;
+        channel_image[i].Reg[IMG_CW1] = 0;
+        channel_image[i].Dirty = 0;
+    }
 }
 
 void AD9959_Reset(void)
@@ -47,9 +80,9 @@ void AD9959_SweepFreq(
     uint32_t freqStart, uint32_t freqEnd, uint32_t freqStep,
     uint16_t timeStep)
 {
-    WriteReg(CSR, channel);
     AD9959_SetAmp(channel, amp);
 
+    WriteReg(CSR, channel);
     WriteReg(CFR, 0x804314);
     WriteReg(FR1, 0xD00000);
     WriteReg(CFTW0, (uint32_t)(freqStart * FREQ_REF));
@@ -59,6 +92,15 @@ void AD9959_SweepFreq(
 
     AD9959_Update();
 
+    //扫频直接写寄存器, 同步到暂存映像
+    for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+        if (channel & (AD9959_CHANNEL_0 << i)) {
+            channel_image[i].Reg[IMG_CFR] = 0x804314;
+            channel_image[i].Reg[IMG_CFTW0] = (uint32_t)(freqStart * FREQ_REF);
+            channel_image[i].Reg[IMG_CW1] = (uint32_t)(freqEnd * FREQ_REF);
+        }
+    }
+
     /*
         P3_LOW;
         DelayUs(50);
@@ -70,23 +112,143 @@ void AD9959_SweepFreq(
 
 void AD9959_SetFreq(uint8_t channel, uint32_t freq)
 {
-    WriteReg(CSR, channel);
-    WriteReg(CFTW0, (uint32_t)(freq * FREQ_REF));
-    AD9959_Update();
+    AD9959_StageFreq(channel, freq);
+    AD9959_Commit();
 }
 
 void AD9959_SetPhase(uint8_t channel, float phase)
 {
-    WriteReg(CSR, channel);
-    WriteReg(CPOW0, (uint32_t)(phase * PHASE_REF));
-    AD9959_Update();
+    AD9959_StagePhase(channel, phase);
+    AD9959_Commit();
 }
 
 void AD9959_SetAmp(uint8_t channel, uint16_t amp)
 {
-    //	WriteReg(CSR, channel, 0);
-    WriteReg(ACR, 0x00001000 + amp);
+    AD9959_StageAmp(channel, amp);
+    AD9959_Commit();
+}
+
+//暂存频率, channels 可以是多个通道的组合
+void AD9959_StageFreq(uint8_t channels, uint32_t freq)
+{
+    StageReg(channels, IMG_CFTW0, (uint32_t)(freq * FREQ_REF));
+}
+
+//暂存相位 (度)
+void AD9959_StagePhase(uint8_t channels, float phase)
+{
+    StageReg(channels, IMG_CPOW0, (uint32_t)(phase * PHASE_REF) & 0x3FFF);
+}
+
+//暂存幅度 (0 ~ 1023)
+void AD9959_StageAmp(uint8_t channels, uint16_t amp)
+{
+    StageReg(channels, IMG_ACR, 0x00001000 + (amp & 0x3FF));
+}
+
+//相位组: 按通道号从小到大依次设置 phase, phase + step, phase + 2 * step ...
+//例如 CH0|CH1, step = 90 得到一对正交信号
+void AD9959_StagePhaseGroup(uint8_t channels, float phase, float step)
+{
+    for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+        if (channels & (AD9959_CHANNEL_0 << i)) {
+            AD9959_StagePhase(AD9959_CHANNEL_0 << i, phase);
+            phase += step;
+        }
+    }
+}
+
+//二电平调制: Pn 引脚为低时输出 CFTW0/CPOW0/ACR, 为高时输出 CW1 中的值
+//value: FSK 为第二频率(Hz), PSK 为第二相位(度), ASK 为第二幅度(0 ~ 1023)
+void AD9959_StageModulation(uint8_t channels, AD9959_Modulation mod, float value)
+{
+    uint32_t word = 0;
+
+    switch (mod)
+    {
+        case AD9959_MOD_FSK: word = (uint32_t)(value * FREQ_REF); break;
+        case AD9959_MOD_PSK: word = ((uint32_t)(value * PHASE_REF) & 0x3FFF) << 18; break;
+        case AD9959_MOD_ASK: word = ((uint32_t)value & 0x3FF) << 22; break;
+        default:
+            break;
+    }
+
+    StageReg(channels, IMG_CFR, CFR_DAC_FULL_SCALE | mod);
+    StageReg(channels, IMG_CW1, word);
+}
+
+//写入所有暂存的寄存器, 一次IO_UPDATE同时生效
+void AD9959_Commit(void)
+{
+    WriteStagedRegs();
+    AD9959_Update();
+}
+
+//同上, 并在同一次IO_UPDATE清零所有通道的相位累加器,
+//使各通道间的相位差严格等于设定的相位偏移
+void AD9959_CommitCoherent(void)
+{
+    //先让自动清零相位累加器生效, CFR 单独写入, 其余暂存值留到下一次更新
+    for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+        WriteReg(CSR, AD9959_CHANNEL_0 << i);
+        WriteReg(CFR, channel_image[i].Reg[IMG_CFR] | CFR_AUTOCLEAR_PHASE);
+    }
     AD9959_Update();
+
+    //本次更新载入新参数并同步清零
+    AD9959_Commit();
+
+    //恢复CFR, 此次更新会再同步清零一次, 不影响各通道间的相位关系
+    for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+        channel_image[i].Dirty |= 1 << IMG_CFR;
+    }
+    AD9959_Commit();
+}
+
+//设置调制切换引脚, channels 中的通道输出 CW1 中的值
+void AD9959_SetProfilePins(uint8_t channels)
+{
+    if (channels & AD9959_CHANNEL_0) P0_HIGH; else P0_LOW;
+    if (channels & AD9959_CHANNEL_1) P1_HIGH; else P1_LOW;
+    if (channels & AD9959_CHANNEL_2) P2_HIGH; else P2_LOW;
+    if (channels & AD9959_CHANNEL_3) P3_HIGH; else P3_LOW;
+}
+
+//按寄存器写入暂存值, 数值相同的通道合并为一次CSR选择
+static void WriteStagedRegs(void)
+{
+    for (uint8_t r = 0; r < STAGED_REG_COUNT; r++)
+    {
+        uint8_t pending = 0;
+
+        for (uint8_t i = 0; i < AD9959_CHANNEL_COUNT; i++) {
+            if (channel_image[i].Dirty & (1 << r)) {
+                pending |= 1 << i;
+            }
+            channel_image[i].Dirty &= ~(1 << r);
+        }
+
+        while (pending)
+        {
+            uint8_t first = 0;
+            while (!(pending & (1 << first))) {
+                ++first;
+            }
+
+            uint32_t value = channel_image[first].Reg[r];
+            uint8_t group = 0;
+
+            for (uint8_t i = first; i < AD9959_CHANNEL_COUNT; i++) {
+                if ((pending & (1 << i)) && channel_image[i].Reg[r] == value) {
+                    group |= 1 << i;
+                }
+            }
+
+            WriteReg(CSR, group << 4);
+            WriteReg(staged_regs[r], value);
+            pending &= ~group;
+        }
+    }
 }
 
 static void WriteReg(uint8_t reg, uint32_t data)
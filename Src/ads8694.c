@@ -42,13 +42,14 @@ void ADS8694_ConfigSampling(int32_t *pBuffer, uint32_t count, uint8_t channel, u
 
     // Set input range
     for (uint8_t i = 0; i < 4; i++) {
-        if (channel & 1) {
+        if (channel & (1 << i)) {
             ADS8694_WriteReg(0x05 + i, inputRange);
         }
-        channel >>= 1;
     }
 
-    if (channel & (channel - 1) == 0) {
+    channel &= 0x0F;
+
+    if ((channel & (channel - 1)) == 0) {
         // Set single channel manual selection
         switch (channel)
         {
@@ -189,7 +190,7 @@ void TIM2_IRQHandler(void)
         // Read 18-bit ADC Code
         adc_code |= SPI_ReadWriteByte(&hspi2, 0xFF) << 10;
         adc_code |= SPI_ReadWriteByte(&hspi2, 0xFF) << 2;
-        adc_code |= SPI_ReadWriteByte(&hspi2, 0xFF);
+        adc_code |= SPI_ReadWriteByte(&hspi2, 0xFF) >> 6;
         sample_buffer[sample_index++] = adc_code;
 
         if (sample_index >= sample_count) {
@@ -0,0 +1,407 @@
+/**
+  ******************************************************************************
+  * @file       amp_calibration.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.2
+  * @brief      Output amplitude calibration store for PE4302 + AD9959 chain
+  *
+  * @note       Each band holds one calibrated {attenuation, DDS code} pair per
+  *             2mV level from 100mV down to 4mV, measured at the band's centre
+  *             frequency. Lookups interpolate the chain gain across levels and
+  *             between neighbouring bands, so any amplitude at any frequency
+  *             maps to a code. Tables are persisted in W25Qxx flash with a
+  *             CRC-protected header and loaded into RAM by AmpCal_Init().
+  *
+  *             Flash image layout (little-endian):
+  *               0  uint32  Magic "ACAL"
+  *               4  uint16  Version
+  *               6  uint8   Band count
+  *               7  uint8   Level count
+  *               8  uint32  Payload length
+  *               12 uint32  CRC-32 of payload
+  *               16 Payload: per band { uint32 frequency, uint16 entries[] }
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "amp_calibration.h"
+#include "crc32.h"
+#include "w25qxx.h"
+#include <math.h>
+
+/* Private Marcos ------------------------------------------------------------*/
+#define MAX_DDS_CODE                1023
+#define MAX_ATTENUATION             63
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Factory table measured at 20MHz, used when flash holds no valid image */
+static const uint16_t s_default_entries[AMP_CAL_LEVEL_COUNT] =
+{
+    AMP_CAL_ENTRY(15, 1018),    //100mV
+    AMP_CAL_ENTRY(16, 1020),    //98mV
+    AMP_CAL_ENTRY(16, 1000),    //96mV
+    AMP_CAL_ENTRY(16, 975),     //94mV
+    AMP_CAL_ENTRY(17, 1010),    //92mV
+    AMP_CAL_ENTRY(17, 985),     //90mV
+    AMP_CAL_ENTRY(18, 1015),    //88mV
+    AMP_CAL_ENTRY(18, 990),     //86mV
+    AMP_CAL_ENTRY(19, 1023),    //84mV
+    AMP_CAL_ENTRY(19, 1003),    //82mV
+    AMP_CAL_ENTRY(19, 971),     //80mV
+    AMP_CAL_ENTRY(19, 945),     //78mV
+    AMP_CAL_ENTRY(20, 1018),    //76mV
+    AMP_CAL_ENTRY(20, 992),     //74mV
+    AMP_CAL_ENTRY(21, 1018),    //72mV
+    AMP_CAL_ENTRY(21, 991),     //70mV
+    AMP_CAL_ENTRY(22, 1015),    //68mV
+    AMP_CAL_ENTRY(22, 983),     //66mV
+    AMP_CAL_ENTRY(23, 1008),    //64mV
+    AMP_CAL_ENTRY(23, 974),     //62mV
+    AMP_CAL_ENTRY(24, 1010),    //60mV
+    AMP_CAL_ENTRY(24, 978),     //58mV
+    AMP_CAL_ENTRY(25, 994),     //56mV
+    AMP_CAL_ENTRY(26, 1012),    //54mV
+    AMP_CAL_ENTRY(27, 1023),    //52mV
+    AMP_CAL_ENTRY(27, 985),     //50mV
+    AMP_CAL_ENTRY(28, 1020),    //48mV
+    AMP_CAL_ENTRY(28, 980),     //46mV
+    AMP_CAL_ENTRY(29, 990),     //44mV
+    AMP_CAL_ENTRY(30, 990),     //42mV
+    AMP_CAL_ENTRY(32, 986),     //40mV
+    AMP_CAL_ENTRY(33, 1023),    //38mV
+    AMP_CAL_ENTRY(34, 1017),    //36mV
+    AMP_CAL_ENTRY(35, 1015),    //34mV
+    AMP_CAL_ENTRY(35, 956),     //32mV
+    AMP_CAL_ENTRY(36, 985),     //30mV
+    AMP_CAL_ENTRY(38, 1023),    //28mV
+    AMP_CAL_ENTRY(39, 1007),    //26mV
+    AMP_CAL_ENTRY(40, 1001),    //24mV
+    AMP_CAL_ENTRY(42, 1023),    //22mV
+    AMP_CAL_ENTRY(43, 980),     //20mV
+    AMP_CAL_ENTRY(45, 1023),    //18mV
+    AMP_CAL_ENTRY(47, 1012),    //16mV
+    AMP_CAL_ENTRY(50, 1007),    //14mV
+    AMP_CAL_ENTRY(52, 995),     //12mV
+    AMP_CAL_ENTRY(56, 1023),    //10mV
+    AMP_CAL_ENTRY(59, 978),     //8mV
+    AMP_CAL_ENTRY(63, 942),     //6mV
+    AMP_CAL_ENTRY(63, 625),     //4mV
+};
+
+static AmpCal_TableTypeDef s_table;
+
+/* Linear gain of each PE4302 setting, 10^(-att / 40) */
+static float s_att_linear[MAX_ATTENUATION + 1];
+
+static uint8_t s_image[AMP_CAL_IMAGE_MAX_SIZE];
+
+/* Private function prototypes -----------------------------------------------*/
+static float GetChainGain(const AmpCal_BandTypeDef *band, uint8_t level);
+static inline void PutU16(uint8_t *buffer, uint16_t value);
+static inline void PutU32(uint8_t *buffer, uint32_t value);
+static inline uint16_t GetU16(const uint8_t *buffer);
+static inline uint32_t GetU32(const uint8_t *buffer);
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Loads calibration from flash, falls back to factory table
+  * @note   W25QXX_Init() must be called before this
+  * @retval None
+  */
+void AmpCal_Init(void)
+{
+    for (uint8_t i = 0; i <= MAX_ATTENUATION; i++) {
+        s_att_linear[i] = powf(10.0f, -i / 40.0f);
+    }
+
+    if (AmpCal_Load() != HAL_OK) {
+        AmpCal_LoadDefaults(&s_table);
+    }
+}
+
+/**
+  * @brief  Fills a table with the single factory band
+  * @param  table: Table to be filled
+  * @retval None
+  */
+void AmpCal_LoadDefaults(AmpCal_TableTypeDef *table)
+{
+    table->BandCount = 1;
+    table->Bands[0].Frequency = 20000;
+
+    for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+        table->Bands[0].Entries[i] = s_default_entries[i];
+    }
+}
+
+/**
+  * @brief  Reads and validates the calibration image in flash
+  * @retval HAL_OK if a valid image replaced the RAM table
+  */
+HAL_StatusTypeDef AmpCal_Load(void)
+{
+    AmpCal_TableTypeDef table;
+
+    W25QXX_Read(AMP_CAL_FLASH_ADDR, s_image, sizeof(s_image));
+
+    if (AmpCal_Deserialize(&table, s_image, sizeof(s_image)) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    s_table = table;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Writes the RAM table back to flash
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AmpCal_Save(void)
+{
+    uint32_t size = AmpCal_Serialize(&s_table, s_image, sizeof(s_image));
+
+    if (size == 0) {
+        return HAL_ERROR;
+    }
+
+    W25QXX_SectorErase(AMP_CAL_FLASH_ADDR);
+    W25QXX_Write(AMP_CAL_FLASH_ADDR, s_image, size);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Gets the table currently in use
+  * @retval Pointer to RAM table
+  */
+AmpCal_TableTypeDef *AmpCal_GetTable(void)
+{
+    return &s_table;
+}
+
+/**
+  * @brief  Adds or replaces the band measured at a frequency
+  * @param  freq: Band centre frequency (kHz)
+  * @param  entries: AMP_CAL_LEVEL_COUNT packed entries
+  * @retval HAL_ERROR if all band slots are taken
+  */
+HAL_StatusTypeDef AmpCal_SetBand(uint32_t freq, const uint16_t *entries)
+{
+    uint8_t index = 0;
+
+    while (index < s_table.BandCount && s_table.Bands[index].Frequency < freq) {
+        ++index;
+    }
+
+    if (index >= s_table.BandCount || s_table.Bands[index].Frequency != freq) {
+        if (s_table.BandCount >= AMP_CAL_MAX_BANDS) {
+            return HAL_ERROR;
+        }
+
+        /* Keep bands sorted by frequency */
+        for (uint8_t i = s_table.BandCount; i > index; i--) {
+            s_table.Bands[i] = s_table.Bands[i - 1];
+        }
+        ++s_table.BandCount;
+        s_table.Bands[index].Frequency = freq;
+    }
+
+    for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+        s_table.Bands[index].Entries[i] = entries[i];
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Gets attenuator and DDS settings for an output amplitude
+  * @note   The chain gain (output / drive) is interpolated linearly across
+  *         the two bracketing levels and the two bracketing bands, then the
+  *         DDS code is solved for the attenuation of the nearest entry.
+  * @param  freq: Output frequency (kHz)
+  * @param  amp_mv: Wanted output amplitude (mV)
+  * @param  att: Returns PE4302 attenuation (0.5dB units)
+  * @param  code: Returns AD9959 amplitude scale factor
+  * @retval None
+  */
+void AmpCal_Lookup(uint32_t freq, float amp_mv, uint8_t *att, uint16_t *code)
+{
+    /* Bracketing levels */
+    float pos = (AMP_CAL_MAX_LEVEL - amp_mv) / AMP_CAL_LEVEL_STEP;
+    pos = (pos < 0.0f) ? 0.0f : (pos > AMP_CAL_LEVEL_COUNT - 1) ? AMP_CAL_LEVEL_COUNT - 1 : pos;
+
+    uint8_t level = (pos >= AMP_CAL_LEVEL_COUNT - 1) ? AMP_CAL_LEVEL_COUNT - 2 : (uint8_t)pos;
+    float t = pos - level;
+
+    /* Bracketing bands */
+    uint8_t b1 = 0;
+    while (b1 < s_table.BandCount - 1 && s_table.Bands[b1].Frequency < freq) {
+        ++b1;
+    }
+    uint8_t b0 = (b1 > 0 && s_table.Bands[b1].Frequency >= freq) ? b1 - 1 : b1;
+
+    const AmpCal_BandTypeDef *band0 = &s_table.Bands[b0];
+    const AmpCal_BandTypeDef *band1 = &s_table.Bands[b1];
+
+    float u = 0.0f;
+    if (band1->Frequency > band0->Frequency) {
+        u = (float)((int32_t)freq - (int32_t)band0->Frequency) / (band1->Frequency - band0->Frequency);
+        u = (u < 0.0f) ? 0.0f : (u > 1.0f) ? 1.0f : u;
+    }
+
+    float g0 = GetChainGain(band0, level) + (GetChainGain(band0, level + 1) - GetChainGain(band0, level)) * t;
+    float g1 = GetChainGain(band1, level) + (GetChainGain(band1, level + 1) - GetChainGain(band1, level)) * t;
+    float gain = g0 + (g1 - g0) * u;
+
+    const AmpCal_BandTypeDef *nearest = (u < 0.5f) ? band0 : band1;
+    uint8_t a = AMP_CAL_ENTRY_ATT(nearest->Entries[(t < 0.5f) ? level : level + 1]);
+
+    if (gain <= 0.0f) {
+        *att = a;
+        *code = 0;
+        return;
+    }
+
+    /* Trade attenuation for DDS range when the solved code overflows,
+     * a code that only rounds to full scale doesn't count */
+    float c = amp_mv / (gain * s_att_linear[a]);
+    while (c >= MAX_DDS_CODE + 0.5f && a > 0) {
+        --a;
+        c = amp_mv / (gain * s_att_linear[a]);
+    }
+
+    *att = a;
+    *code = (c > MAX_DDS_CODE) ? MAX_DDS_CODE : (uint16_t)(c + 0.5f);
+}
+
+/**
+  * @brief  Packs a table into the flash image format
+  * @param  table: Source table
+  * @param  buffer: Destination buffer
+  * @param  size: Buffer size in bytes
+  * @retval Image size in bytes, 0 if buffer is too small or table is invalid
+  */
+uint32_t AmpCal_Serialize(const AmpCal_TableTypeDef *table, uint8_t *buffer, uint32_t size)
+{
+    uint32_t payload_size = table->BandCount * AMP_CAL_BAND_SIZE;
+
+    if (table->BandCount == 0 || table->BandCount > AMP_CAL_MAX_BANDS
+        || size < AMP_CAL_HEADER_SIZE + payload_size) {
+        return 0;
+    }
+
+    uint8_t *payload = buffer + AMP_CAL_HEADER_SIZE;
+
+    for (uint8_t b = 0; b < table->BandCount; b++) {
+        PutU32(payload, table->Bands[b].Frequency);
+        payload += 4;
+
+        for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+            PutU16(payload, table->Bands[b].Entries[i]);
+            payload += 2;
+        }
+    }
+
+    PutU32(buffer + 0, AMP_CAL_MAGIC);
+    PutU16(buffer + 4, AMP_CAL_VERSION);
+    buffer[6] = table->BandCount;
+    buffer[7] = AMP_CAL_LEVEL_COUNT;
+    PutU32(buffer + 8, payload_size);
+    PutU32(buffer + 12, CRC32_Update(CRC32_INIT_VALUE, buffer + AMP_CAL_HEADER_SIZE, payload_size));
+
+    return AMP_CAL_HEADER_SIZE + payload_size;
+}
+
+/**
+  * @brief  Unpacks and validates a flash image
+  * @param  table: Destination table, untouched on failure
+  * @param  buffer: Image data
+  * @param  size: Number of valid bytes in buffer
+  * @retval HAL_ERROR on bad magic, version, geometry, ordering or CRC
+  */
+HAL_StatusTypeDef AmpCal_Deserialize(AmpCal_TableTypeDef *table, const uint8_t *buffer, uint32_t size)
+{
+    if (size < AMP_CAL_HEADER_SIZE
+        || GetU32(buffer + 0) != AMP_CAL_MAGIC
+        || GetU16(buffer + 4) != AMP_CAL_VERSION
+        || buffer[7] != AMP_CAL_LEVEL_COUNT) {
+        return HAL_ERROR;
+    }
+
+    uint8_t band_count = buffer[6];
+    uint32_t payload_size = GetU32(buffer + 8);
+
+    if (band_count == 0 || band_count > AMP_CAL_MAX_BANDS
+        || payload_size != band_count * AMP_CAL_BAND_SIZE
+        || size < AMP_CAL_HEADER_SIZE + payload_size) {
+        return HAL_ERROR;
+    }
+
+    const uint8_t *payload = buffer + AMP_CAL_HEADER_SIZE;
+
+    if (CRC32_Update(CRC32_INIT_VALUE, payload, payload_size) != GetU32(buffer + 12)) {
+        return HAL_ERROR;
+    }
+
+    for (uint8_t b = 0; b < band_count; b++) {
+        table->Bands[b].Frequency = GetU32(payload);
+        payload += 4;
+
+        /* Lookup relies on ascending band frequencies */
+        if (b > 0 && table->Bands[b].Frequency <= table->Bands[b - 1].Frequency) {
+            return HAL_ERROR;
+        }
+
+        for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+            table->Bands[b].Entries[i] = GetU16(payload);
+            payload += 2;
+        }
+    }
+
+    table->BandCount = band_count;
+    return HAL_OK;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Gets output amplitude per unit of DDS code at a calibrated level
+  * @param  band: Calibration band
+  * @param  level: Level index
+  * @retval Chain gain (mV per code at 0dB attenuation)
+  */
+static float GetChainGain(const AmpCal_BandTypeDef *band, uint8_t level)
+{
+    uint16_t entry = band->Entries[level];
+    uint16_t code = AMP_CAL_ENTRY_CODE(entry);
+
+    if (code == 0) {
+        return 0.0f;
+    }
+
+    float amp_mv = AMP_CAL_MAX_LEVEL - AMP_CAL_LEVEL_STEP * level;
+    return amp_mv / (code * s_att_linear[AMP_CAL_ENTRY_ATT(entry)]);
+}
+
+static inline void PutU16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static inline void PutU32(uint8_t *buffer, uint32_t value)
+{
+    PutU16(buffer, (uint16_t)value);
+    PutU16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+static inline uint16_t GetU16(const uint8_t *buffer)
+{
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static inline uint32_t GetU32(const uint8_t *buffer)
+{
+    return GetU16(buffer) | ((uint32_t)GetU16(buffer + 2) << 16);
+}
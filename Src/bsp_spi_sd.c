@@ -269,6 +269,9 @@ __IO uint8_t SdStatus = SD_NOT_PRESENT;
 */
 uint16_t flag_SDHC = 0;
 
+/* Dummy bytes clocked out on reads and discarded bytes on writes, one block */
+static uint8_t s_block_buffer[512];
+
 /**
   * @}
   */
@@ -398,11 +401,7 @@ uint8_t BSP_SD_ReadBlocks(uint32_t *pData, uint32_t ReadAddr, uint32_t NumOfBloc
         goto error;
     }
 
-    ptr = malloc(sizeof(uint8_t)*BlockSize);
-    if (ptr == NULL)
-    {
-        goto error;
-    }
+    ptr = s_block_buffer;
     memset(ptr, SD_DUMMY_BYTE, sizeof(uint8_t)*BlockSize);
 
     /* Data transfer */
@@ -444,7 +443,6 @@ error:
   /* Send dummy byte: 8 Clock pulses of delay */
     SD_IO_CSState(1);
     SD_IO_WriteByte(SD_DUMMY_BYTE);
-    if (ptr != NULL) free(ptr);
 
     /* Return the reponse */
     return retr;
@@ -477,11 +475,7 @@ uint8_t BSP_SD_WriteBlocks(uint32_t *pData, uint32_t WriteAddr, uint32_t NumOfBl
         goto error;
     }
 
-    ptr = malloc(sizeof(uint8_t)*BlockSize);
-    if (ptr == NULL)
-    {
-        goto error;
-    }
+    ptr = s_block_buffer;
 
     /* Data transfer */
     while (NumOfBlocks--)
@@ -524,7 +518,6 @@ uint8_t BSP_SD_WriteBlocks(uint32_t *pData, uint32_t WriteAddr, uint32_t NumOfBl
     retr = BSP_SD_OK;
 
 error:
-    if (ptr != NULL) free(ptr);
     /* Send dummy byte: 8 Clock pulses of delay */
     SD_IO_CSState(1);
     SD_IO_WriteByte(SD_DUMMY_BYTE);
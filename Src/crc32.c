@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file       crc32.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.2
+  * @brief      Software CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320)
+  *
+  * @note       Matches zlib crc32(), so images and packets can be checked on
+  *             the host with standard tools. The on-chip CRC unit computes a
+  *             different (non-reflected) variant and is not used here.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crc32.h"
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Nibble-wise lookup table, 64 bytes of flash instead of 1KB */
+static const uint32_t s_crc32_table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Continues a CRC-32 over a block of data
+  * @param  crc: CRC of the preceding data, CRC32_INIT_VALUE to start a new one
+  * @param  data: Pointer to data
+  * @param  length: Number of bytes
+  * @retval Updated CRC
+  */
+uint32_t CRC32_Update(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    crc = ~crc;
+
+    while (length--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ s_crc32_table[crc & 0x0F];
+        crc = (crc >> 4) ^ s_crc32_table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
@@ -14,6 +14,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "curve_chart.h"
 #include "lcd.h"
+#include "sram.h"
 
 #if CHART_USE_FRAMEBUFFER
 #include "frame_buffer.h"
@@ -28,99 +29,257 @@
 #include "ili9325.h"
 #endif
 
+#include "frame_buffer.h"
+
+#if CHART_USE_SHADOW
+#include "fsmc.h"
+#endif // CHART_USE_SHADOW
 #endif // LCD_USE_BACKBUFFER 
 
+#if CHART_USE_SHADOW && CHART_USE_FRAMEBUFFER
+#error "Chart shadow replaces chart framebuffer, don't enable both"
+#endif
+
+/* Palette indices are kept by chart shadow or by an indexed framebuffer */
+#if CHART_USE_SHADOW
+#define CHART_INDEX_BITS            4
+#elif CHART_USE_FRAMEBUFFER
+#define CHART_INDEX_BITS            CHART_FRAMEBUFFER_INDEX_BITS
+#else
+#define CHART_INDEX_BITS            0
+#endif
+
+#define CHART_USE_PALETTE           (CHART_INDEX_BITS != 0)
+#define CHART_FRAMEBUFFER_INDEXED   (CHART_USE_FRAMEBUFFER && CHART_INDEX_BITS)
+
+#if CHART_USE_PALETTE && CHART_INDEX_BITS != 4 && CHART_INDEX_BITS != 8
+#error "Chart palette indices must be 4 or 8 bits"
+#endif
+
+/* Chart framebuffer, indices or shadow live in SRAM_CHART region of the SRAM map */
+#define CHART_USE_SRAM              (CHART_USE_FRAMEBUFFER || CHART_USE_SHADOW)
+#define CHART_SRAM_BITS             (CHART_USE_PALETTE ? CHART_INDEX_BITS : 16)
+
+#if CHART_USE_SRAM && CHART_MAX_WIDTH * CHART_MAX_HEIGHT * CHART_SRAM_BITS / 8 > SRAM_CHART_SIZE
+#error "Chart buffer is larger than its region in the SRAM map"
+#endif
+
+#if CHART_USE_SRAM && LCD_USE_FRAMEBUFFER \
+    && SRAM_CHART_OFFSET < SRAM_FRAMEBUFFER_OFFSET + SRAM_FRAMEBUFFER_SIZE \
+    && SRAM_FRAMEBUFFER_OFFSET < SRAM_CHART_OFFSET + SRAM_CHART_SIZE
+#error "Chart buffer overlaps LCD framebuffer in the SRAM map"
+#endif
+
 /* Private Marcos ------------------------------------------------------------*/
 #if CHART_USE_FRAMEBUFFER
 
 /* You can use other memory block as framebuffer as long as
  * it's big enough to store pixels in chart window (width * height * 2 bytes)
  */
-#define FRAMEBUFFER_BASE_ADDR       FSMC_SRAM_BASE_ADDR
+#define FRAMEBUFFER_BASE_ADDR       (FSMC_SRAM_BASE_ADDR + SRAM_CHART_OFFSET)
 
+/* Framebuffer must not be modified while DMA is still flushing it */
+#define CHART_WAIT_FRAME()          FrameBuffer_WaitFlush(&s_framebuffer, 1000)
+
+#if CHART_FRAMEBUFFER_INDEXED
+/* Indices take the place of pixels, dirty tiles are still tracked by s_framebuffer */
+#define INDEX_BASE_ADDR             FRAMEBUFFER_BASE_ADDR
+#define FB_WRITE_PIXEL(X, Y, COL)   CurveChart_WriteIndexedPixel(X, Y, COL)
+#define FB_READ_PIXEL(X, Y)         s_palette[CurveChart_ReadIndex(X, Y)]
+#else
+#define FB_WRITE_PIXEL(X, Y, COL)   FrameBuffer_WritePixel(&s_framebuffer, X, Y, COL)
+#define FB_READ_PIXEL(X, Y)         FrameBuffer_ReadPixel(&s_framebuffer, X, Y)
+#endif // CHART_FRAMEBUFFER_INDEXED
+#else
+/* Another framebuffer may be flushing through the LCD bus */
+#define CHART_WAIT_FRAME()          FrameBuffer_WaitBus()
 #endif
 
+#if CHART_USE_SHADOW
+/* Shadow takes the place chart framebuffer would use, two pixels per byte */
+#define INDEX_BASE_ADDR             (FSMC_SRAM_BASE_ADDR + SRAM_CHART_OFFSET)
+#define SHADOW_PIXEL(X, Y, COL)     CurveChart_WriteIndex(X, Y, CurveChart_GetPaletteIndex(COL))
+#define SHADOW_FILL(X, Y, W, H, COL) CurveChart_FillIndex(X, Y, W, H, CurveChart_GetPaletteIndex(COL))
+#else
+#define SHADOW_PIXEL(X, Y, COL)
+#define SHADOW_FILL(X, Y, W, H, COL)
+#endif // CHART_USE_SHADOW
+
+/* Palette entry i | PALETTE_INVERSE holds the inverse of entry i */
+#define PALETTE_SIZE                (1U << CHART_INDEX_BITS)
+#define PALETTE_INVERSE             (PALETTE_SIZE >> 1)
+
+/* Grid classes of a column or row, a pixel takes the higher class of both */
+#define GRID_CLASS_BACKGROUND       0
+#define GRID_CLASS_FINE             1
+#define GRID_CLASS_COARSE           2
+#define GRID_CLASS_COUNT            3
+
+/* Rows of a column not covered by a trace */
+#define SPAN_NONE_TOP               0xFFFF
+#define SPAN_NONE_BOTTOM            0
+
+/* Private Types -------------------------------------------------------------*/
+typedef struct
+{
+    uint16_t Top;
+    uint16_t Bottom;
+
+} CurveChart_SpanTypeDef;
+
 /* Private variables ---------------------------------------------------------*/
 #if CHART_USE_FRAMEBUFFER
 static FrameBufferTypeDef s_framebuffer;
 #endif // LCD_USE_BACKBUFFER 
 
+/* Grid class of each column / row, packed 2 bits per entry */
+static uint8_t s_column_class[(CHART_MAX_WIDTH + 3) / 4];
+static uint8_t s_row_class[(CHART_MAX_HEIGHT + 3) / 4];
+
+/* Pre-rendered background column for each column class */
+static uint16_t s_background_columns[GRID_CLASS_COUNT][CHART_MAX_HEIGHT];
+
+/* Rows each trace covers in each column and its color, as last drawn on screen */
+static CurveChart_SpanTypeDef s_trace_spans[CHART_MAX_TRACES][CHART_MAX_WIDTH];
+static uint16_t s_trace_colors[CHART_MAX_TRACES];
+
+/* Composed column or read back line, see CurveChart_ComposeColumn() */
+static uint16_t s_line_buffer[CHART_MAX_WIDTH];
+
+#if CHART_USE_PALETTE
+static __IO uint8_t *const s_indices = (__IO uint8_t *)INDEX_BASE_ADDR;
+static uint16_t s_index_stride;
+static uint16_t s_palette[PALETTE_SIZE];
+static uint8_t s_palette_count;             //Entries in use below PALETTE_INVERSE
+static uint16_t s_palette_last_color;       //Last lookup, spans and runs repeat colors
+static uint16_t s_palette_last_index = PALETTE_SIZE;
+#endif // CHART_USE_PALETTE
+
+#if CHART_FRAMEBUFFER_INDEXED
+/* Expanded lines, one is filled while DMA sends the other */
+static uint16_t s_flush_lines[2][CHART_MAX_WIDTH] __attribute__((aligned(4)));
+
+#if CHART_INDEX_BITS == 4
+/* Both pixels of an index byte, low nibble in the lower half word */
+static uint32_t s_pair_lut[256];
+static uint8_t s_pair_lut_dirty = 1;
+#endif
+#endif // CHART_FRAMEBUFFER_INDEXED
+
 /* Public Function Definitions -----------------------------------------------*/
 
 #if CHART_USE_FRAMEBUFFER 
 void CurveChart_Init(CurveChartTypeDef *chart)
 {
+    CHART_WAIT_FRAME();
+    CurveChart_BuildBackground(chart);
+    CurveChart_ResetTraces(chart);
     /* Draw border */
     LCD_DrawRect(chart->X - 1, chart->Y - 1, chart->Width + 1, chart->Height + 1, chart->BorderColor);
     /* Init backbuffer */
-    FrameBuffer_Init(&s_framebuffer, FRAMEBUFFER_BASE_ADDR, FSMC_LCD_DATA_ADDR, chart->X, chart->Y, chart->Width, chart->Height);
+    FrameBuffer_Init(&s_framebuffer, (__IO uint16_t *)FRAMEBUFFER_BASE_ADDR, (__IO uint16_t *)FSMC_LCD_DATA_ADDR, chart->X, chart->Y, chart->Width, chart->Height);
+#if CHART_FRAMEBUFFER_INDEXED
+    /* Background and grid come straight from the lookup tables */
+    CurveChart_ResetIndices(chart);
+#else
     /* Fill background */
     FrameBuffer_Clear(&s_framebuffer, chart->BackgroudColor);
     /* Draw fine grid - horizontal */
     for (size_t i = chart->FineGridHeight; i < chart->Height; i += chart->FineGridHeight) {
         for (size_t j = 0; j < chart->Width; j++) {
-            FrameBuffer_WritePixel(&s_framebuffer, j, i, chart->FineGridColor);
+            FB_WRITE_PIXEL(j, i, chart->FineGridColor);
         }
     }
     /* Draw fine grid - vertical */
     for (size_t i = chart->FineGridWidth; i < chart->Width; i += chart->FineGridWidth) {
         for (size_t j = 0; j < chart->Height; j++) {
-            FrameBuffer_WritePixel(&s_framebuffer, i, j, chart->FineGridColor);
+            FB_WRITE_PIXEL(i, j, chart->FineGridColor);
         }
     }
     /* Draw coarse grid - horizontal */
     for (size_t i = chart->CoarseGridHeight; i < chart->Height; i += chart->CoarseGridHeight) {
         for (size_t j = 0; j < chart->Width; j++) {
-            FrameBuffer_WritePixel(&s_framebuffer, j, i, chart->CoarseGridColor);
+            FB_WRITE_PIXEL(j, i, chart->CoarseGridColor);
         }
     }
     /* Draw coarse grid - vertical */
     for (size_t i = chart->CoarseGridWidth; i < chart->Width; i += chart->CoarseGridWidth) {
         for (size_t j = 0; j < chart->Height; j++) {
-            FrameBuffer_WritePixel(&s_framebuffer, i, j, chart->CoarseGridColor);
+            FB_WRITE_PIXEL(i, j, chart->CoarseGridColor);
         }
     }
+#endif // CHART_FRAMEBUFFER_INDEXED
 }
 #else
 void CurveChart_Init(CurveChartTypeDef *chart)
 {
+    CHART_WAIT_FRAME();
+    CurveChart_BuildBackground(chart);
+    CurveChart_ResetTraces(chart);
     /* Draw border */
     LCD_DrawRect(chart->X - 1, chart->Y - 1, chart->Width + 1, chart->Height + 1, chart->BorderColor);
     /* Fill background */
     LCD_FillRect(chart->X, chart->Y, chart->Width, chart->Height, chart->BackgroudColor);
+    /* Fine grid first, so crossings take coarse grid color as when erasing */
     /* Draw fine grid - horizontal */
     for (size_t i = chart->FineGridHeight; i < chart->Height; i += chart->FineGridHeight) {
         LCD_DrawHLine(chart->X, i + chart->Y, chart->Width, chart->FineGridColor);
     }
-    /* Draw coarse grid - horizontal */
-    for (size_t i = chart->CoarseGridHeight; i < chart->Height; i += chart->CoarseGridHeight) {
-        LCD_DrawHLine(chart->X, i + chart->Y, chart->Width, chart->CoarseGridColor);
-    }
     /* Draw fine grid - vertical */
     for (size_t i = chart->FineGridWidth; i < chart->Width; i += chart->FineGridWidth) {
         LCD_DrawVLine(i + chart->X, chart->Y, chart->Height, chart->FineGridColor);
     }
+    /* Draw coarse grid - horizontal */
+    for (size_t i = chart->CoarseGridHeight; i < chart->Height; i += chart->CoarseGridHeight) {
+        LCD_DrawHLine(chart->X, i + chart->Y, chart->Width, chart->CoarseGridColor);
+    }
     /* Draw coarse grid - vertical */
     for (size_t i = chart->CoarseGridWidth; i < chart->Width; i += chart->CoarseGridWidth) {
         LCD_DrawVLine(i + chart->X, chart->Y, chart->Height, chart->CoarseGridColor);
     }
+
+#if CHART_USE_SHADOW
+    CurveChart_ResetIndices(chart);
+#endif // CHART_USE_SHADOW
 }
 #endif // CHART_USE_FRAMEBUFFER 
 
 #if CHART_USE_FRAMEBUFFER
 /**
-  * @brief  Update pixels in framebuffer to chart area on screen
+  * @brief  Starts updating pixels in framebuffer to chart area on screen
+  * @note   Returns right after DMA starts, chart drawing functions wait for
+  *         the flush to finish. Call FrameBuffer_WaitBus() before drawing
+  *         other things on LCD.
+  *         An indexed framebuffer is expanded by CPU while the previous line
+  *         is sent, and only the last line is still on the bus on return.
   * @param  None
   * @retval None
   */
 void CurveChart_FrameUpdate(void)
 {
-    FrameBuffer_Update(&s_framebuffer);
+#if CHART_FRAMEBUFFER_INDEXED
+    CurveChart_FlushIndexed();
+#else
+    FrameBuffer_WaitFlush(&s_framebuffer, 1000);
+    FrameBuffer_WaitBus();
+    FrameBuffer_UpdateAsync(&s_framebuffer);
+#endif // CHART_FRAMEBUFFER_INDEXED
+}
+
+/**
+  * @brief  Checks whether chart framebuffer is still flushing to screen
+  * @param  None
+  * @retval Non-zero while flushing
+  */
+uint8_t CurveChart_IsFrameBusy(void)
+{
+    return FrameBuffer_IsFlushing(&s_framebuffer);
 }
 #endif // LCD_USE_BACKBUFFER 
 
 void CurveChart_DrawBitmap(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap_buffer)
 {
+    CHART_WAIT_FRAME();
     if (y >= chart->Height) {
         return;
     }
@@ -136,16 +295,96 @@ void CurveChart_DrawBitmap(const CurveChartTypeDef *chart, uint16_t x, uint16_t
                 continue;
             }
 #if CHART_USE_FRAMEBUFFER 
-            FrameBuffer_WritePixel(&s_framebuffer, x + j, y + i, bitmap_buffer[i * width + j]);
+            FB_WRITE_PIXEL(x + j, y + i, bitmap_buffer[i * width + j]);
 #else
             WRITE_PIXEL(chart->X + x + j, chart->Y + y + i, bitmap_buffer[i * width + j]);
+            SHADOW_PIXEL(x + j, y + i, bitmap_buffer[i * width + j]);
 #endif // CHART_USE_FRAMEBUFFER 
         }
     }
 }
 
+/**
+  * @brief  Draws a run-length encoded sprite in chart
+  * @note   Like CurveChart_DrawBitmap(), y counts up from the chart bottom to
+  *         the sprite's top row. Runs are clipped to the chart area.
+  * @param  chart: Chart to draw in
+  * @param  x: Sprite left column in chart, may be negative
+  * @param  y: Sprite top row, counted from chart bottom
+  * @param  sprite: Sprite to draw
+  * @retval None
+  */
+void CurveChart_DrawSprite(const CurveChartTypeDef *chart, int16_t x, uint16_t y, const SpriteTypeDef *sprite)
+{
+    CHART_WAIT_FRAME();
+    if (y >= chart->Height) {
+        return;
+    }
+
+    const uint16_t *data = sprite->Data;
+    int16_t top = chart->Height - y;
+
+    for (int16_t row = top; row < top + (int16_t)sprite->Height; row++)
+    {
+        uint16_t run_count = *(data++);
+        int16_t column = x;
+
+        for (uint16_t i = 0; i < run_count; i++)
+        {
+            column += *(data++);
+            int16_t length = *(data++);
+            const uint16_t *pixels = data;
+            int16_t start = column;
+
+            data += length;
+            column += length;
+
+            /* Clip run to chart area */
+            if (row >= chart->Height) {
+                continue;
+            }
+            if (start < 0) {
+                pixels -= start;
+                length += start;
+                start = 0;
+            }
+            if (start + length > chart->Width) {
+                length = chart->Width - start;
+            }
+            if (length <= 0) {
+                continue;
+            }
+
+#if CHART_FRAMEBUFFER_INDEXED
+            for (int16_t j = 0; j < length; j++) {
+                FB_WRITE_PIXEL(start + j, row, pixels[j]);
+            }
+#elif CHART_USE_FRAMEBUFFER
+            __IO uint16_t *dst = s_framebuffer.PixelData + s_framebuffer.Width * row + start;
+            for (int16_t j = 0; j < length; j++) {
+                dst[j] = pixels[j];
+            }
+            FrameBuffer_MarkDirty(&s_framebuffer, start, row, length, 1);
+#else
+            SET_WINDOW(chart->X + start, chart->Y + row, length, 1);
+            PREPARE_WRITE();
+            for (int16_t j = 0; j < length; j++) {
+                WRITE_GRAM(pixels[j]);
+                SHADOW_PIXEL(start + j, row, pixels[j]);
+            }
+#endif // CHART_USE_FRAMEBUFFER
+        }
+    }
+
+#if !CHART_USE_FRAMEBUFFER
+    LCD_ResetWindow();
+#endif
+}
+
 void CurveChart_RecoverRect(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
 { 
+    CHART_WAIT_FRAME();
+
     if (y >= chart->Height) {
         return;
     }
@@ -154,13 +393,18 @@ void CurveChart_RecoverRect(const CurveChartTypeDef *chart, uint16_t x, uint16_t
 
     for (uint16_t i = 0; i < height; i++)
     {
-        for (uint16_t j = 0; j < width; j++)
+        if (y + i >= chart->Height) {
+            break;
+        }
+
+        for (uint16_t j = 0; j < width && x + j < chart->Width; j++)
         {
             uint16_t pixel_color = CurveChart_GetRecoverPixelColor(chart, x + j, y + i);
 #if CHART_USE_FRAMEBUFFER 
-            FrameBuffer_WritePixel(&s_framebuffer, x + j, y + i, pixel_color);
+            FB_WRITE_PIXEL(x + j, y + i, pixel_color);
 #else
             WRITE_PIXEL(chart->X + x + j, chart->Y + y + i, pixel_color);
+            SHADOW_PIXEL(x + j, y + i, pixel_color);
 #endif // CHART_USE_FRAMEBUFFER 
 
         }
@@ -169,6 +413,8 @@ void CurveChart_RecoverRect(const CurveChartTypeDef *chart, uint16_t x, uint16_t
 
 void CurveChart_DrawCurve(const CurveChartTypeDef *chart, const uint16_t *data, uint16_t color)
 {
+    CHART_WAIT_FRAME();
+#if CHART_USE_FRAMEBUFFER
     uint16_t y0, y1, temp;
 
     for (uint16_t i = 0; i < chart->Width - 1; i++)
@@ -191,169 +437,889 @@ void CurveChart_DrawCurve(const CurveChartTypeDef *chart, const uint16_t *data,
         y1 = chart->Height - y1 - 1;
 
         for (uint16_t j = y1; j <= y0; j++) {
-#if CHART_USE_FRAMEBUFFER 
-            FrameBuffer_WritePixel(&s_framebuffer, i, j, color);
-#else
-            WRITE_PIXEL(chart->X + i, chart->Y + j, color);
-#endif // GRPAH_USE_BACKBUFFER
+            FB_WRITE_PIXEL(i, j, color);
         }
     }
+#else
+    CurveChart_DrawTraceSpans(chart, data, color, 0);
+#endif // CHART_USE_FRAMEBUFFER
 }
 
 void CurveChart_DrawLineX(const CurveChartTypeDef *chart, uint16_t x, uint16_t color)
 {
+    CHART_WAIT_FRAME();
     if (x > chart->Width) return;
 
+#if CHART_USE_FRAMEBUFFER 
     for (uint16_t i = 0; i < chart->Height; i++)
     {
-#if CHART_USE_FRAMEBUFFER 
-        FrameBuffer_WritePixel(&s_framebuffer, x, i, color);
+        FB_WRITE_PIXEL(x, i, color);
+    }
 #else
-        WRITE_PIXEL(chart->X + x, chart->Y + i, color);
+    CurveChart_WriteSpan(chart, x, 0, 1, chart->Height, color, 0);
+    LCD_ResetWindow();
 #endif // CHART_USE_FRAMEBUFFER 
-    }
 }
 
 void CurveChart_DrawDashedLineX(const CurveChartTypeDef *chart, uint16_t x, uint16_t color)
 {
+    CHART_WAIT_FRAME();
     if (x > chart->Width) return;
     uint8_t pixel_count = 0;
+#if !CHART_USE_FRAMEBUFFER
+    uint16_t dash_start = 0;
+#endif // !CHART_USE_FRAMEBUFFER
 
     for (uint16_t i = 0; i < chart->Height; i++)
     {
         ++pixel_count;
 
         if (pixel_count > 4) {
+#if !CHART_USE_FRAMEBUFFER
+            /* One window per dash */
+            CurveChart_WriteSpan(chart, x, dash_start, 1, i - dash_start, color, 0);
+            dash_start = i + 2;
+#endif // !CHART_USE_FRAMEBUFFER
             i += 2;
             pixel_count = 0;
         }
 #if CHART_USE_FRAMEBUFFER 
-        FrameBuffer_WritePixel(&s_framebuffer, x, i, color);
-#else
-        WRITE_PIXEL(chart->X + x, chart->Y + i, color);
+        FB_WRITE_PIXEL(x, i, color);
 #endif // CHART_USE_FRAMEBUFFER 
+    }
 
+#if !CHART_USE_FRAMEBUFFER
+    if (dash_start < chart->Height) {
+        CurveChart_WriteSpan(chart, x, dash_start, 1, chart->Height - dash_start, color, 0);
     }
+    LCD_ResetWindow();
+#endif // !CHART_USE_FRAMEBUFFER
 }
 
 
 void CurveChart_DrawLineY(const CurveChartTypeDef *chart, uint16_t y, uint16_t color)
 {
+    CHART_WAIT_FRAME();
     if (y > chart->Height) {
         return; 
     }
 
+#if CHART_USE_FRAMEBUFFER 
     for (uint16_t i = 0; i < chart->Width; i++)
     {
-#if CHART_USE_FRAMEBUFFER 
-        FrameBuffer_WritePixel(&s_framebuffer, i, chart->Height - y, color);
+        FB_WRITE_PIXEL(i, chart->Height - y, color);
+    }
 #else
-        WRITE_PIXEL(chart->X + i, chart->Y + chart->Height - y, color);
+    CurveChart_WriteSpan(chart, 0, chart->Height - y, chart->Width, 1, color, 0);
+    LCD_ResetWindow();
 #endif // CHART_USE_FRAMEBUFFER 
-    }
 }
 
 void CurveChart_DrawDashedLineY(const CurveChartTypeDef *chart, uint16_t y, uint16_t color)
 {
+    CHART_WAIT_FRAME();
     if (y > chart->Height) {
         return;
     }
 
     uint8_t pixel_count = 0;
+#if !CHART_USE_FRAMEBUFFER
+    uint16_t dash_start = 0;
+#endif // !CHART_USE_FRAMEBUFFER
 
     for (uint16_t i = 0; i < chart->Width; i++)
     {
         ++pixel_count;
 
         if (pixel_count > 4) {
+#if !CHART_USE_FRAMEBUFFER
+            /* One window per dash */
+            CurveChart_WriteSpan(chart, dash_start, chart->Height - y, i - dash_start, 1, color, 0);
+            dash_start = i + 2;
+#endif // !CHART_USE_FRAMEBUFFER
             i += 2;
             pixel_count = 0;
         }
 #if CHART_USE_FRAMEBUFFER 
-        FrameBuffer_WritePixel(&s_framebuffer, i, chart->Height - y, color);
-#else
-        WRITE_PIXEL(chart->X + i, chart->Y + chart->Height - y, color);
+        FB_WRITE_PIXEL(i, chart->Height - y, color);
 #endif // CHART_USE_FRAMEBUFFER 
     }
+
+#if !CHART_USE_FRAMEBUFFER
+    if (dash_start < chart->Width) {
+        CurveChart_WriteSpan(chart, dash_start, chart->Height - y, chart->Width - dash_start, 1, color, 0);
+    }
+    LCD_ResetWindow();
+#endif // !CHART_USE_FRAMEBUFFER
 }
 
 void CurveChart_RecoverGrid(const CurveChartTypeDef *chart, const uint16_t *data)
 {
-    uint16_t y0, y1, temp;
-    uint16_t pixel_color;
+    CHART_WAIT_FRAME();
+#if CHART_USE_FRAMEBUFFER
+    uint16_t top, bottom;
 
     for (uint16_t i = 0; i < chart->Width - 1; i++)
     {
-        if (data[i] < data[i + 1]) {
-            y0 = data[i];
-            y1 = data[i + 1];
+        if (CurveChart_GetColumnSpan(chart, data, i, &top, &bottom)) {
+            CurveChart_WriteColumn(chart, i, top, bottom);
+        }
+    }
+#else
+    CurveChart_DrawTraceSpans(chart, data, 0, 1);
+#endif // CHART_USE_FRAMEBUFFER
+}
+
+void CurveChart_RecoverLineX(const CurveChartTypeDef *chart, uint16_t x)
+{
+    CHART_WAIT_FRAME();
+    if (x > chart->Width) return;
+#if CHART_USE_FRAMEBUFFER 
+    CurveChart_WriteColumn(chart, x, 0, chart->Height - 1);
+#else
+    CurveChart_WriteSpan(chart, x, 0, 1, chart->Height, 0, 1);
+    LCD_ResetWindow();
+#endif // CHART_USE_FRAMEBUFFER 
+}
+
+void CurveChart_RecoverLineY(const CurveChartTypeDef *chart, uint16_t y)
+{
+    CHART_WAIT_FRAME();
+    if (y > chart->Height) return;
+#if CHART_USE_FRAMEBUFFER 
+    uint16_t pixel_color;
+
+    for (uint16_t i = 0; i < chart->Width; i++)
+    {
+        pixel_color = CurveChart_GetRecoverPixelColor(chart, i, chart->Height - y);
+        FB_WRITE_PIXEL(i, chart->Height - y, pixel_color);
+    }
+#else
+    CurveChart_WriteSpan(chart, 0, chart->Height - y, chart->Width, 1, 0, 1);
+    LCD_ResetWindow();
+#endif // CHART_USE_FRAMEBUFFER 
+}
+
+/**
+  * @brief  Sets values and color of a trace managed by chart
+  * @note   Values are referenced, not copied, and read on every
+  *         CurveChart_UpdateTraces(). Nothing is drawn until then.
+  * @param  trace: Trace index, less than CHART_MAX_TRACES
+  * @param  values: One value per column counted from chart bottom, NULL to hide
+  * @param  color: Trace color
+  * @retval None
+  */
+void CurveChart_SetTrace(CurveChartTypeDef *chart, uint8_t trace, const uint16_t *values, uint16_t color)
+{
+    if (trace >= CHART_MAX_TRACES) {
+        return;
+    }
+
+    chart->Traces[trace].Values = values;
+    chart->Traces[trace].Color = color;
+}
+
+/**
+  * @brief  Brings all traces of chart on screen up to date
+  * @note   Erasing and redrawing are merged per column: rows covered by any
+  *         trace before or now are composed from grid background and traces
+  *         in one buffer, and written through a single 1 x N window. Columns
+  *         where no trace moved are not touched at all, so each column is
+  *         written at most once however many traces overlap, and traces never
+  *         erase each other. Lines and rects drawn over traces are overwritten
+  *         in changed columns, draw them again afterwards.
+  * @param  chart: Chart to update
+  * @retval None
+  */
+void CurveChart_UpdateTraces(const CurveChartTypeDef *chart)
+{
+    uint8_t recolor[CHART_MAX_TRACES];
+
+    CHART_WAIT_FRAME();
+
+    for (uint8_t t = 0; t < CHART_MAX_TRACES; t++)
+    {
+        recolor[t] = (chart->Traces[t].Color != s_trace_colors[t]);
+        s_trace_colors[t] = chart->Traces[t].Color;
+    }
+
+    for (uint16_t x = 0; x < chart->Width - 1; x++)
+    {
+        uint16_t top = SPAN_NONE_TOP;
+        uint16_t bottom = SPAN_NONE_BOTTOM;
+
+        for (uint8_t t = 0; t < CHART_MAX_TRACES; t++)
+        {
+            CurveChart_SpanTypeDef *span = &s_trace_spans[t][x];
+            uint16_t new_top = SPAN_NONE_TOP;
+            uint16_t new_bottom = SPAN_NONE_BOTTOM;
+
+            if (chart->Traces[t].Values != NULL) {
+                CurveChart_GetColumnSpan(chart, chart->Traces[t].Values, x, &new_top, &new_bottom);
+            }
+
+            if (new_top == span->Top && new_bottom == span->Bottom && !(recolor[t] && new_top <= new_bottom)) {
+                continue;
+            }
+
+            /* Rewrite rows covered before and now, the empty span is neutral here */
+            top = (span->Top < top) ? span->Top : top;
+            top = (new_top < top) ? new_top : top;
+            bottom = (span->Bottom > bottom) ? span->Bottom : bottom;
+            bottom = (new_bottom > bottom) ? new_bottom : bottom;
+
+            span->Top = new_top;
+            span->Bottom = new_bottom;
+        }
+
+        if (top <= bottom) {
+            CurveChart_WriteColumn(chart, x, top, bottom);
+        }
+    }
+
+#if !CHART_USE_FRAMEBUFFER
+    LCD_ResetWindow();
+#endif // !CHART_USE_FRAMEBUFFER
+}
+
+/**
+  * @brief  Reads back a chart pixel
+  * @note   Unlike drawing functions, y counts down from the chart top as rows
+  *         on screen. Comes from framebuffer or shadow if there is one,
+  *         otherwise from a slow GRAM read.
+  * @param  x, y: Pixel position in chart area
+  * @retval Pixel color (RGB565 format)
+  */
+uint16_t CurveChart_ReadPixel(const CurveChartTypeDef *chart, uint16_t x, uint16_t y)
+{
+    CHART_WAIT_FRAME();
+#if CHART_USE_FRAMEBUFFER
+    return FB_READ_PIXEL(x, y);
+#elif CHART_USE_SHADOW
+    return s_palette[CurveChart_ReadIndex(x, y)];
+#else
+    return READ_PIXEL(chart->X + x, chart->Y + y);
+#endif // CHART_USE_FRAMEBUFFER
+}
+
+/**
+  * @brief  Reads back a whole row of chart pixels, e.g. for screenshots
+  * @param  y: Row index, counted down from the chart top
+  * @param  buffer: Returns chart->Width pixels (RGB565 format)
+  * @retval None
+  */
+void CurveChart_ReadLine(const CurveChartTypeDef *chart, uint16_t y, uint16_t *buffer)
+{
+    CHART_WAIT_FRAME();
+#if CHART_USE_FRAMEBUFFER
+    for (uint16_t i = 0; i < chart->Width; i++) {
+        buffer[i] = FB_READ_PIXEL(i, y);
+    }
+#elif CHART_USE_SHADOW
+    for (uint16_t i = 0; i < chart->Width; i++) {
+        buffer[i] = s_palette[CurveChart_ReadIndex(i, y)];
+    }
+#else
+    READ_LINE(chart->X, chart->Y + y, chart->Width, buffer);
+    /* Reading narrowed the GRAM window to the row */
+    LCD_ResetWindow();
+#endif // CHART_USE_FRAMEBUFFER
+}
+
+/**
+  * @brief  Draws a vertical XOR cursor, inverting the chart pixels under it
+  * @note   Drawing it again at the same place restores the pixels, there is
+  *         no need to erase or redraw what's under it.
+  * @param  x: Column index in chart area
+  * @retval None
+  */
+void CurveChart_XorLineX(const CurveChartTypeDef *chart, uint16_t x)
+{
+    CHART_WAIT_FRAME();
+    if (x >= chart->Width) {
+        return;
+    }
+
+    CurveChart_XorSpan(chart, x, 0, 1, chart->Height);
+}
+
+/**
+  * @brief  Draws a horizontal XOR cursor, inverting the chart pixels under it
+  * @note   Same position as CurveChart_DrawLineY(), drawing it again restores
+  *         the pixels.
+  * @param  y: Height counted from chart bottom
+  * @retval None
+  */
+void CurveChart_XorLineY(const CurveChartTypeDef *chart, uint16_t y)
+{
+    CHART_WAIT_FRAME();
+    if (y == 0 || y > chart->Height) {
+        return;
+    }
+
+    CurveChart_XorSpan(chart, 0, chart->Height - y, chart->Width, 1);
+}
+
+#if LCD_USE_FATFS
+/**
+  * @brief  Saves the chart area to a 16-bit BMP file
+  * @note   Rows come from CurveChart_ReadLine(), so with framebuffer or
+  *         shadow the file is written without GRAM reads.
+  * @param  file_name: Bitmap filename, overwritten if exists
+  * @retval HAL_OK on success, HAL_ERROR if the file can't be written
+  */
+HAL_StatusTypeDef CurveChart_SaveBmpToFile(const CurveChartTypeDef *chart, const uint8_t *file_name)
+{
+    return LCD_SaveBmpLinesToFile(file_name, chart->Width, chart->Height, CurveChart_ReadBmpLine, chart);
+}
+#endif // LCD_USE_FATFS
+
+/**
+  * @brief  Gets the color a chart pixel is restored to
+  * @note   Traces managed by chart are kept, only grid shows under other things
+  * @param  x0, y0: Pixel position in chart area
+  * @retval Pixel color
+  */
+static inline uint16_t CurveChart_GetRecoverPixelColor(const CurveChartTypeDef *chart, uint16_t x0, uint16_t y0)
+{
+    uint16_t color = CurveChart_GetBackgroundColumn(x0)[y0];
+
+    for (uint8_t t = 0; t < CHART_MAX_TRACES; t++)
+    {
+        if (s_trace_spans[t][x0].Top <= y0 && y0 <= s_trace_spans[t][x0].Bottom) {
+            color = s_trace_colors[t];
+        }
+    }
+    return color;
+}
+
+/**
+  * @brief  Gets the pre-rendered grid background of a chart column
+  * @param  x0: Column index in chart area
+  * @retval Pointer to background colors of the column, indexed by row
+  */
+static inline const uint16_t *CurveChart_GetBackgroundColumn(uint16_t x0)
+{
+    return s_background_columns[CurveChart_GetGridClass(s_column_class, x0)];
+}
+
+static inline uint8_t CurveChart_GetGridClass(const uint8_t *table, uint16_t i)
+{
+    return (table[i >> 2] >> ((i & 3) << 1)) & 0x03;
+}
+
+/**
+  * @brief  Builds grid class tables and background columns of a chart
+  * @note   Replaces per-pixel modulo operations on grid sizes when erasing
+  * @param  chart: Chart whose grid will be recovered
+  * @retval None
+  */
+static void CurveChart_BuildBackground(const CurveChartTypeDef *chart)
+{
+    const uint16_t class_colors[GRID_CLASS_COUNT] = {
+        chart->BackgroudColor, chart->FineGridColor, chart->CoarseGridColor,
+    };
+    uint8_t column_class, row_class;
+
+    for (uint16_t i = 0; i < CHART_MAX_WIDTH; i++)
+    {
+        if (i % chart->CoarseGridWidth == 0) {
+            column_class = GRID_CLASS_COARSE;
+        }
+        else if (i % chart->FineGridWidth == 0) {
+            column_class = GRID_CLASS_FINE;
         }
         else {
-            y1 = data[i];
-            y0 = data[i + 1];
+            column_class = GRID_CLASS_BACKGROUND;
         }
 
-        if (y0 >= chart->Height) {
-            continue;
+        s_column_class[i >> 2] &= ~(0x03 << ((i & 3) << 1));
+        s_column_class[i >> 2] |= column_class << ((i & 3) << 1);
+    }
+
+    for (uint16_t i = 0; i < CHART_MAX_HEIGHT; i++)
+    {
+        if (i % chart->CoarseGridHeight == 0) {
+            row_class = GRID_CLASS_COARSE;
+        }
+        else if (i % chart->FineGridHeight == 0) {
+            row_class = GRID_CLASS_FINE;
+        }
+        else {
+            row_class = GRID_CLASS_BACKGROUND;
         }
-        y1 = (y1 < chart->Height) ? y1 : chart->Height - 1;
 
-        y0 = chart->Height - y0 - 1;
-        y1 = chart->Height - y1 - 1;
+        s_row_class[i >> 2] &= ~(0x03 << ((i & 3) << 1));
+        s_row_class[i >> 2] |= row_class << ((i & 3) << 1);
+
+        /* A pixel takes the higher class of its column and row */
+        for (uint8_t j = 0; j < GRID_CLASS_COUNT; j++) {
+            s_background_columns[j][i] = class_colors[(row_class > j) ? row_class : j];
+        }
+    }
+}
+
+/**
+  * @brief  Hides all traces of chart and forgets what was drawn
+  * @param  chart: Chart just cleared to grid background
+  * @retval None
+  */
+static void CurveChart_ResetTraces(CurveChartTypeDef *chart)
+{
+    for (uint8_t t = 0; t < CHART_MAX_TRACES; t++)
+    {
+        chart->Traces[t].Values = NULL;
+        s_trace_colors[t] = chart->Traces[t].Color;
+
+        for (uint16_t i = 0; i < CHART_MAX_WIDTH; i++) {
+            s_trace_spans[t][i].Top = SPAN_NONE_TOP;
+            s_trace_spans[t][i].Bottom = SPAN_NONE_BOTTOM;
+        }
+    }
+}
+
+/**
+  * @brief  Composes grid background and traces of a column part
+  * @param  x: Column index in chart area
+  * @param  top, bottom: First and last row to compose
+  * @retval Pointer to composed colors, indexed by row - top. Valid until next call
+  */
+static const uint16_t *CurveChart_ComposeColumn(uint16_t x, uint16_t top, uint16_t bottom)
+{
+    const uint16_t *background = CurveChart_GetBackgroundColumn(x);
+
+    for (uint16_t i = top; i <= bottom; i++) {
+        s_line_buffer[i - top] = background[i];
+    }
+
+    for (uint8_t t = 0; t < CHART_MAX_TRACES; t++)
+    {
+        uint16_t span_top = s_trace_spans[t][x].Top;
+        uint16_t span_bottom = s_trace_spans[t][x].Bottom;
 
-        for (uint16_t j = y1; j <= y0; j++)
+        span_top = (span_top > top) ? span_top : top;
+        span_bottom = (span_bottom < bottom) ? span_bottom : bottom;
+
+        for (uint16_t i = span_top; i <= span_bottom; i++) {
+            s_line_buffer[i - top] = s_trace_colors[t];
+        }
+    }
+
+    return s_line_buffer;
+}
+
+/**
+  * @brief  Restores a column part to grid background with traces on it
+  * @note   Without framebuffer, GRAM window is left set to the column, call
+  *         LCD_ResetWindow() when done.
+  * @param  x: Column index in chart area
+  * @param  top, bottom: First and last row to restore
+  * @retval None
+  */
+static void CurveChart_WriteColumn(const CurveChartTypeDef *chart, uint16_t x, uint16_t top, uint16_t bottom)
+{
+#if CHART_FRAMEBUFFER_INDEXED
+    const uint16_t *column = CurveChart_ComposeColumn(x, top, bottom);
+
+    for (uint16_t i = 0; i <= bottom - top; i++) {
+        CurveChart_WriteIndex(x, top + i, CurveChart_GetPaletteIndex(column[i]));
+    }
+    FrameBuffer_MarkDirty(&s_framebuffer, x, top, 1, bottom - top + 1);
+#elif CHART_USE_FRAMEBUFFER
+    const uint16_t *column = CurveChart_ComposeColumn(x, top, bottom);
+    __IO uint16_t *dst = s_framebuffer.PixelData + s_framebuffer.Width * top + x;
+
+    for (uint16_t i = 0; i <= bottom - top; i++)
+    {
+        *dst = column[i];
+        dst += s_framebuffer.Width;
+    }
+    FrameBuffer_MarkDirty(&s_framebuffer, x, top, 1, bottom - top + 1);
+#else
+    CurveChart_WriteSpan(chart, x, top, 1, bottom - top + 1, 0, 1);
+#endif // CHART_USE_FRAMEBUFFER
+}
+
+/**
+  * @brief  Gets the rows covered by the trace segment in one column
+  * @param  x: Column index, the segment connects data[x] and data[x + 1]
+  * @param  top: Output, first row (screen direction) of the segment
+  * @param  bottom: Output, last row (screen direction) of the segment
+  * @retval 0 if the segment is out of chart area
+  */
+static inline uint8_t CurveChart_GetColumnSpan(const CurveChartTypeDef *chart, const uint16_t *data, uint16_t x, uint16_t *top, uint16_t *bottom)
+{
+    uint16_t y0, y1;
+
+    if (data[x] < data[x + 1]) {
+        y0 = data[x];
+        y1 = data[x + 1];
+    }
+    else {
+        y1 = data[x];
+        y0 = data[x + 1];
+    }
+
+    if (y0 >= chart->Height) {
+        return 0;
+    }
+    y1 = (y1 < chart->Height) ? y1 : chart->Height - 1;
+
+    *top = chart->Height - y1 - 1;
+    *bottom = chart->Height - y0 - 1;
+    return 1;
+}
+
+/**
+  * @brief  Inverts the colors of a chart line
+  * @param  x, y: Top-left position relative to chart area
+  * @param  width, height: Line size, one of them must be 1
+  * @retval None
+  */
+static void CurveChart_XorSpan(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+#if CHART_USE_FRAMEBUFFER
+    for (uint16_t i = 0; i < height; i++) {
+        for (uint16_t j = 0; j < width; j++) {
+            FB_WRITE_PIXEL(x + j, y + i, ~FB_READ_PIXEL(x + j, y + i));
+        }
+    }
+#else
+    uint16_t count = 0;
+
+    /* Read the whole line first, GRAM reads move the cursor */
+    for (uint16_t i = 0; i < height; i++)
+    {
+        for (uint16_t j = 0; j < width; j++)
         {
-            pixel_color = CurveChart_GetRecoverPixelColor(chart, i, j);
+#if CHART_USE_SHADOW
+            uint8_t index = CurveChart_ReadIndex(x + j, y + i) ^ PALETTE_INVERSE;
 
-#if CHART_USE_FRAMEBUFFER 
-            FrameBuffer_WritePixel(&s_framebuffer, i, j, pixel_color);
+            CurveChart_WriteIndex(x + j, y + i, index);
+            s_line_buffer[count++] = s_palette[index];
 #else
-            WRITE_PIXEL(chart->X + i, chart->Y + j, pixel_color);
-#endif // CHART_USE_FRAMEBUFFER 
+            s_line_buffer[count++] = ~READ_PIXEL(chart->X + x + j, chart->Y + y + i);
+#endif // CHART_USE_SHADOW
         }
     }
+
+    SET_WINDOW(chart->X + x, chart->Y + y, width, height);
+    PREPARE_WRITE();
+
+    for (uint16_t i = 0; i < count; i++) {
+        WRITE_GRAM(s_line_buffer[i]);
+    }
+    LCD_ResetWindow();
+#endif // CHART_USE_FRAMEBUFFER
 }
 
-void CurveChart_RecoverLineX(const CurveChartTypeDef *chart, uint16_t x)
+#if LCD_USE_FATFS
+/**
+  * @brief  Row source of CurveChart_SaveBmpToFile()
+  * @param  source: Chart being saved
+  * @param  y: Row index, counted down from the chart top
+  * @param  buffer: Returns chart->Width pixels (RGB565 format)
+  * @retval None
+  */
+static void CurveChart_ReadBmpLine(const void *source, uint16_t y, uint16_t *buffer)
 {
-    if (x > chart->Width) return;
-    uint16_t pixel_color;
+    CurveChart_ReadLine((const CurveChartTypeDef *)source, y, buffer);
+}
+#endif // LCD_USE_FATFS
+
+#if CHART_USE_PALETTE
+/**
+  * @brief  Sets up palette and indices of a chart just cleared to grid background
+  * @param  chart: Chart whose background tables are built
+  * @retval None
+  */
+static void CurveChart_ResetIndices(const CurveChartTypeDef *chart)
+{
+    uint8_t class_index[GRID_CLASS_COUNT];
+
+    s_index_stride = (CHART_INDEX_BITS == 4) ? (chart->Width + 1) / 2 : chart->Width;
+    s_palette_count = 0;
+    s_palette_last_index = PALETTE_SIZE;
+
+    class_index[GRID_CLASS_BACKGROUND] = CurveChart_GetPaletteIndex(chart->BackgroudColor);
+    class_index[GRID_CLASS_FINE] = CurveChart_GetPaletteIndex(chart->FineGridColor);
+    class_index[GRID_CLASS_COARSE] = CurveChart_GetPaletteIndex(chart->CoarseGridColor);
+
+    /* Grid lines are drawn from the first cell on, the first row and column
+     * keep background as on screen */
     for (uint16_t i = 0; i < chart->Height; i++)
     {
-        pixel_color = CurveChart_GetRecoverPixelColor(chart, x, i);
-#if CHART_USE_FRAMEBUFFER 
-        FrameBuffer_WritePixel(&s_framebuffer, x, i, pixel_color);
-#else
-        WRITE_PIXEL(chart->X + x, chart->Y + i, pixel_color);
-#endif // CHART_USE_FRAMEBUFFER 
+        uint8_t row_class = (i == 0) ? GRID_CLASS_BACKGROUND : CurveChart_GetGridClass(s_row_class, i);
+
+        for (uint16_t j = 0; j < chart->Width; j++)
+        {
+            uint8_t column_class = (j == 0) ? GRID_CLASS_BACKGROUND : CurveChart_GetGridClass(s_column_class, j);
+            CurveChart_WriteIndex(j, i, class_index[(row_class > column_class) ? row_class : column_class]);
+        }
     }
 }
 
-void CurveChart_RecoverLineY(const CurveChartTypeDef *chart, uint16_t y)
+/**
+  * @brief  Gets the palette index of a color, adding it if there's room
+  * @note   Each color added also takes its inverse at index | PALETTE_INVERSE,
+  *         so XOR cursors can be drawn and undone on indices alone. Once all
+  *         entries below PALETTE_INVERSE are used, other colors get the
+  *         nearest entry.
+  * @param  color: Pixel color (RGB565 format)
+  * @retval Palette index
+  */
+static uint8_t CurveChart_GetPaletteIndex(uint16_t color)
 {
-    if (y > chart->Height) return;
-    uint16_t pixel_color;
+    uint32_t nearest_distance = UINT32_MAX;
+    uint8_t nearest = 0;
 
-    for (uint16_t i = 0; i < chart->Width; i++)
+    if (s_palette_last_index < PALETTE_SIZE && s_palette_last_color == color) {
+        return s_palette_last_index;
+    }
+
+    for (uint16_t i = 0; i < PALETTE_SIZE; i++)
     {
-        pixel_color = CurveChart_GetRecoverPixelColor(chart, i, chart->Height - y);
-#if CHART_USE_FRAMEBUFFER 
-        FrameBuffer_WritePixel(&s_framebuffer, i, chart->Height - y, pixel_color);
+        if ((i & ~PALETTE_INVERSE) >= s_palette_count) {
+            continue;
+        }
+        if (s_palette[i] == color) {
+            nearest = i;
+            nearest_distance = 0;
+            break;
+        }
+
+        int32_t dr = (int32_t)(s_palette[i] >> 11) - (color >> 11);
+        int32_t dg = (int32_t)((s_palette[i] >> 5) & 0x3F) - ((color >> 5) & 0x3F);
+        int32_t db = (int32_t)(s_palette[i] & 0x1F) - (color & 0x1F);
+        uint32_t distance = 4 * dr * dr + dg * dg + 4 * db * db;
+
+        if (distance < nearest_distance) {
+            nearest_distance = distance;
+            nearest = i;
+        }
+    }
+
+    if (nearest_distance != 0 && s_palette_count < PALETTE_INVERSE) {
+        nearest = s_palette_count++;
+        s_palette[nearest] = color;
+        s_palette[nearest | PALETTE_INVERSE] = ~color;
+#if CHART_FRAMEBUFFER_INDEXED && CHART_INDEX_BITS == 4
+        s_pair_lut_dirty = 1;
+#endif
+    }
+
+    s_palette_last_color = color;
+    s_palette_last_index = nearest;
+    return nearest;
+}
+
+static void CurveChart_FillIndex(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t index)
+{
+    for (uint16_t i = 0; i < height; i++) {
+        for (uint16_t j = 0; j < width; j++) {
+            CurveChart_WriteIndex(x + j, y + i, index);
+        }
+    }
+}
+
+static inline void CurveChart_WriteIndex(uint16_t x, uint16_t y, uint8_t index)
+{
+#if CHART_INDEX_BITS == 4
+    __IO uint8_t *byte = s_indices + (uint32_t)s_index_stride * y + (x >> 1);
+
+    if (x & 1) {
+        *byte = (*byte & 0x0F) | (index << 4);
+    }
+    else {
+        *byte = (*byte & 0xF0) | index;
+    }
 #else
-        WRITE_PIXEL(chart->X + i, chart->Y + chart->Height - y, pixel_color);
-#endif // CHART_USE_FRAMEBUFFER 
+    s_indices[(uint32_t)s_index_stride * y + x] = index;
+#endif // CHART_INDEX_BITS == 4
+}
+
+static inline uint8_t CurveChart_ReadIndex(uint16_t x, uint16_t y)
+{
+#if CHART_INDEX_BITS == 4
+    uint8_t byte = s_indices[(uint32_t)s_index_stride * y + (x >> 1)];
+
+    return (x & 1) ? byte >> 4 : byte & 0x0F;
+#else
+    return s_indices[(uint32_t)s_index_stride * y + x];
+#endif // CHART_INDEX_BITS == 4
+}
+#endif // CHART_USE_PALETTE
+
+#if CHART_FRAMEBUFFER_INDEXED
+static inline void CurveChart_WriteIndexedPixel(uint16_t x, uint16_t y, uint16_t color)
+{
+    uint32_t tile = (y >> FRAME_BUFFER_TILE_SHIFT) * s_framebuffer.TileCols + (x >> FRAME_BUFFER_TILE_SHIFT);
+
+    CurveChart_WriteIndex(x, y, CurveChart_GetPaletteIndex(color));
+    s_framebuffer.DirtyTiles[tile >> 5] |= 1UL << (tile & 31);
+}
+
+/**
+  * @brief  Expands dirty tiles of the indexed framebuffer and sends them to GRAM
+  * @note   Dirty tiles of each tile row are merged into one column range and
+  *         sent line by line, each line expanded while the previous one is
+  *         still on the bus. With 4-bit indices a byte holds two pixels and
+  *         is expanded by a single lookup.
+  * @param  None
+  * @retval None
+  */
+static void CurveChart_FlushIndexed(void)
+{
+    FrameBufferTypeDef *fb = &s_framebuffer;
+    uint32_t line = 0;
+
+#if CHART_INDEX_BITS == 4
+    if (s_pair_lut_dirty) {
+        for (uint16_t i = 0; i < 256; i++) {
+            s_pair_lut[i] = s_palette[i & 0x0F] | ((uint32_t)s_palette[i >> 4] << 16);
+        }
+        s_pair_lut_dirty = 0;
+    }
+#endif // CHART_INDEX_BITS == 4
+
+    for (uint16_t tile_row = 0; tile_row < fb->TileRows; tile_row++)
+    {
+        uint16_t first = fb->TileCols, last = 0;
+
+        for (uint16_t tile_col = 0; tile_col < fb->TileCols; tile_col++)
+        {
+            uint32_t tile = (uint32_t)tile_row * fb->TileCols + tile_col;
+
+            if (fb->DirtyTiles[tile >> 5] & (1UL << (tile & 31))) {
+                fb->DirtyTiles[tile >> 5] &= ~(1UL << (tile & 31));
+                first = (tile_col < first) ? tile_col : first;
+                last = tile_col;
+            }
+        }
+        if (first > last) {
+            continue;
+        }
+
+        /* Tiles are 16 pixels wide, so x is even and a 4-bit range starts on a byte */
+        uint16_t x = first << FRAME_BUFFER_TILE_SHIFT;
+        uint16_t width = ((last + 1) << FRAME_BUFFER_TILE_SHIFT) - x;
+        uint16_t y = tile_row << FRAME_BUFFER_TILE_SHIFT;
+        uint16_t height = FRAME_BUFFER_TILE_SIZE;
+
+        width = (x + width > fb->Width) ? fb->Width - x : width;
+        height = (y + height > fb->Height) ? fb->Height - y : height;
+
+        for (uint16_t i = 0; i < height; i++, line++)
+        {
+            uint16_t *pixels = s_flush_lines[line & 1];
+
+#if CHART_INDEX_BITS == 4
+            const __IO uint8_t *src = s_indices + (uint32_t)s_index_stride * (y + i) + (x >> 1);
+            uint32_t *pairs = (uint32_t *)pixels;
+
+            for (uint16_t j = 0; j < width / 2; j++) {
+                pairs[j] = s_pair_lut[src[j]];
+            }
+            if (width & 1) {
+                pixels[width - 1] = s_palette[src[width / 2] & 0x0F];
+            }
+#else
+            const __IO uint8_t *src = s_indices + (uint32_t)s_index_stride * (y + i) + x;
+
+            for (uint16_t j = 0; j < width; j++) {
+                pixels[j] = s_palette[src[j]];
+            }
+#endif // CHART_INDEX_BITS == 4
+
+            /* Waits for the previous line, which frees the other buffer */
+            FrameBuffer_WriteGram(fb->X + x, fb->Y + y + i, width, 1, pixels);
+        }
     }
 }
+#endif // CHART_FRAMEBUFFER_INDEXED
 
-static inline uint16_t CurveChart_GetRecoverPixelColor(const CurveChartTypeDef *chart, uint16_t x0, uint16_t y0)
+#if !CHART_USE_FRAMEBUFFER
+/**
+  * @brief  Draws or erases a trace with one GRAM window per span
+  * @note   A 1-pixel column segment costs a full cursor setup when written with
+  *         WRITE_PIXEL, so each column segment is streamed through a 1 x N
+  *         window, and flat runs of 1-pixel segments at the same row are
+  *         merged into a single N x 1 window.
+  * @param  color: Trace color, ignored when erasing
+  * @param  recover: Non-zero to restore grid background instead of drawing
+  * @retval None
+  */
+static void CurveChart_DrawTraceSpans(const CurveChartTypeDef *chart, const uint16_t *data, uint16_t color, uint8_t recover)
 {
-    if ((x0 % chart->CoarseGridWidth == 0) || (y0 % chart->CoarseGridHeight == 0)) {
-        return chart->CoarseGridColor;
+    uint16_t top, bottom, next_top, next_bottom;
+    uint16_t i = 0;
+
+    while (i < chart->Width - 1)
+    {
+        if (!CurveChart_GetColumnSpan(chart, data, i, &top, &bottom)) {
+            ++i;
+            continue;
+        }
+
+        uint16_t run = 1;
+
+        if (top == bottom) {
+            while (i + run < chart->Width - 1
+                && CurveChart_GetColumnSpan(chart, data, i + run, &next_top, &next_bottom)
+                && next_top == top && next_bottom == top) {
+                ++run;
+            }
+            CurveChart_WriteSpan(chart, i, top, run, 1, color, recover);
+        }
+        else {
+            CurveChart_WriteSpan(chart, i, top, 1, bottom - top + 1, color, recover);
+        }
+
+        i += run;
     }
 
-    if ((x0 % chart->FineGridWidth == 0) || (y0 % chart->FineGridHeight == 0)) {
-        return chart->FineGridColor;
+    /* Restore full screen window only once per trace */
+    LCD_ResetWindow();
+}
+
+/**
+  * @brief  Streams a rectangular span of chart pixels to GRAM
+  * @note   GRAM window is left set to the span, call LCD_ResetWindow() when done.
+  * @param  x, y: Top-left position relative to chart area
+  * @param  width, height: Span size
+  * @param  color: Pixel color, ignored when recovering
+  * @param  recover: Non-zero to write grid background instead of color
+  * @retval None
+  */
+static void CurveChart_WriteSpan(const CurveChartTypeDef *chart, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color, uint8_t recover)
+{
+    SET_WINDOW(chart->X + x, chart->Y + y, width, height);
+    PREPARE_WRITE();
+
+    if (!recover) {
+        for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
+            WRITE_GRAM(color);
+        }
+        SHADOW_FILL(x, y, width, height, color);
+        return;
     }
 
-    return chart->BackgroudColor;
-}
\ No newline at end of file
+    if (width == 1) {
+        /* Vertical span, copy straight from composed column */
+        const uint16_t *column = CurveChart_ComposeColumn(x, y, y + height - 1);
+        for (uint16_t i = 0; i < height; i++) {
+            WRITE_GRAM(column[i]);
+            SHADOW_PIXEL(x, y + i, column[i]);
+        }
+        return;
+    }
+
+    for (uint16_t i = 0; i < height; i++) {
+        for (uint16_t j = 0; j < width; j++) {
+            uint16_t pixel_color = CurveChart_GetRecoverPixelColor(chart, x + j, y + i);
+            WRITE_GRAM(pixel_color);
+            SHADOW_PIXEL(x + j, y + i, pixel_color);
+        }
+    }
+}
+#endif // !CHART_USE_FRAMEBUFFER
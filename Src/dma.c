@@ -46,6 +46,11 @@ void DMA_Init(void)
 
     /* DMA interrupt init */
 
+    /* Memory to memory DMA, used by async framebuffer flush */
+    /* DMA2_Stream0_IRQn interrupt configuration */
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
     /* USART TX RX DMA */
     /* DMA2_Stream2_IRQn interrupt configuration */
     HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 5, 0);
@@ -63,6 +68,12 @@ void DMA_Init(void)
     HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
 }
 
+/* Memory to memory DMA global interrupt*/
+void DMA2_Stream0_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_m2m);
+}
+
 /* USART1 DMA global interrupt*/
 void DMA2_Stream2_IRQHandler(void)
 {
@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+  * @file       font_cache.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      External SRAM cache of font library glyphs
+  *
+  * @note       Keeps glyph bitmaps read from the SD card font library files in
+  *             external SRAM, so drawing a label again does not go back to the
+  *             card. Entries are keyed by font type, size and character code;
+  *             when all slots are taken the least recently used one is
+  *             replaced. Only built with LCD_USE_FONTLIB.
+  *
+  *             Glyph data lives at SRAM_FONT_CACHE_OFFSET in fixed size
+  *             slots, keys and use stamps stay in internal RAM.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "font_cache.h"
+#include "lcd.h"
+#include "fsmc.h"
+#include "sram.h"
+
+#if LCD_USE_FONTLIB
+
+/* Private Marcos ------------------------------------------------------------*/
+#define SLOT_DATA(SLOT)         ((__IO uint16_t *)(FSMC_SRAM_BASE_ADDR + SRAM_FONT_CACHE_OFFSET) \
+                                 + (SLOT) * (FONT_CACHE_SLOT_SIZE / 2))
+
+/* Private Types -------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Key;
+    uint32_t Sequence;      //Last use stamp, 0 marks an empty slot
+
+} GlyphSlotTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static GlyphSlotTypeDef s_slots[FONT_CACHE_SLOTS];
+static uint32_t s_sequence;
+static FontCache_StatsTypeDef s_stats;
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Initializes the font cache
+  * @note   FSMC_Init() must be called before using the cache
+  * @retval None
+  */
+void FontCache_Init(void)
+{
+    FontCache_Invalidate();
+    FontCache_ResetStats();
+}
+
+/**
+  * @brief  Drops every cached glyph
+  * @retval None
+  */
+void FontCache_Invalidate(void)
+{
+    for (uint16_t i = 0; i < FONT_CACHE_SLOTS; i++) {
+        s_slots[i].Sequence = 0;
+    }
+    s_sequence = 0;
+}
+
+/**
+  * @brief  Reads a glyph from the cache
+  * @param  key: Glyph key, see FONT_CACHE_KEY()
+  * @param  buffer: Returns size bytes of glyph data
+  * @param  size: Glyph size in bytes, must be even
+  * @retval HAL_ERROR on a miss
+  */
+HAL_StatusTypeDef FontCache_Read(uint32_t key, uint8_t *buffer, uint16_t size)
+{
+    for (uint16_t i = 0; i < FONT_CACHE_SLOTS; i++) {
+        if (s_slots[i].Sequence != 0 && s_slots[i].Key == key) {
+            /* SRAM is only accessed 16 bits wide */
+            __IO uint16_t *data = SLOT_DATA(i);
+            for (uint16_t n = 0; n < size / 2; n++) {
+                uint16_t temp = data[n];
+                buffer[2 * n] = (uint8_t)temp;
+                buffer[2 * n + 1] = (uint8_t)(temp >> 8);
+            }
+            s_slots[i].Sequence = ++s_sequence;
+            s_stats.Hits++;
+            return HAL_OK;
+        }
+    }
+
+    s_stats.Misses++;
+    return HAL_ERROR;
+}
+
+/**
+  * @brief  Stores a glyph freshly read from the font library
+  * @note   Replaces an empty slot or the least recently used one
+  * @param  key: Glyph key, see FONT_CACHE_KEY()
+  * @param  buffer: Glyph data
+  * @param  size: Glyph size in bytes, must be even
+  * @retval None
+  */
+void FontCache_Write(uint32_t key, const uint8_t *buffer, uint16_t size)
+{
+    uint16_t slot = 0;
+
+    if (size > FONT_CACHE_SLOT_SIZE) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < FONT_CACHE_SLOTS; i++) {
+        if (s_slots[i].Sequence < s_slots[slot].Sequence) {
+            slot = i;
+        }
+    }
+
+    __IO uint16_t *data = SLOT_DATA(slot);
+    for (uint16_t n = 0; n < size / 2; n++) {
+        data[n] = buffer[2 * n] | (uint16_t)(buffer[2 * n + 1] << 8);
+    }
+
+    s_slots[slot].Key = key;
+    s_slots[slot].Sequence = ++s_sequence;
+}
+
+/**
+  * @brief  Gets hit and miss counts since the last reset
+  * @param  stats: Returns the counters
+  * @retval None
+  */
+void FontCache_GetStats(FontCache_StatsTypeDef *stats)
+{
+    *stats = s_stats;
+}
+
+/**
+  * @brief  Clears hit and miss counters
+  * @retval None
+  */
+void FontCache_ResetStats(void)
+{
+    s_stats.Hits = 0;
+    s_stats.Misses = 0;
+}
+
+#endif // LCD_USE_FONTLIB
+
+/* End of file ---------------------------------------------------------------*/
\ No newline at end of file
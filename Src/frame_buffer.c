@@ -9,6 +9,11 @@
   *             positions are within the window when performing read/write ops.
   *             Call FrameBuffer_Update() to flush all pixels in buffer to 
   *             destination memory address (e.g. GRAM).
+  *             Async flush is chained chunk by chunk from DMA transfer complete
+  *             interrupt, only one framebuffer can be flushing at a time.
+  *             Dirty tiles are merged into rectangles (runs along a tile row,
+  *             extended down while the rows below are dirty over the same run)
+  *             and each rectangle gets its own GRAM window.
   ******************************************************************************
   */
 
@@ -16,6 +21,8 @@
 #include "frame_buffer.h"
 #include "lcd.h"
 
+#include <string.h>
+
 #if LCD_DRIVER_IC == NT35510
 #include "nt35510.h"
 #elif LCD_DRIVER_IC == ILI9341
@@ -25,6 +32,41 @@
 #endif
 
 /* Private Marcos ------------------------------------------------------------*/
+#define DMA_MAX_CHUNK_WORDS         0xFFFFU
+
+#define BUS_JOB_NONE                0
+#define BUS_JOB_FLUSH               1
+#define BUS_JOB_FILL_GRAM           2
+#define BUS_JOB_FILL_SRAM           3
+#define BUS_JOB_WRITE_GRAM          4
+#define BUS_JOB_STREAM_GRAM         5
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Snapshot of dirty tiles taken when flush starts, consumed region by region */
+static uint32_t s_flush_tiles[FRAME_BUFFER_TILE_WORDS];
+static uint32_t s_flush_scan_tile;
+
+#if FRAME_BUFFER_USE_DMA
+/* Job currently owning hdma_m2m and the LCD bus */
+static __IO uint8_t s_bus_job = BUS_JOB_NONE;
+static FrameBufferTypeDef *s_flushing_fb;
+static uint32_t s_flush_base_addr;
+
+/* Transfer state, a job is a block or a number of equal rows */
+static uint32_t s_xfer_src_addr;
+static uint32_t s_xfer_dst_addr;
+static uint32_t s_xfer_word_count;
+static uint32_t s_xfer_row_words;
+static uint32_t s_xfer_src_row_skip;
+static uint32_t s_xfer_dst_row_skip;
+static uint16_t s_xfer_rows_left;
+static uint8_t s_xfer_src_inc;
+static uint8_t s_xfer_dst_inc;
+
+/* Source word of solid fills, two RGB565 pixels */
+static uint32_t s_fill_word;
+#endif // FRAME_BUFFER_USE_DMA
 
 /* External Variables --------------------------------------------------------*/
 #if FRAME_BUFFER_USE_DMA
@@ -45,7 +87,7 @@ extern DMA_HandleTypeDef hdma_m2m;
   * @retval None
   */
 void FrameBuffer_Init(FrameBufferTypeDef *fb, 
-                      const uint16_t *base_addr, const uint16_t *dst_addr, 
+                      __IO uint16_t *base_addr, __IO uint16_t *dst_addr, 
                       uint16_t x, uint16_t y, uint16_t width, uint16_t height)
 {
     fb->PixelData = base_addr;
@@ -54,6 +96,28 @@ void FrameBuffer_Init(FrameBufferTypeDef *fb,
     fb->Y = y;
     fb->Width = width;
     fb->Height = height;
+    fb->BackPixelData = NULL;
+    fb->Flushing = 0;
+    fb->FlushCpltCallback = NULL;
+    fb->TileCols = (width + FRAME_BUFFER_TILE_SIZE - 1) >> FRAME_BUFFER_TILE_SHIFT;
+    fb->TileRows = (height + FRAME_BUFFER_TILE_SIZE - 1) >> FRAME_BUFFER_TILE_SHIFT;
+
+    /* Whatever is on screen now is unknown */
+    FrameBuffer_MarkDirty(fb, 0, 0, width, height);
+}
+
+/**
+  * @brief  Enables double buffering
+  * @note   After each async flush the buffers swap, so drawing continues into
+  *         the buffer holding the frame before last. Only suitable for users
+  *         that redraw the whole window every frame.
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  back_addr: Second buffer address in SRAM, same size as the first
+  * @retval None
+  */
+void FrameBuffer_SetBackBuffer(FrameBufferTypeDef *fb, const uint16_t *back_addr)
+{
+    fb->BackPixelData = (__IO uint16_t *)back_addr;
 }
 
 /**
@@ -64,40 +128,696 @@ void FrameBuffer_Init(FrameBufferTypeDef *fb,
   */
 void FrameBuffer_Clear(FrameBufferTypeDef *fb, uint16_t color)
 {
-    for (size_t i = 0; i < fb->Width * fb->Height; i++) {
-        fb->PixelData[i] = color;
+    FrameBuffer_FillRect(fb, 0, 0, fb->Width, fb->Height, color);
+}
+
+/**
+  * @brief  Fill a rectangle in pixel buffer with selected color
+  * @note   Uses DMA with a fixed source word, returns when finished.
+  *         Odd edge columns are written by CPU to keep DMA word aligned.
+  *         Windows of odd width are filled by CPU, their rows alternate
+  *         between word and halfword alignment.
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  x: Specifies the X top-left position in window
+  * @param  y: Specifies the Y top-left position in window
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void FrameBuffer_FillRect(FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    FrameBuffer_MarkDirty(fb, x, y, width, height);
+
+#if FRAME_BUFFER_USE_DMA
+    if ((fb->Width & 0x01) == 0)
+    {
+        __IO uint16_t *row = fb->PixelData + (uint32_t)fb->Width * y + x;
+
+        FrameBuffer_WaitBus();
+
+        /* Unaligned first column and odd last column */
+        if ((uint32_t)row & 0x02) {
+            for (uint16_t i = 0; i < height; i++) {
+                row[fb->Width * i] = color;
+            }
+            ++row;
+            --width;
+        }
+        if (width & 0x01) {
+            for (uint16_t i = 0; i < height; i++) {
+                row[fb->Width * i + width - 1] = color;
+            }
+            --width;
+        }
+        if (width == 0) {
+            return;
+        }
+
+        s_fill_word = color | ((uint32_t)color << 16);
+        s_xfer_src_addr = (uint32_t)&s_fill_word;
+        s_xfer_dst_addr = (uint32_t)row;
+        s_xfer_src_inc = 0;
+        s_xfer_dst_inc = 1;
+        s_xfer_src_row_skip = 0;
+
+        if (width == fb->Width) {
+            s_xfer_word_count = (uint32_t)width * height / 2;
+            s_xfer_rows_left = 0;
+        }
+        else {
+            s_xfer_row_words = width / 2;
+            s_xfer_word_count = s_xfer_row_words;
+            s_xfer_dst_row_skip = (fb->Width - width) * 2;
+            s_xfer_rows_left = height - 1;
+        }
+
+        s_bus_job = BUS_JOB_FILL_SRAM;
+        FrameBuffer_StartJob();
+        FrameBuffer_WaitBus();
+        return;
+    }
+#endif // FRAME_BUFFER_USE_DMA
+
+    for (uint16_t i = 0; i < height; i++) {
+        __IO uint16_t *row = fb->PixelData + (uint32_t)fb->Width * (y + i) + x;
+        for (uint16_t j = 0; j < width; j++) {
+            row[j] = color;
+        }
+    }
+}
+
+/**
+  * @brief  Fill a rectangle on screen (GRAM) with selected color
+  * @note   Returns right after DMA starts, the LCD bus is busy until the fill
+  *         completes. GRAM window is reset to whole screen when finished.
+  * @param  x: Specifies the X top-left position on screen
+  * @param  y: Specifies the Y top-left position on screen
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void FrameBuffer_FillGram(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color)
+{
+    uint32_t pixel_count = (uint32_t)width * height;
+
+    if (pixel_count == 0) {
+        return;
+    }
+
+    FrameBuffer_WaitBus();
+
+    SET_WINDOW(x, y, width, height);
+    PREPARE_WRITE();
+
+#if FRAME_BUFFER_USE_DMA
+    /* GRAM address auto increments, the odd pixel can go first */
+    if (pixel_count & 0x01) {
+        WRITE_GRAM(color);
+    }
+    if (pixel_count < 2) {
+        LCD_ResetWindow();
+        return;
+    }
+
+    s_fill_word = color | ((uint32_t)color << 16);
+    s_xfer_src_addr = (uint32_t)&s_fill_word;
+    s_xfer_dst_addr = FSMC_LCD_DATA_ADDR;
+    s_xfer_src_inc = 0;
+    s_xfer_dst_inc = 0;
+    s_xfer_word_count = pixel_count / 2;
+    s_xfer_rows_left = 0;
+    FSMC_LCD_COUNT(DmaWrites, s_xfer_word_count * 2);
+
+    s_bus_job = BUS_JOB_FILL_GRAM;
+    FrameBuffer_StartJob();
+#else
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        WRITE_GRAM(color);
+    }
+    LCD_ResetWindow();
+#endif // FRAME_BUFFER_USE_DMA
+}
+
+/**
+  * @brief  Sends a block of pixels to a rectangle on screen (GRAM)
+  * @note   Returns right after DMA starts, the pixels must stay untouched and
+  *         the LCD bus is busy until FrameBuffer_WaitBus() returns. The buffer
+  *         must be DMA accessible (not CCM) and word aligned, with an even
+  *         pixel count, otherwise it's written by CPU before returning.
+  *         GRAM window is reset to whole screen when finished.
+  * @param  x: Specifies the X top-left position on screen
+  * @param  y: Specifies the Y top-left position on screen
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @param  pixels: RGB565 pixels, row major
+  * @retval None
+  */
+void FrameBuffer_WriteGram(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels)
+{
+    uint32_t pixel_count = (uint32_t)width * height;
+
+    if (pixel_count == 0) {
+        return;
+    }
+
+    FrameBuffer_WaitBus();
+
+    SET_WINDOW(x, y, width, height);
+    PREPARE_WRITE();
+
+#if FRAME_BUFFER_USE_DMA
+    if ((pixel_count & 0x01) == 0 && ((uint32_t)pixels & 0x03) == 0)
+    {
+        s_xfer_src_addr = (uint32_t)pixels;
+        s_xfer_dst_addr = FSMC_LCD_DATA_ADDR;
+        s_xfer_src_inc = 1;
+        s_xfer_dst_inc = 0;
+        s_xfer_word_count = pixel_count / 2;
+        s_xfer_rows_left = 0;
+        FSMC_LCD_COUNT(DmaWrites, pixel_count);
+
+        s_bus_job = BUS_JOB_WRITE_GRAM;
+        FrameBuffer_StartJob();
+        return;
+    }
+#endif // FRAME_BUFFER_USE_DMA
+
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        WRITE_GRAM(pixels[i]);
+    }
+    LCD_ResetWindow();
+}
+
+/**
+  * @brief  Sends rows of pixels to a rectangle on screen (GRAM), rows may be
+  *         apart or in reverse order in memory
+  * @note   Same as FrameBuffer_WriteGram() otherwise. Bottom-up images (e.g.
+  *         BMP files) are sent with pixels at the top row and a negative
+  *         stride. Each row must be word aligned with an even width for DMA.
+  * @param  x: Specifies the X top-left position on screen
+  * @param  y: Specifies the Y top-left position on screen
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @param  pixels: RGB565 pixels of the top row
+  * @param  stride: Bytes from the start of a row to the start of the next one
+  * @retval None
+  */
+void FrameBuffer_WriteGramStride(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels, int32_t stride)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    if (stride == width * 2) {
+        FrameBuffer_WriteGram(x, y, width, height, pixels);
+        return;
+    }
+
+    FrameBuffer_WaitBus();
+
+    SET_WINDOW(x, y, width, height);
+    PREPARE_WRITE();
+
+#if FRAME_BUFFER_USE_DMA
+    if ((width & 0x01) == 0 && ((uint32_t)pixels & 0x03) == 0 && (stride & 0x03) == 0)
+    {
+        s_xfer_src_addr = (uint32_t)pixels;
+        s_xfer_dst_addr = FSMC_LCD_DATA_ADDR;
+        s_xfer_src_inc = 1;
+        s_xfer_dst_inc = 0;
+        s_xfer_row_words = width / 2;
+        s_xfer_word_count = s_xfer_row_words;
+        /* Source address has passed the row when it's skipped, may wrap backwards */
+        s_xfer_src_row_skip = (uint32_t)(stride - width * 2);
+        s_xfer_rows_left = height - 1;
+        FSMC_LCD_COUNT(DmaWrites, (uint32_t)width * height);
+
+        s_bus_job = BUS_JOB_WRITE_GRAM;
+        FrameBuffer_StartJob();
+        return;
+    }
+#endif // FRAME_BUFFER_USE_DMA
+
+    for (uint16_t i = 0; i < height; i++)
+    {
+        const uint16_t *row = (const uint16_t *)((const uint8_t *)pixels + stride * i);
+        for (uint16_t j = 0; j < width; j++) {
+            WRITE_GRAM(row[j]);
+        }
+    }
+    LCD_ResetWindow();
+}
+
+/**
+  * @brief  Sends pixels on to GRAM at the current write position
+  * @note   For streaming an image through one window in pieces: set the window
+  *         and call PREPARE_WRITE() once, then call this for each piece. GRAM
+  *         window is left alone, reset it after FrameBuffer_WaitBus() when the
+  *         image is done. Returns right after DMA starts, like
+  *         FrameBuffer_WriteGram(), and has the same buffer requirements.
+  * @param  pixels: RGB565 pixels
+  * @param  pixel_count: Number of pixels
+  * @retval None
+  */
+void FrameBuffer_StreamGram(const uint16_t *pixels, uint32_t pixel_count)
+{
+    if (pixel_count == 0) {
+        return;
+    }
+
+    FrameBuffer_WaitBus();
+
+#if FRAME_BUFFER_USE_DMA
+    if ((pixel_count & 0x01) == 0 && ((uint32_t)pixels & 0x03) == 0)
+    {
+        s_xfer_src_addr = (uint32_t)pixels;
+        s_xfer_dst_addr = FSMC_LCD_DATA_ADDR;
+        s_xfer_src_inc = 1;
+        s_xfer_dst_inc = 0;
+        s_xfer_word_count = pixel_count / 2;
+        s_xfer_rows_left = 0;
+        FSMC_LCD_COUNT(DmaWrites, pixel_count);
+
+        s_bus_job = BUS_JOB_STREAM_GRAM;
+        FrameBuffer_StartJob();
+        return;
+    }
+#endif // FRAME_BUFFER_USE_DMA
+
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        WRITE_GRAM(pixels[i]);
+    }
+}
+
+/**
+  * @brief  Marks a rectangle to be sent on next flush
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  x: Specifies the X top-left position in window
+  * @param  y: Specifies the Y top-left position in window
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @retval None
+  */
+void FrameBuffer_MarkDirty(FrameBufferTypeDef *fb, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    uint16_t col_start = x >> FRAME_BUFFER_TILE_SHIFT;
+    uint16_t col_end = (x + width - 1) >> FRAME_BUFFER_TILE_SHIFT;
+    uint16_t row_start = y >> FRAME_BUFFER_TILE_SHIFT;
+    uint16_t row_end = (y + height - 1) >> FRAME_BUFFER_TILE_SHIFT;
+
+    for (uint16_t row = row_start; row <= row_end; row++) {
+        for (uint16_t col = col_start; col <= col_end; col++) {
+            uint32_t tile = row * fb->TileCols + col;
+            fb->DirtyTiles[tile >> 5] |= 1UL << (tile & 31);
+        }
     }
 }
 
 /**
-  * @brief  Update all pixels in buffer to GRAM
+  * @brief  Update all pixels in buffer to GRAM, returns when finished
   * @param  fb: Pointer to pixel buffer structure
   * @retval None
   */
 void FrameBuffer_Update(FrameBufferTypeDef *fb)
 {
-    uint32_t src_addr = fb->PixelData;
-    size_t word_count = fb->Width * fb->Height / 2;
+#if FRAME_BUFFER_USE_DMA
+    FrameBuffer_WaitBus();
 
-    SET_WINDOW(fb->X, fb->Y, fb->Width, fb->Height);
-    PREPARE_WRITE();
+    if (FrameBuffer_UpdateAsync(fb) == HAL_OK) {
+        FrameBuffer_WaitFlush(fb, 1000);
+    }
+#else
+    FrameBuffer_SendDirtyRegions(fb);
+#endif // FRAME_BUFFER_USE_DMA
+}
 
+/**
+  * @brief  Starts flushing dirty pixels in buffer to GRAM without waiting
+  * @note   Pixels are sent in 0xFFFF-word chunks, or one row per transfer for
+  *         regions narrower than the window. The next transfer is started
+  *         from DMA transfer complete interrupt. FlushCpltCallback is called
+  *         from interrupt context when the last region finishes.
+  *         With a back buffer the whole window is always sent, as the two
+  *         buffers hold different frames.
+  *         Windows of odd width are sent by CPU before returning, their rows
+  *         can't all be word aligned for DMA.
+  * @param  fb: Pointer to pixel buffer structure
+  * @retval HAL_BUSY if another flush is still in progress
+  */
+HAL_StatusTypeDef FrameBuffer_UpdateAsync(FrameBufferTypeDef *fb)
+{
 #if FRAME_BUFFER_USE_DMA
+    if (s_bus_job != BUS_JOB_NONE) {
+        return HAL_BUSY;
+    }
+
+    if (fb->Width & 0x01) {
+        FrameBuffer_SendDirtyRegions(fb);
+        return HAL_OK;
+    }
+
+    if (fb->BackPixelData != NULL) {
+        FrameBuffer_MarkDirty(fb, 0, 0, fb->Width, fb->Height);
+    }
 
-    while (word_count > 0xFFFF) {
-        HAL_DMA_Start(&hdma_m2m, src_addr, (uint32_t)fb->DstAddr, 0xFFFF);
-        /* Polling for DMA to transfer pixel block of size 0xFFFFh == 65535 * 4 Bytes */
-        HAL_DMA_PollForTransfer(&hdma_m2m, HAL_DMA_FULL_TRANSFER, 1000);
-        src_addr += 0x3FFFC;
-        word_count -= 0xFFFF;
+    memcpy(s_flush_tiles, fb->DirtyTiles, sizeof(s_flush_tiles));
+    memset(fb->DirtyTiles, 0, sizeof(fb->DirtyTiles));
+    s_flush_scan_tile = 0;
+
+    s_flush_base_addr = (uint32_t)fb->PixelData;
+    fb->Flushing = 1;
+    s_flushing_fb = fb;
+    s_bus_job = BUS_JOB_FLUSH;
+
+    /* Keep drawing into the other buffer while this one streams out */
+    if (fb->BackPixelData != NULL) {
+        __IO uint16_t *temp = fb->PixelData;
+        fb->PixelData = fb->BackPixelData;
+        fb->BackPixelData = temp;
+    }
+
+    if (!FrameBuffer_StartRegion()) {
+        /* Nothing changed since last flush */
+        FrameBuffer_EndJob();
+        return HAL_OK;
     }
 
-    HAL_DMA_Start(&hdma_m2m, src_addr, (uint32_t)fb->DstAddr, word_count);
-    /* Polling for DMA to transfer remaining pixels */
-    HAL_DMA_PollForTransfer(&hdma_m2m, HAL_DMA_FULL_TRANSFER, 1000);
+    return FrameBuffer_StartJob();
 #else
-    for (size_t i = 0; i < fb->Width * fb->Height; i++) {
-        WRITE_GRAM(fb->Pixels[i]);
+    FrameBuffer_Update(fb);
+    return HAL_OK;
+#endif // FRAME_BUFFER_USE_DMA
+}
+
+/**
+  * @brief  Waits for an async flush of the framebuffer to complete
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  timeout: Timeout duration in ms
+  * @retval HAL_TIMEOUT if the flush did not finish in time
+  */
+HAL_StatusTypeDef FrameBuffer_WaitFlush(FrameBufferTypeDef *fb, uint32_t timeout)
+{
+    uint32_t tick_start = HAL_GetTick();
+
+    while (fb->Flushing)
+    {
+        if (HAL_GetTick() - tick_start > timeout) {
+            return HAL_TIMEOUT;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Waits until no flush, fill or GRAM write is using the LCD bus and DMA
+  * @note   A job still running after 1000ms is aborted so the bus is free on
+  *         return either way. An aborted flush leaves the whole framebuffer
+  *         dirty, an aborted GRAM fill or write leaves that area incomplete.
+  * @param  None
+  * @retval HAL_TIMEOUT if a stuck DMA job had to be aborted
+  */
+HAL_StatusTypeDef FrameBuffer_WaitBus(void)
+{
+#if FRAME_BUFFER_USE_DMA
+    uint32_t tick_start = HAL_GetTick();
+
+    while (s_bus_job != BUS_JOB_NONE)
+    {
+        if (HAL_GetTick() - tick_start > 1000) {
+            HAL_DMA_Abort(&hdma_m2m);
+            /* Same cleanup as a transfer error, ends the job */
+            FrameBuffer_DmaXferError(&hdma_m2m);
+            return HAL_TIMEOUT;
+        }
+    }
+#endif // FRAME_BUFFER_USE_DMA
+
+    return HAL_OK;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+static inline uint8_t FrameBuffer_IsTileDirty(uint32_t tile)
+{
+    return (s_flush_tiles[tile >> 5] >> (tile & 31)) & 1;
+}
+
+/**
+  * @brief  Takes the next dirty rectangle out of flush tile snapshot
+  * @note   Tiles before s_flush_scan_tile are known to be clean already.
+  * @param  fb: Pointer to pixel buffer structure
+  * @param  x, y, width, height: Output, rectangle in window coordinates
+  * @retval 0 if no dirty tile is left
+  */
+static uint8_t FrameBuffer_NextDirtyRegion(const FrameBufferTypeDef *fb,
+                                           uint16_t *x, uint16_t *y, uint16_t *width, uint16_t *height)
+{
+    uint32_t tile_count = (uint32_t)fb->TileCols * fb->TileRows;
+    uint32_t tile = s_flush_scan_tile;
+
+    /* Find first dirty tile, skipping clean words */
+    while (tile < tile_count && !FrameBuffer_IsTileDirty(tile)) {
+        if ((tile & 31) == 0 && s_flush_tiles[tile >> 5] == 0) {
+            tile += 32;
+        }
+        else {
+            ++tile;
+        }
+    }
+
+    if (tile >= tile_count) {
+        s_flush_scan_tile = tile_count;
+        return 0;
+    }
+
+    s_flush_scan_tile = tile;
+
+    uint16_t row_start = tile / fb->TileCols;
+    uint16_t col_start = tile % fb->TileCols;
+    uint16_t col_end = col_start + 1;
+    uint16_t row_end = row_start + 1;
+
+    /* Extend run along the tile row */
+    while (col_end < fb->TileCols && FrameBuffer_IsTileDirty(row_start * fb->TileCols + col_end)) {
+        ++col_end;
+    }
+
+    /* Extend down while the whole run is dirty */
+    for (; row_end < fb->TileRows; row_end++)
+    {
+        uint16_t col = col_start;
+        while (col < col_end && FrameBuffer_IsTileDirty(row_end * fb->TileCols + col)) {
+            ++col;
+        }
+        if (col != col_end) {
+            break;
+        }
+    }
+
+    for (uint16_t row = row_start; row < row_end; row++) {
+        for (uint16_t col = col_start; col < col_end; col++) {
+            uint32_t i = row * fb->TileCols + col;
+            s_flush_tiles[i >> 5] &= ~(1UL << (i & 31));
+        }
+    }
+
+    *x = col_start << FRAME_BUFFER_TILE_SHIFT;
+    *y = row_start << FRAME_BUFFER_TILE_SHIFT;
+    *width = ((col_end << FRAME_BUFFER_TILE_SHIFT) < fb->Width) ? (col_end - col_start) << FRAME_BUFFER_TILE_SHIFT : fb->Width - *x;
+    *height = ((row_end << FRAME_BUFFER_TILE_SHIFT) < fb->Height) ? (row_end - row_start) << FRAME_BUFFER_TILE_SHIFT : fb->Height - *y;
+
+    return 1;
+}
+
+/**
+  * @brief  Sends all dirty regions to GRAM by CPU, returns when finished
+  * @param  fb: Pointer to pixel buffer structure
+  * @retval None
+  */
+static void FrameBuffer_SendDirtyRegions(FrameBufferTypeDef *fb)
+{
+    uint16_t x, y, width, height;
+
+    memcpy(s_flush_tiles, fb->DirtyTiles, sizeof(s_flush_tiles));
+    memset(fb->DirtyTiles, 0, sizeof(fb->DirtyTiles));
+    s_flush_scan_tile = 0;
+
+    while (FrameBuffer_NextDirtyRegion(fb, &x, &y, &width, &height))
+    {
+        SET_WINDOW(fb->X + x, fb->Y + y, width, height);
+        PREPARE_WRITE();
+
+        for (uint16_t i = 0; i < height; i++) {
+            __IO uint16_t *row = fb->PixelData + (uint32_t)fb->Width * (y + i) + x;
+            for (uint16_t j = 0; j < width; j++) {
+                WRITE_GRAM(row[j]);
+            }
+        }
+    }
+
+    LCD_ResetWindow();
+}
+
+#if FRAME_BUFFER_USE_DMA
+
+/**
+  * @brief  Sets GRAM window for the next dirty region and prepares transfer
+  * @param  None
+  * @retval 0 if there is no region left
+  */
+static uint8_t FrameBuffer_StartRegion(void)
+{
+    /* Only even-width windows get here, so regions and rows are word aligned */
+    FrameBufferTypeDef *fb = s_flushing_fb;
+    uint16_t x, y, width, height;
+
+    if (!FrameBuffer_NextDirtyRegion(fb, &x, &y, &width, &height)) {
+        return 0;
+    }
+
+    SET_WINDOW(fb->X + x, fb->Y + y, width, height);
+    PREPARE_WRITE();
+
+    s_xfer_src_addr = s_flush_base_addr + ((uint32_t)fb->Width * y + x) * 2;
+    s_xfer_dst_addr = (uint32_t)fb->DstAddr;
+    s_xfer_src_inc = 1;
+    s_xfer_dst_inc = 0;
+    s_xfer_dst_row_skip = 0;
+
+    if (width == fb->Width) {
+        /* Rows are contiguous in buffer, send as one block */
+        s_xfer_word_count = (uint32_t)width * height / 2;
+        s_xfer_rows_left = 0;
+        FSMC_LCD_COUNT(DmaWrites, s_xfer_word_count * 2);
+    }
+    else {
+        s_xfer_row_words = width / 2;
+        s_xfer_word_count = s_xfer_row_words;
+        s_xfer_src_row_skip = (fb->Width - width) * 2;
+        s_xfer_rows_left = height - 1;
+        FSMC_LCD_COUNT(DmaWrites, s_xfer_row_words * 2 * height);
+    }
+
+    return 1;
+}
+
+/**
+  * @brief  Configures address increment of hdma_m2m and starts first chunk
+  * @note   In memory to memory mode the peripheral port is the source.
+  * @param  None
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef FrameBuffer_StartJob(void)
+{
+    hdma_m2m.XferCpltCallback = FrameBuffer_DmaXferCplt;
+    hdma_m2m.XferErrorCallback = FrameBuffer_DmaXferError;
+
+    MODIFY_REG(hdma_m2m.Instance->CR, DMA_SxCR_PINC | DMA_SxCR_MINC,
+               (s_xfer_src_inc ? DMA_SxCR_PINC : 0) | (s_xfer_dst_inc ? DMA_SxCR_MINC : 0));
+
+    return FrameBuffer_StartChunk();
+}
+
+static HAL_StatusTypeDef FrameBuffer_StartChunk(void)
+{
+    uint32_t chunk = (s_xfer_word_count > DMA_MAX_CHUNK_WORDS) ? DMA_MAX_CHUNK_WORDS : s_xfer_word_count;
+    uint32_t src_addr = s_xfer_src_addr;
+    uint32_t dst_addr = s_xfer_dst_addr;
+
+    if (s_xfer_src_inc) {
+        s_xfer_src_addr += chunk * 4;
+    }
+    if (s_xfer_dst_inc) {
+        s_xfer_dst_addr += chunk * 4;
     }
+    s_xfer_word_count -= chunk;
+
+    if (HAL_DMA_Start_IT(&hdma_m2m, src_addr, dst_addr, chunk) != HAL_OK) {
+        FrameBuffer_DmaXferError(&hdma_m2m);
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Releases DMA and LCD bus, restores hdma_m2m default configuration
+  * @param  None
+  * @retval None
+  */
+static void FrameBuffer_EndJob(void)
+{
+    FrameBufferTypeDef *fb = s_flushing_fb;
+    uint8_t job = s_bus_job;
+
+    MODIFY_REG(hdma_m2m.Instance->CR, DMA_SxCR_PINC | DMA_SxCR_MINC, DMA_SxCR_PINC);
+
+    s_flushing_fb = NULL;
+    s_bus_job = BUS_JOB_NONE;
+
+    if (job == BUS_JOB_FILL_GRAM || job == BUS_JOB_WRITE_GRAM) {
+        LCD_ResetWindow();
+    }
+    else if (job == BUS_JOB_FLUSH && fb != NULL) {
+        fb->Flushing = 0;
+
+        if (fb->FlushCpltCallback != NULL) {
+            fb->FlushCpltCallback(fb);
+        }
+    }
+}
+
+static void FrameBuffer_DmaXferCplt(DMA_HandleTypeDef *hdma)
+{
+    if (s_xfer_word_count > 0) {
+        FrameBuffer_StartChunk();
+        return;
+    }
+
+    if (s_xfer_rows_left > 0) {
+        /* Next row of a narrow rectangle */
+        --s_xfer_rows_left;
+        if (s_xfer_src_inc) {
+            s_xfer_src_addr += s_xfer_src_row_skip;
+        }
+        if (s_xfer_dst_inc) {
+            s_xfer_dst_addr += s_xfer_dst_row_skip;
+        }
+        s_xfer_word_count = s_xfer_row_words;
+        FrameBuffer_StartChunk();
+        return;
+    }
+
+    if (s_bus_job == BUS_JOB_FLUSH && FrameBuffer_StartRegion()) {
+        FrameBuffer_StartChunk();
+        return;
+    }
+
+    FrameBuffer_EndJob();
+}
+
+static void FrameBuffer_DmaXferError(DMA_HandleTypeDef *hdma)
+{
+    /* Give up the rest of this job, next update redraws everything */
+    s_xfer_word_count = 0;
+    s_xfer_rows_left = 0;
+
+    if (s_bus_job == BUS_JOB_FLUSH && s_flushing_fb != NULL) {
+        FrameBuffer_MarkDirty(s_flushing_fb, 0, 0, s_flushing_fb->Width, s_flushing_fb->Height);
+    }
+
+    FrameBuffer_EndJob();
+}
+
 #endif // FRAME_BUFFER_USE_DMA
-}
\ No newline at end of file
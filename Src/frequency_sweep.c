@@ -2,6 +2,7 @@
 #include "number_input.h"
 #include "lcd.h"
 #include "curve_chart.h"
+#include "text_label.h"
 #include "colors.h"
 #include "zlg7290.h"
 #include "lmh6518.h"
@@ -15,10 +16,18 @@ static CurveChartTypeDef chart;
 
 static _Bool is_cursor_select_A;
 static int16_t cursor_XA, cursor_XB;
+static TextLabelTypeDef cursor_mark_label;
+
+#define TRACE_AMP           0       //幅频曲线 / 矢量模式增益曲线
+#define TRACE_PHASE         1       //矢量模式相位曲线
+static TextLabelTypeDef cursor_labels[7];       //光标读数, 每行一个
+static const uint8_t cursor_label_y[7] = { 40, 64, 88, 120, 144, 168, 192 };
 
 //输出幅值控制
 static uint8_t output_amp;
 static uint8_t amp_step;
+static uint8_t output_att;			//当前PE4302衰减值 (0.5dB)
+static uint16_t output_code;		//当前DDS幅度码
 //static uint8_t pe4302_2x_loss;	// dB
 
 //扫频控制
@@ -31,12 +40,31 @@ static uint16_t data_values[MAX_SAMPLE_COUNT];
 static uint16_t normalize_values[MAX_SAMPLE_COUNT];
 static uint16_t sample_count;
 
+//矢量模式（增益/相位测量）
+static _Bool is_vector_mode;
+static _Bool is_ads8694_ready;
+static uint32_t other_sweep_freq[3];	//另一模式的扫频参数, 切换模式时互换 (幅频模式单位kHz, 矢量模式单位Hz)
+static const char *freq_unit = "MHz";
+static int32_t vector_samples[2 * (VECTOR_SAMPLE_COUNT + 1)];
+static float hann_window[VECTOR_SAMPLE_COUNT];
+static float gain_values[VECTOR_MAX_SAMPLE_COUNT];		// dB
+static float phase_values[VECTOR_MAX_SAMPLE_COUNT];		// 度, (-180, 180]
+static float normalize_gain[VECTOR_MAX_SAMPLE_COUNT];
+static float normalize_phase[VECTOR_MAX_SAMPLE_COUNT];
+static NormProfile_KeyTypeDef vector_normalize_key;	//矢量归一化数据对应的扫频参数
+static uint16_t phase_display_values[GRID_WIDTH];
+
 void FreqSweep_Init(void)
 {
     //硬件外设初始化
     PE4302_Init();
     AD9959_Init();
     ADC1_Init();
+    W25QXX_Init();
+
+    //从Flash载入幅度校准表与归一化曲线
+    AmpCal_Init();
+    NormProfile_Init();
 
     AD9959_SetFreq(OUTPUT_CHANNEL, 10000000U);
 
@@ -50,12 +78,24 @@ void FreqSweep_Init(void)
     //设置各项初始参数
     output_amp = 50;
     amp_step = 1;
+    //强制首次设置幅度时写入硬件
+    output_att = 0xFF;
+    output_code = 0xFFFF;
 
     sweep_freq[0] = 1000;
     sweep_freq[1] = 50000;
     sweep_freq[2] = 100;
     sample_count = (sweep_freq[1] - sweep_freq[0]) / sweep_freq[2];
 
+    other_sweep_freq[0] = 100;
+    other_sweep_freq[1] = 20000;
+    other_sweep_freq[2] = 100;
+
+    //I/Q解调使用的汉宁窗, 抑制非整周期截断带来的泄漏
+    for (uint16_t i = 0; i < VECTOR_SAMPLE_COUNT; i++) {
+        hann_window[i] = 0.5f - 0.5f * arm_cos_f32(2.0f * PI * i / VECTOR_SAMPLE_COUNT);
+    }
+
     //GUI 初始化
     chart.X = GRID_X;
     chart.Y = GRID_Y;
@@ -67,6 +107,8 @@ void FreqSweep_Init(void)
     chart.FineGridColor = DARKGRAY;
 
     CurveChart_Init(&chart);
+    //曲线由图表管理, 每帧只需更新数据
+    CurveChart_SetTrace(&chart, TRACE_AMP, display_values, RED);
 
     /* Interp Test */
     /*
@@ -111,7 +153,7 @@ void FreqSweep_Init(void)
     //横坐标-频率
     UpdateFreqInfoDispaly();
     //单位：MHz
-    LCD_DrawString("MHz", 16, GRID_X + GRID_WIDTH - 12, GRID_Y + GRID_HEIGHT + 20, WHITE);
+    LCD_DrawString(freq_unit, 16, GRID_X + GRID_WIDTH - 12, GRID_Y + GRID_HEIGHT + 20, WHITE);
 
     //扫频信息窗    
     LCD_DrawRect(FREQBOX_X, FREQBOX_Y, FREQBOX_WIDTH, FREQBOX_HEIGHT, WHITE);
@@ -128,18 +170,22 @@ void FreqSweep_Init(void)
     sprintf(str_buffer, "%-3u mV", (amp_step + 1) * 2);
     LCD_DrawString(str_buffer, 16, AMPBOX_X + 118, AMPBOX_Y + 32, LIGHTGRAY);
     UpdateOutputAmp();
+    UpdateNormalization();
 
     //光标读数窗
     LCD_DrawRect(CURSORBOX_X, CURSORBOX_Y, CURSORBOX_WIDTH, CURSORBOX_HEIGHT, WHITE);
     LCD_DrawString("光标选择:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 8, WHITE);
 
+    TextLabel_Init(&cursor_mark_label, CURSORBOX_X + 85, CURSORBOX_Y + 8, 88, 16, YELLOW, BLACK);
+    for (i = 0; i < 7; i++) {
+        TextLabel_Init(&cursor_labels[i], CURSORBOX_X + 85, CURSORBOX_Y + cursor_label_y[i], 88, 16, LIGHTGRAY, BLACK);
+    }
+
     LCD_DrawString("A - 频率:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 40, WHITE);
     LCD_DrawString("B - 频率:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 64, WHITE);
     LCD_DrawString("Δ- 频率:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 88, WHITE);
 
-    LCD_DrawString("A - 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 120, WHITE);
-    LCD_DrawString("B - 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 144, WHITE);
-    LCD_DrawString("Δ- 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 168, WHITE);
+    CursorLabelsDisplay();
 
     //光标初始化
     is_cursor_select_A = 1;
@@ -156,10 +202,44 @@ void FreqSweep_Start()
         {
             case 9:
                 //归一化校准
+                if (is_vector_mode) {
+                    //先清零归一化值, 扫描得到的即为直通响应
+                    for (uint16_t i = 0; i < sample_count; i++) {
+                        normalize_gain[i] = 0;
+                        normalize_phase[i] = 0;
+                    }
+                    VectorSweepAndSampling();
+                    for (uint16_t i = 0; i < sample_count; i++) {
+                        normalize_gain[i] = gain_values[i];
+                        normalize_phase[i] = phase_values[i];
+                    }
+                    vector_normalize_key = (NormProfile_KeyTypeDef){
+                        sweep_freq[0], sweep_freq[1], sweep_freq[2], output_amp, sample_count
+                    };
+                    break;
+                }
+
                 FreqSweepAndSampling();
                 for (uint16_t i = 0; i < sample_count; i++) {
                     normalize_values[i] = data_values[i] - 1241;
                 }
+                //保存到缓存, 以后切换回相同或被覆盖的扫频范围时无需重新校准
+                {
+                    NormProfile_KeyTypeDef key = {
+                        sweep_freq[0], sweep_freq[1], sweep_freq[2], output_amp, sample_count
+                    };
+                    NormProfile_Store(&key, (const int16_t *)normalize_values);
+                }
+                break;
+
+            case 10:
+                //切换 幅频特性/矢量(增益+相位) 测量模式
+                SwitchSweepMode();
+                break;
+
+            case 11:
+                //在起始频率处校准输出幅度表
+                CalibrateOutputAmp();
                 break;
 
             case 17:
@@ -172,8 +252,7 @@ void FreqSweep_Start()
 
                 sprintf(str_buffer, "%-3u mV", (amp_step + 1) * 2);
 
-                LCD_FillRect(AMPBOX_X + 118, AMPBOX_Y + 32, 48, 16, BLACK);
-                LCD_DrawString(str_buffer, 16, AMPBOX_X + 118, AMPBOX_Y + 32, LIGHTGRAY);
+                LCD_DrawStringOpaque(str_buffer, 16, AMPBOX_X + 118, AMPBOX_Y + 32, 48, LIGHTGRAY, BLACK);
                 break;
 
             case 26:
@@ -182,6 +261,7 @@ void FreqSweep_Start()
                 }
 
                 UpdateOutputAmp();
+                UpdateNormalization();
                 break;
 
             case 27:
@@ -190,8 +270,16 @@ void FreqSweep_Start()
                 }
 
                 UpdateOutputAmp();
+                UpdateNormalization();
                 break;
 
+#if LCD_USE_FATFS
+            case 12:
+                //保存图表区截图, 有帧缓冲时不回读GRAM
+                CurveChart_SaveBmpToFile(&chart, "0:sweep.bmp");
+                break;
+#endif // LCD_USE_FATFS
+
             case 33:
                 is_cursor_select_A = !is_cursor_select_A;
 
@@ -233,28 +321,40 @@ void FreqSweep_Start()
                 break;
         }
 
-        FreqSweepAndSampling();
+        if (is_vector_mode) {
+            VectorSweepAndSampling();
+        }
+        else {
+            FreqSweepAndSampling();
+        }
 
         CurveChart_RecoverLineX(&chart, cursor_XA);
         CurveChart_RecoverLineX(&chart, cursor_XB);
-        CurveChart_RecoverGrid(&chart, display_values);
 
-        //将采样数据减去归一化值
-        arm_sub_q15(data_values, normalize_values, data_values, sample_count);
-        //将采样数据缩放到图表区域范围中
-        for (size_t i = 0; i < sample_count; i++) {
-            data_values[i] *= 0.161133f;
+        if (is_vector_mode) {
+            VectorDataToDisplay();
         }
-
-        //将采样数据线性插值到图表区相同的宽度以便于显示
-        for (uint16_t i = 0; i < GRID_WIDTH; i++) {
-            //uint32_t x = (i << 20) * sample_count / GRID_WIDTH; //Watch for overflow dude!
-            uint32_t x = (i << 20) / GRID_WIDTH * sample_count;
-            display_values[i] = arm_linear_interp_q15(data_values, x, sample_count);
+        else {
+            //将采样数据减去归一化值
+            arm_sub_q15(data_values, normalize_values, data_values, sample_count);
+            //将采样数据缩放到图表区域范围中
+            for (size_t i = 0; i < sample_count; i++) {
+                data_values[i] *= 0.161133f;
+            }
+
+            //将采样数据线性插值到图表区相同的宽度以便于显示
+            for (uint16_t i = 0; i < GRID_WIDTH; i++) {
+                //uint32_t x = (i << 20) * sample_count / GRID_WIDTH; //Watch for overflow dude!
+                uint32_t x = (i << 20) / GRID_WIDTH * sample_count;
+                display_values[i] = arm_linear_interp_q15(data_values, x, sample_count);
+            }
         }
         //arm_scale_q15(display_values, 165, -10, display_values, GRID_WIDTH);
         //arm_shift_q15(display_values, -4, display_values, GRID_WIDTH);
 
+        //逐列合并擦除与重绘, 光标线画在曲线之上
+        CurveChart_UpdateTraces(&chart);
+
         if (is_cursor_select_A) {
             CurveChart_DrawDashedLineX(&chart, cursor_XA, YELLOW);
             CurveChart_DrawDashedLineX(&chart, cursor_XB, BROWN);
@@ -264,11 +364,14 @@ void FreqSweep_Start()
             CurveChart_DrawDashedLineX(&chart, cursor_XB, YELLOW);
         }
 
-        CurveChart_DrawCurve(&chart, display_values, RED);
+        if (is_vector_mode) {
+            //矢量扫描较慢, 每轮扫描后刷新光标读数
+            CursorParametersDisplay();
+        }
 
-#if GRAPH_USE_BACKBUFFER
-        LCD_BackBuffer_Update();
-#endif // GRAPH_USE_BACKBUFFER
+#if CHART_USE_FRAMEBUFFER
+        CurveChart_FrameUpdate();
+#endif // CHART_USE_FRAMEBUFFER
 
         HAL_Delay(33);
     }
@@ -280,21 +383,191 @@ static void FreqSweepAndSampling(void)
 
     //ADC开始采样对数检波电平
     HAL_ADC_Start_DMA(&hadc1, adc_sampling_values, ADC_SAMPLE_COUNT);
+    BeginSweepExport();
 
     for (uint16_t i = 0; i < sample_count; i++)
     {
-        //更新DDS输出频率
+        //更新DDS输出频率, 并按校准表修正该频点的输出幅度
         AD9959_SetFreq(OUTPUT_CHANNEL, output_freq * 1000U);
+        SetOutputLevel(output_freq);
         //等待检波电平稳定
         DelayUs(320);
         //记录采样点（带均值滤波）
         arm_mean_q15(adc_sampling_values, ADC_SAMPLE_COUNT, &data_values[i]);
+        //通过USB实时导出原始检波码与归一化后的增益
+        SweepExport_AddPoint(output_freq * 1000U, data_values[i],
+            ((int16_t)(data_values[i] - normalize_values[i]) * 0.161133f - 200.0f) * 0.2f, 0.0f);
         //频率递进
         output_freq += sweep_freq[2];
     }
 
     //ADC停止采样
     HAL_ADC_Stop_DMA(&hadc1);
+    SweepExport_End();
+}
+
+static void VectorSweepAndSampling(void)
+{
+    uint32_t output_freq = sweep_freq[0];
+    float dut_i, dut_q, ref_i, ref_q;
+
+    //ADS8694 CH0/CH1 交替扫描, 缓冲区中偶数位为被测信号, 奇数位为参考信号
+    ADS8694_ConfigSampling(vector_samples, 2 * (VECTOR_SAMPLE_COUNT + 1),
+        ADS8694_CHANNEL_0 | ADS8694_CHANNEL_1, INPUT_RANGE_BIPOLAR_0_625x);
+    BeginSweepExport();
+
+    for (uint16_t i = 0; i < sample_count; i++)
+    {
+        //输出通道与参考通道在同一次IO更新中改变频率并同步清零相位累加器, 两者保持相位相干
+        AD9959_StageFreq(OUTPUT_CHANNEL | REFERENCE_CHANNEL, output_freq);
+        AD9959_StagePhaseGroup(OUTPUT_CHANNEL | REFERENCE_CHANNEL, 0, 0);
+        AD9959_CommitCoherent();
+        SetOutputLevel(output_freq / 1000U);
+
+        //采样率随频率自适应, 保证每次记录包含足够的周期数
+        uint32_t sampling_rate = output_freq * (VECTOR_SAMPLE_COUNT / VECTOR_CYCLES_PER_RECORD);
+        if (sampling_rate > VECTOR_MAX_SAMPLING_RATE) {
+            sampling_rate = VECTOR_MAX_SAMPLING_RATE;
+        }
+        ADS8694_SetSamplingRate(sampling_rate * 2);
+
+        //等待被测网络稳定 (至少两个周期)
+        uint32_t settle_us = 2000000U / output_freq;
+        if (settle_us > 60000U) {
+            HAL_Delay(settle_us / 1000U);
+        }
+        else {
+            DelayUs((settle_us < 320U) ? 320U : settle_us);
+        }
+
+        ADS8694_StartSampling();
+
+        //丢弃第一对样点(上一次采样遗留的转换结果)
+        IQ_Demodulate(&vector_samples[2], output_freq, sampling_rate, &dut_i, &dut_q);
+        IQ_Demodulate(&vector_samples[3], output_freq, sampling_rate, &ref_i, &ref_q);
+
+        float ref_power = ref_i * ref_i + ref_q * ref_q;
+        float dut_power = dut_i * dut_i + dut_q * dut_q;
+
+        if (ref_power > 0.0f && dut_power > 0.0f) {
+            gain_values[i] = 10.0f * log10f(dut_power / ref_power) - normalize_gain[i];
+            //参考通道比被测通道晚半个转换周期采样, 补偿 360 * f / (2 * fs) 度的相位差
+            float phase = (atan2f(dut_q, dut_i) - atan2f(ref_q, ref_i)) * (180.0f / PI)
+                + 180.0f * output_freq / sampling_rate;
+            phase_values[i] = WrapPhase(phase - normalize_phase[i]);
+        }
+        else {
+            gain_values[i] = -100.0f;
+            phase_values[i] = 0.0f;
+        }
+
+        SweepExport_AddPoint(output_freq, 0, gain_values[i], phase_values[i]);
+
+        //频率递进
+        output_freq += sweep_freq[2];
+    }
+
+    SweepExport_End();
+}
+
+static void IQ_Demodulate(const int32_t *samples, uint32_t freq, uint32_t samplingRate, float *pI, float *pQ)
+{
+    float mean = 0.0f;
+    float i_sum = 0.0f, q_sum = 0.0f;
+    float lo_cos = 1.0f, lo_sin = 0.0f;
+    float step_cos, step_sin;
+
+    //去除直流偏置 (双极性输入的码值以满量程一半为零点)
+    for (uint16_t k = 0; k < VECTOR_SAMPLE_COUNT; k++) {
+        mean += samples[2 * k];
+    }
+    mean /= VECTOR_SAMPLE_COUNT;
+
+    //本振用复数旋转递推生成, 每个样点只需4次乘法
+    arm_sin_cos_f32(-360.0f * freq / samplingRate, &step_sin, &step_cos);
+
+    for (uint16_t k = 0; k < VECTOR_SAMPLE_COUNT; k++)
+    {
+        float x = (samples[2 * k] - mean) * hann_window[k];
+        i_sum += x * lo_cos;
+        q_sum += x * lo_sin;
+
+        float temp = lo_cos * step_cos - lo_sin * step_sin;
+        lo_sin = lo_cos * step_sin + lo_sin * step_cos;
+        lo_cos = temp;
+    }
+
+    *pI = i_sum;
+    *pQ = q_sum;
+}
+
+static void VectorDataToDisplay(void)
+{
+    for (uint16_t i = 0; i < GRID_WIDTH; i++)
+    {
+        //与幅频模式相同的横轴映射, 线性插值到图表宽度
+        float x = (float)i * sample_count / GRID_WIDTH;
+        uint16_t n = x;
+        uint16_t n1 = (n + 1 < sample_count) ? n + 1 : n;
+        float t = x - n;
+
+        //增益: 每像素0.2dB, 0dB 位于图表中线
+        float y = 200.0f + (gain_values[n] + (gain_values[n1] - gain_values[n]) * t) * 5.0f;
+        y = (y < 0.0f) ? 0.0f : (y > GRID_HEIGHT - 1) ? GRID_HEIGHT - 1 : y;
+        display_values[i] = y;
+
+        //相位: 每大格45度; 在±180度处跳变, 不插值以免画出虚假的过渡
+        y = 200.0f + ((t < 0.5f) ? phase_values[n] : phase_values[n1]) * (50.0f / 45.0f);
+        y = (y < 0.0f) ? 0.0f : (y > GRID_HEIGHT - 1) ? GRID_HEIGHT - 1 : y;
+        phase_display_values[i] = y;
+    }
+}
+
+static void SwitchSweepMode(void)
+{
+    is_vector_mode = !is_vector_mode;
+
+    //两种模式各自保存一套扫频参数
+    for (uint8_t i = 0; i < 3; i++) {
+        uint32_t temp = sweep_freq[i];
+        sweep_freq[i] = other_sweep_freq[i];
+        other_sweep_freq[i] = temp;
+    }
+    sample_count = (sweep_freq[1] - sweep_freq[0]) / sweep_freq[2];
+    freq_unit = (is_vector_mode) ? "kHz" : "MHz";
+
+    if (is_vector_mode) {
+        if (!is_ads8694_ready) {
+            ADS8694_Init();
+            is_ads8694_ready = 1;
+        }
+        //参考通道满幅输出
+        AD9959_SetAmp(REFERENCE_CHANNEL, 1023);
+    }
+    else {
+        AD9959_SetAmp(REFERENCE_CHANNEL, 0);
+    }
+    UpdateNormalization();
+
+    //旧模式的曲线在下次更新时被替换, 相位曲线仅在矢量模式显示
+    CurveChart_RecoverLineX(&chart, cursor_XA);
+    CurveChart_RecoverLineX(&chart, cursor_XB);
+    CurveChart_SetTrace(&chart, TRACE_PHASE, is_vector_mode ? phase_display_values : NULL, CYAN);
+
+    for (uint16_t i = 0; i < GRID_WIDTH; i++) {
+        display_values[i] = 0;
+        phase_display_values[i] = 0;
+    }
+    for (uint16_t i = 0; i < sample_count && i < VECTOR_MAX_SAMPLE_COUNT; i++) {
+        gain_values[i] = 0;
+        phase_values[i] = 0;
+    }
+
+    LCD_DrawStringOpaque(freq_unit, 16, GRID_X + GRID_WIDTH - 12, GRID_Y + GRID_HEIGHT + 20, 24, WHITE, BLACK);
+
+    UpdateFreqInfoDispaly();
+    CursorLabelsDisplay();
+    CursorParametersDisplay();
 }
 
 static void UpdateFreqInfoDispaly(void)
@@ -312,7 +585,7 @@ static void UpdateFreqInfoDispaly(void)
 
     //更新扫频信息窗显示数值
     for (uint8_t i = 0; i < 3; i++) {
-        sprintf(str_buffer, "%-6.3f MHz", sweep_freq[i] * 0.001f);
+        sprintf(str_buffer, "%-6.3f %s", sweep_freq[i] * 0.001f, freq_unit);
         LCD_DrawString(str_buffer, 16, FREQBOX_X + 85, FREQBOX_Y + 8 + 24 * i, LIGHTGRAY);
     }
 
@@ -322,9 +595,9 @@ static void UpdateFreqInfoDispaly(void)
 
 static inline void UpdateOutputAmp(void)
 {
-    //查表并设置衰减值
-    PE4302_SetAttenuation(amp_table[50 - output_amp][0]);
-    AD9959_SetAmp(OUTPUT_CHANNEL, amp_table[50 - output_amp][1]);
+    //按扫频范围中点查校准表并设置衰减值, 扫频时逐点修正
+    uint32_t center_freq = (sweep_freq[0] + sweep_freq[1]) / 2;
+    SetOutputLevel((is_vector_mode) ? center_freq / 1000U : center_freq);
 
     //使用大黑块进行[数据删除]
     LCD_FillRect(AMPBOX_X + 118, AMPBOX_Y + 8, 48, 16, BLACK);
@@ -334,13 +607,176 @@ static inline void UpdateOutputAmp(void)
     LCD_DrawString(str_buffer, 16, AMPBOX_X + 118, AMPBOX_Y + 8, LIGHTGRAY);
 }
 
+static void SetOutputLevel(uint32_t freq)
+{
+    uint8_t att;
+    uint16_t code;
+
+    //校准表在各2mV档位及各频段之间插值, 输出幅度在全频段内保持平坦
+    AmpCal_Lookup(freq, output_amp * 2.0f, &att, &code);
+
+    //只在设置改变时才写入, 减少扫频时的额外开销
+    if (att != output_att) {
+        PE4302_SetAttenuation(att);
+        output_att = att;
+    }
+    if (code != output_code) {
+        AD9959_SetAmp(OUTPUT_CHANNEL, code);
+        output_code = code;
+    }
+}
+
+static void CalibrateOutputAmp(void)
+{
+    //用示波器观察输出, 逐档调节衰减值与DDS码值, 使输出幅度与档位一致
+    //  18/19: 上一档/下一档  26/27: 码值减/加(步进同幅度调节步进)
+    //  34/35: 衰减减/加0.5dB  17: 保存为起始频率处的频段  11: 放弃
+    uint32_t freq = sweep_freq[0];
+    uint16_t entries[AMP_CAL_LEVEL_COUNT];
+    uint8_t level = 0;
+    uint8_t att;
+    uint16_t code;
+
+    //矢量模式频率低于校准频段, 只在幅频模式下校准
+    if (is_vector_mode) {
+        return;
+    }
+
+    //以当前的插值结果作为各档初值
+    for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+        AmpCal_Lookup(freq, AMP_CAL_MAX_LEVEL - AMP_CAL_LEVEL_STEP * i, &att, &code);
+        entries[i] = AMP_CAL_ENTRY(att, code);
+    }
+
+    AD9959_SetFreq(OUTPUT_CHANNEL, freq * 1000U);
+
+    LCD_FillRect(AMPBOX_X + 8, AMPBOX_Y + 8, AMPBOX_WIDTH - 16, 40, BLACK);
+    sprintf(str_buffer, "校准 %.3f MHz:", freq * 0.001f);
+    LCD_DrawString(str_buffer, 16, AMPBOX_X + 8, AMPBOX_Y + 8, YELLOW);
+    LCD_DrawString("衰减/码值:", 16, AMPBOX_X + 8, AMPBOX_Y + 32, YELLOW);
+
+    for (;;)
+    {
+        att = AMP_CAL_ENTRY_ATT(entries[level]);
+        code = AMP_CAL_ENTRY_CODE(entries[level]);
+
+        //输出并显示当前档位的设置
+        PE4302_SetAttenuation(att);
+        AD9959_SetAmp(OUTPUT_CHANNEL, code);
+        sprintf(str_buffer, "%-3u mV", AMP_CAL_MAX_LEVEL - AMP_CAL_LEVEL_STEP * level);
+        LCD_DrawStringOpaque(str_buffer, 16, AMPBOX_X + 174, AMPBOX_Y + 8, 56, LIGHTGRAY, BLACK);
+        sprintf(str_buffer, "%-2u/%-4u", att, code);
+        LCD_DrawStringOpaque(str_buffer, 16, AMPBOX_X + 118, AMPBOX_Y + 32, 64, LIGHTGRAY, BLACK);
+
+        uint8_t key;
+        while ((key = ZLG7290_ReadKey()) == 0) {
+            HAL_Delay(33);
+        }
+
+        switch (key)
+        {
+            case 18:
+                level = (level == 0) ? AMP_CAL_LEVEL_COUNT - 1 : level - 1;
+                continue;
+
+            case 19:
+                level = (level == AMP_CAL_LEVEL_COUNT - 1) ? 0 : level + 1;
+                continue;
+
+            case 26:
+                code = (code > amp_step + 1) ? code - (amp_step + 1) : 0;
+                break;
+
+            case 27:
+                code = (code + amp_step + 1 < 1023) ? code + amp_step + 1 : 1023;
+                break;
+
+            case 34:
+                att = (att > 0) ? att - 1 : 0;
+                break;
+
+            case 35:
+                att = (att < 63) ? att + 1 : 63;
+                break;
+
+            case 17:
+                //频段已满时不保存
+                if (AmpCal_SetBand(freq, entries) != HAL_OK || AmpCal_Save() != HAL_OK) {
+                    LCD_DrawStringOpaque("FULL", 16, AMPBOX_X + 190, AMPBOX_Y + 32, 32, RED, BLACK);
+                    HAL_Delay(1000);
+                }
+                //no break
+            case 11:
+                //恢复幅度信息窗, 强制按新的校准表重新设置输出
+                LCD_FillRect(AMPBOX_X + 8, AMPBOX_Y + 8, AMPBOX_WIDTH - 16, 40, BLACK);
+                LCD_DrawString("当前输出幅度:", 16, AMPBOX_X + 8, AMPBOX_Y + 8, WHITE);
+                LCD_DrawString("幅度调节步进:", 16, AMPBOX_X + 8, AMPBOX_Y + 32, WHITE);
+                sprintf(str_buffer, "%-3u mV", (amp_step + 1) * 2);
+                LCD_DrawString(str_buffer, 16, AMPBOX_X + 118, AMPBOX_Y + 32, LIGHTGRAY);
+                output_att = 0xFF;
+                output_code = 0xFFFF;
+                UpdateOutputAmp();
+                return;
+
+            default:
+                continue;
+        }
+
+        entries[level] = AMP_CAL_ENTRY(att, code);
+    }
+}
+
+static void BeginSweepExport(void)
+{
+    //导出数据统一使用Hz为单位
+    uint32_t scale = (is_vector_mode) ? 1U : 1000U;
+
+    SweepExport_InfoTypeDef info = {
+        .Start = sweep_freq[0] * scale,
+        .Stop = sweep_freq[1] * scale,
+        .Step = sweep_freq[2] * scale,
+        .Count = sample_count,
+        .Amplitude = output_amp * 2,
+        .Mode = (is_vector_mode) ? SWEEP_MODE_VECTOR : SWEEP_MODE_MAGNITUDE,
+    };
+
+    SweepExport_Begin(&info);
+}
+
+static void UpdateNormalization(void)
+{
+    NormProfile_KeyTypeDef key = {
+        sweep_freq[0], sweep_freq[1], sweep_freq[2], output_amp, sample_count
+    };
+
+    //矢量模式使用独立的归一化数据, 扫频参数与校准时不同则频点已对不上, 清除
+    if (is_vector_mode) {
+        if (key.Start != vector_normalize_key.Start || key.Stop != vector_normalize_key.Stop
+            || key.Step != vector_normalize_key.Step || key.Amplitude != vector_normalize_key.Amplitude
+            || key.Count != vector_normalize_key.Count) {
+            for (uint16_t i = 0; i < sample_count; i++) {
+                normalize_gain[i] = 0;
+                normalize_phase[i] = 0;
+            }
+        }
+        return;
+    }
+
+    //缓存中没有相同或覆盖当前范围的曲线时, 清除旧的归一化值
+    if (NormProfile_Fetch(&key, (int16_t *)normalize_values) != HAL_OK) {
+        for (uint16_t i = 0; i < sample_count; i++) {
+            normalize_values[i] = 0;
+        }
+    }
+}
+
 static inline void FreqParametersDisplay(uint8_t i, _Bool is_selected)
 {
     uint16_t back_color = (is_selected) ? LIGHTGRAY : BLACK;
     uint16_t font_color = (is_selected) ? BLACK : LIGHTGRAY;
 
     LCD_FillRect(FREQBOX_X + 85, FREQBOX_Y + 8 + 24 * i, 80, 16, back_color);
-    sprintf(str_buffer, "%-6.3f MHz", sweep_freq[i] * 0.001f);
+    sprintf(str_buffer, "%-6.3f %s", sweep_freq[i] * 0.001f, freq_unit);
     LCD_DrawString(str_buffer, 16, FREQBOX_X + 85, FREQBOX_Y + 8 + 24 * i, font_color);
 }
 
@@ -349,7 +785,7 @@ static void SetFreqParameters(void)
     uint8_t i = 0;
     float input_val;
 
-    uint16_t backup_sweep_freq[3];
+    uint32_t backup_sweep_freq[3];
     backup_sweep_freq[0] = sweep_freq[0];
     backup_sweep_freq[1] = sweep_freq[1];
     backup_sweep_freq[2] = sweep_freq[2];
@@ -398,7 +834,8 @@ static void SetFreqParameters(void)
 
             case 17:
                 //输入的扫频范围无效 还原原来的范围
-                if (sweep_freq[0] > sweep_freq[1] || sweep_freq[1] < 100U || sweep_freq[1] > 200000U) {
+                if (sweep_freq[0] > sweep_freq[1] || sweep_freq[1] < 100U || sweep_freq[0] == 0
+                    || sweep_freq[1] > ((is_vector_mode) ? VECTOR_MAX_FREQ : 200000U)) {
                     sweep_freq[0] = backup_sweep_freq[0];
                     sweep_freq[1] = backup_sweep_freq[1];
                 }
@@ -406,12 +843,14 @@ static void SetFreqParameters(void)
                 sample_count = (sweep_freq[1] - sweep_freq[0]) / sweep_freq[2];
 
                 //采样点太多或太少 还原原来的频率步进
-                if (sample_count < MIN_SAMPLE_COUNT || sample_count > MAX_SAMPLE_COUNT) {
+                if (sample_count < ((is_vector_mode) ? VECTOR_MIN_SAMPLE_COUNT : MIN_SAMPLE_COUNT)
+                    || sample_count > ((is_vector_mode) ? VECTOR_MAX_SAMPLE_COUNT : MAX_SAMPLE_COUNT)) {
                     sweep_freq[2] = backup_sweep_freq[2];
                     sample_count = (sweep_freq[1] - sweep_freq[0]) / sweep_freq[2];
                 }
 
                 UpdateFreqInfoDispaly();
+                UpdateNormalization();
                 return;
         }
 
@@ -449,33 +888,101 @@ static void GetCodeTable(void)
 
 static inline void CursorParametersDisplay(void)
 {
-    //用大黑块进行[数据删除]
-    LCD_FillRect(CURSORBOX_X + 85, CURSORBOX_Y + 8, 88, 180, BLACK);
-
-    uint8_t mark = (is_cursor_select_A) ? 'A' : 'B';
-    LCD_DrawCharASCII(mark, 16, CURSORBOX_X + 85, CURSORBOX_Y + 8, YELLOW);
+    //读数标签只重绘变化的字符, 不再整块清除
+    TextLabel_Update(&cursor_mark_label, (is_cursor_select_A) ? "A" : "B");
 
     float freq_A = (sweep_freq[0] + (sweep_freq[1] - sweep_freq[0]) * cursor_XA / GRID_WIDTH) * 0.001f;
     float freq_B = (sweep_freq[0] + (sweep_freq[1] - sweep_freq[0]) * cursor_XB / GRID_WIDTH) * 0.001f;
 
-    sprintf(str_buffer, "%-6.3f MHz", freq_A);
-    LCD_DrawString(str_buffer, 16, CURSORBOX_X + 85, CURSORBOX_Y + 40, LIGHTGRAY);
+    sprintf(str_buffer, "%-6.3f %s", freq_A, freq_unit);
+    TextLabel_Update(&cursor_labels[0], str_buffer);
+
+    sprintf(str_buffer, "%-6.3f %s", freq_B, freq_unit);
+    TextLabel_Update(&cursor_labels[1], str_buffer);
+
+    sprintf(str_buffer, "%-6.3f %s", freq_B - freq_A, freq_unit);
+    TextLabel_Update(&cursor_labels[2], str_buffer);
 
-    sprintf(str_buffer, "%-6.3f MHz", freq_B);
-    LCD_DrawString(str_buffer, 16, CURSORBOX_X + 85, CURSORBOX_Y + 64, LIGHTGRAY);
+    if (is_vector_mode) {
+        uint16_t n = cursor_XA * sample_count / GRID_WIDTH;
 
-    sprintf(str_buffer, "%-6.3f MHz", freq_B - freq_A);
-    LCD_DrawString(str_buffer, 16, CURSORBOX_X + 85, CURSORBOX_Y + 88, LIGHTGRAY);
+        sprintf(str_buffer, "%-6.2f dB", gain_values[n]);
+        TextLabel_Update(&cursor_labels[3], str_buffer);
+
+        sprintf(str_buffer, "%-6.1f deg", phase_values[n]);
+        TextLabel_Update(&cursor_labels[4], str_buffer);
+
+        //群延时 τ = -dφ/dω, 取光标处相邻两个频点
+        if (n + 1 >= sample_count) {
+            n = sample_count - 2;
+        }
+        float delay = -WrapPhase(phase_values[n + 1] - phase_values[n]) / (360.0f * sweep_freq[2]);
+        sprintf(str_buffer, "%-6.1f us", delay * 1e6f);
+        TextLabel_Update(&cursor_labels[5], str_buffer);
+
+        //相位裕度: 增益首次下穿0dB处, 展开后的相位与-180度之差
+        float phase = phase_values[0];
+        float last_phase = phase;
+        for (n = 1; n < sample_count; n++) {
+            last_phase = phase;
+            phase += WrapPhase(phase_values[n] - phase_values[n - 1]);
+            if (gain_values[n - 1] >= 0.0f && gain_values[n] < 0.0f) {
+                break;
+            }
+        }
+
+        if (n < sample_count) {
+            float t = gain_values[n - 1] / (gain_values[n - 1] - gain_values[n]);
+            sprintf(str_buffer, "%-6.1f deg", 180.0f + last_phase + (phase - last_phase) * t);
+        }
+        else {
+            sprintf(str_buffer, "--");
+        }
+        TextLabel_Update(&cursor_labels[6], str_buffer);
+
+        return;
+    }
 
     float gain_A = (display_values[cursor_XA] - 200) * 0.2f;
     float gain_B = (display_values[cursor_XB] - 200) * 0.2f;
 
     sprintf(str_buffer, "%-6.3f dB", gain_A);
-    LCD_DrawString(str_buffer, 16, CURSORBOX_X + 85, CURSORBOX_Y + 120, LIGHTGRAY);
+    TextLabel_Update(&cursor_labels[3], str_buffer);
 
     sprintf(str_buffer, "%-6.3f dB", gain_B);
-    LCD_DrawString(str_buffer, 16, CURSORBOX_X + 85, CURSORBOX_Y + 144, LIGHTGRAY);
+    TextLabel_Update(&cursor_labels[4], str_buffer);
 
     sprintf(str_buffer, "%-6.3f dB", gain_B - gain_A);
-    LCD_DrawString(str_buffer, 16, CURSORBOX_X + 85, CURSORBOX_Y + 168, LIGHTGRAY);
+    TextLabel_Update(&cursor_labels[5], str_buffer);
+
+    //幅频模式没有相位裕度一行
+    TextLabel_Update(&cursor_labels[6], "");
+}
+
+static inline void CursorLabelsDisplay(void)
+{
+    LCD_FillRect(CURSORBOX_X + 8, CURSORBOX_Y + 120, 76, 88, BLACK);
+
+    if (is_vector_mode) {
+        LCD_DrawString("A - 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 120, WHITE);
+        LCD_DrawString("A - 相位:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 144, WHITE);
+        LCD_DrawString("A - 时延:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 168, WHITE);
+        LCD_DrawString("相位裕度:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 192, WHITE);
+    }
+    else {
+        LCD_DrawString("A - 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 120, WHITE);
+        LCD_DrawString("B - 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 144, WHITE);
+        LCD_DrawString("Δ- 增益:", 16, CURSORBOX_X + 8, CURSORBOX_Y + 168, WHITE);
+    }
+}
+
+static inline float WrapPhase(float phase)
+{
+    while (phase > 180.0f) {
+        phase -= 360.0f;
+    }
+    while (phase <= -180.0f) {
+        phase += 360.0f;
+    }
+    return phase;
 }
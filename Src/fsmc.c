@@ -1,10 +1,18 @@
 /* Includes ------------------------------------------------------------------*/
 #include "fsmc.h"
 
+#if FSMC_LCD_BUS_STATS
+#include <stdio.h>
+#endif // FSMC_LCD_BUS_STATS
+
 SRAM_HandleTypeDef hsram1;
 SRAM_HandleTypeDef hsram_lcd;
 static _Bool s_is_fsmc_initialized = 0;
 
+#if FSMC_LCD_BUS_STATS
+FSMC_LCD_BusStatsTypeDef fsmc_lcd_bus_stats;
+#endif // FSMC_LCD_BUS_STATS
+
 void FSMC_Init(void)
 {
     HAL_FSMC_MspInit();
@@ -85,6 +93,51 @@ void FSMC_Init(void)
     }
 }
 
+#if FSMC_LCD_BUS_STATS
+/**
+  * @brief  Clears LCD bus counters
+  * @param  None
+  * @retval None
+  */
+void FSMC_LCD_ResetBusStats(void)
+{
+    fsmc_lcd_bus_stats = (FSMC_LCD_BusStatsTypeDef){ 0 };
+}
+
+/**
+  * @brief  Estimates HCLK cycles the LCD bus was busy for
+  * @param  stats: Counters to estimate from
+  * @retval Bus cycles
+  */
+uint32_t FSMC_LCD_GetBusCycles(const FSMC_LCD_BusStatsTypeDef *stats)
+{
+    return (stats->RegSelects + stats->DataWrites + stats->DmaWrites) * FSMC_LCD_WRITE_CYCLES
+        + stats->DataReads * FSMC_LCD_READ_CYCLES;
+}
+
+/**
+  * @brief  Marks the end of a drawn frame
+  * @note   Every FSMC_LCD_BUS_STATS_PERIOD frames the average bus traffic per
+  *         frame is printed and the counters are cleared.
+  * @param  tag: Name of the drawing loop, printed with the report
+  * @retval None
+  */
+void FSMC_LCD_BusStatsFrameDone(const char *tag)
+{
+    FSMC_LCD_BusStatsTypeDef *stats = &fsmc_lcd_bus_stats;
+
+    if (++stats->Frames < FSMC_LCD_BUS_STATS_PERIOD) {
+        return;
+    }
+
+    printf("[%s] LCD bus per frame: %lu cmd, %lu wr, %lu dma, %lu rd, %lu cycles\n", tag,
+        stats->RegSelects / stats->Frames, stats->DataWrites / stats->Frames,
+        stats->DmaWrites / stats->Frames, stats->DataReads / stats->Frames,
+        FSMC_LCD_GetBusCycles(stats) / stats->Frames);
+    FSMC_LCD_ResetBusStats();
+}
+#endif // FSMC_LCD_BUS_STATS
+
 static void HAL_FSMC_MspInit(void)
 {
     if (s_is_fsmc_initialized) {
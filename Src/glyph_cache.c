@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file       glyph_cache.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      Pre-rasterized glyph cache
+  *
+  * @note       Holds glyphs already expanded to RGB565 row-major blocks, keyed
+  *             by character, font size and colours, so opaque text can be
+  *             burst into GRAM without re-expanding font bitmaps. Blocks live
+  *             in CCM RAM (CPU only, never a DMA source) in one pool per font
+  *             size; a full pool replaces its least recently used glyph.
+  *
+  *             Glyphs looked up since the last GlyphCache_BeginRun() are
+  *             pinned, so a run of glyphs resolved for one blit never evicts
+  *             its own members. Alloc returns NULL when that is impossible.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "glyph_cache.h"
+
+/* Private Marcos ------------------------------------------------------------*/
+#define POOL_COUNT              4
+#define SLOT_TOTAL              (GLYPH_CACHE_SLOTS_16 + GLYPH_CACHE_SLOTS_24 + \
+                                 GLYPH_CACHE_SLOTS_32 + GLYPH_CACHE_SLOTS_40)
+
+#define GLYPH_BYTES(SIZE)       ((uint32_t)(SIZE) * ((SIZE) / 2) * sizeof(uint16_t))
+#define PIXEL_BYTES             (GLYPH_CACHE_SLOTS_16 * GLYPH_BYTES(16) + GLYPH_CACHE_SLOTS_24 * GLYPH_BYTES(24) + \
+                                 GLYPH_CACHE_SLOTS_32 * GLYPH_BYTES(32) + GLYPH_CACHE_SLOTS_40 * GLYPH_BYTES(40))
+
+/* Private variables ---------------------------------------------------------*/
+static GlyphCache_EntryTypeDef s_entries[SLOT_TOTAL];
+static GlyphCache_PoolTypeDef s_pools[POOL_COUNT] = {
+    { 16, GLYPH_CACHE_SLOTS_16, s_entries },
+    { 24, GLYPH_CACHE_SLOTS_24, s_entries + GLYPH_CACHE_SLOTS_16 },
+    { 32, GLYPH_CACHE_SLOTS_32, s_entries + GLYPH_CACHE_SLOTS_16 + GLYPH_CACHE_SLOTS_24 },
+    { 40, GLYPH_CACHE_SLOTS_40, s_entries + GLYPH_CACHE_SLOTS_16 + GLYPH_CACHE_SLOTS_24 + GLYPH_CACHE_SLOTS_32 },
+};
+static uint32_t s_run;
+
+/* Glyph blocks, .ccmram is a NOLOAD section in CCM set up by the linker script */
+static uint8_t s_pixels[PIXEL_BYTES] __attribute__((section(".ccmram"), aligned(4)));
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Carves the CCM pixel area into glyph slots
+  * @retval None
+  */
+void GlyphCache_Init(void)
+{
+    uint8_t *addr = s_pixels;
+
+    for (uint8_t i = 0; i < POOL_COUNT; i++) {
+        for (uint8_t j = 0; j < s_pools[i].Count; j++) {
+            s_pools[i].Entries[j].Pixels = (uint16_t *)addr;
+            addr += GLYPH_BYTES(s_pools[i].FontSize);
+        }
+    }
+
+    GlyphCache_Invalidate();
+}
+
+/**
+  * @brief  Drops every cached glyph
+  * @note   Call this whenever the font data behind the glyphs changes
+  * @retval None
+  */
+void GlyphCache_Invalidate(void)
+{
+    for (uint8_t i = 0; i < SLOT_TOTAL; i++) {
+        s_entries[i].Char = 0;
+        s_entries[i].LastUse = 0;
+    }
+    s_run = 1;
+}
+
+/**
+  * @brief  Starts a new run, releasing glyphs pinned by the previous one
+  * @retval None
+  */
+void GlyphCache_BeginRun(void)
+{
+    s_run++;
+}
+
+/**
+  * @brief  Looks up a rasterized glyph
+  * @param  ch: Character code
+  * @param  font_size: Font size (glyph height)
+  * @param  color: Foreground color
+  * @param  bg_color: Background color
+  * @retval Pixel block of the glyph, NULL on a miss
+  */
+uint16_t* GlyphCache_Find(uint16_t ch, uint8_t font_size, uint16_t color, uint16_t bg_color)
+{
+    GlyphCache_PoolTypeDef *pool = GlyphCache_GetPool(font_size);
+
+    if (pool == NULL || ch == 0) {
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < pool->Count; i++) {
+        GlyphCache_EntryTypeDef *entry = &pool->Entries[i];
+        if (entry->Char == ch && entry->Color == color && entry->BgColor == bg_color) {
+            entry->LastUse = s_run;
+            return entry->Pixels;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Claims a slot for a glyph, evicting the least recently used one
+  * @note   The caller must fill the returned block before the next lookup
+  * @param  ch: Character code
+  * @param  font_size: Font size (glyph height)
+  * @param  color: Foreground color
+  * @param  bg_color: Background color
+  * @retval Pixel block to rasterize into, NULL if the size is not cached or
+  *         every slot of the pool is pinned by the current run
+  */
+uint16_t* GlyphCache_Alloc(uint16_t ch, uint8_t font_size, uint16_t color, uint16_t bg_color)
+{
+    GlyphCache_PoolTypeDef *pool = GlyphCache_GetPool(font_size);
+    GlyphCache_EntryTypeDef *victim = NULL;
+
+    if (pool == NULL || ch == 0) {
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < pool->Count; i++) {
+        GlyphCache_EntryTypeDef *entry = &pool->Entries[i];
+        if (entry->LastUse == s_run) {
+            continue;
+        }
+        if (victim == NULL || entry->LastUse < victim->LastUse) {
+            victim = entry;
+        }
+    }
+
+    if (victim == NULL) {
+        return NULL;
+    }
+
+    victim->Char = ch;
+    victim->FontSize = font_size;
+    victim->Color = color;
+    victim->BgColor = bg_color;
+    victim->LastUse = s_run;
+
+    return victim->Pixels;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Gets the pool holding glyphs of a font size
+  * @param  font_size: Font size
+  * @retval Pool, NULL if the size is not cached
+  */
+static GlyphCache_PoolTypeDef* GlyphCache_GetPool(uint8_t font_size)
+{
+    for (uint8_t i = 0; i < POOL_COUNT; i++) {
+        if (s_pools[i].FontSize == font_size) {
+            return &s_pools[i];
+        }
+    }
+
+    return NULL;
+}
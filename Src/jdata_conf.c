@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file       jdata_conf.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      LibJPEG data source/destination on FatFs files
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "jdata_conf.h"
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Reads JPEG data from a file
+  * @param  file: FatFs file object
+  * @param  buf: Data buffer
+  * @param  sizeofbuf: Bytes to read
+  * @retval Bytes actually read, 0 on error
+  */
+size_t read_file(JFILE *file, uint8_t *buf, uint32_t sizeofbuf)
+{
+    UINT read_count;
+
+    if (f_read(file, buf, sizeofbuf, &read_count) != FR_OK) {
+        return 0;
+    }
+    return read_count;
+}
+
+/**
+  * @brief  Writes JPEG data to a file
+  * @param  file: FatFs file object
+  * @param  buf: Data buffer
+  * @param  sizeofbuf: Bytes to write
+  * @retval Bytes actually written, 0 on error
+  */
+size_t write_file(JFILE *file, uint8_t *buf, uint32_t sizeofbuf)
+{
+    UINT write_count;
+
+    if (f_write(file, buf, sizeofbuf, &write_count) != FR_OK) {
+        return 0;
+    }
+    return write_count;
+}
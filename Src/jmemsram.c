@@ -0,0 +1,191 @@
+/**
+  ******************************************************************************
+  * @file       jmemsram.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      LibJPEG memory manager backend on an external SRAM arena
+  *
+  * @note       Replaces jmemnobs.c. All LibJPEG objects are carved from one
+  *             bump arena in FSMC SRAM, so decoding and encoding never touch
+  *             the heap. The arena is rewound when the last codec object is
+  *             destroyed, or explicitly with JpegArena_Reset().
+  *             Define JPEG_ARENA_HOST to back the arena with a static array,
+  *             e.g. to measure peak usage of real images in a host build.
+  *
+  *             LibJPEG releases its pools in reverse order of allocation, so
+  *             freeing the topmost block rewinds the arena, other frees are
+  *             only reclaimed by the rewind. No backing store is provided,
+  *             images that need more than the ceiling fail with an error.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jmemsys.h"
+#include "jmemsram.h"
+
+#ifndef JPEG_ARENA_HOST
+#include "fsmc.h"
+#include "sram.h"
+#endif // JPEG_ARENA_HOST
+
+/* Private Marcos ------------------------------------------------------------*/
+#ifdef JPEG_ARENA_HOST
+#define ARENA_BASE              ((uint8_t *)s_host_arena)
+#else
+#define ARENA_BASE              ((uint8_t *)(FSMC_SRAM_BASE_ADDR + SRAM_JPEG_ARENA_OFFSET))
+
+#if JPEG_ARENA_SIZE > SRAM_JPEG_ARENA_SIZE
+#error "JPEG arena is larger than its region in the SRAM map"
+#endif
+#endif // JPEG_ARENA_HOST
+
+#define ALIGN_SIZE(SIZE)        (((SIZE) + JPEG_ARENA_ALIGN - 1) & ~(size_t)(JPEG_ARENA_ALIGN - 1))
+
+/* Private variables ---------------------------------------------------------*/
+#ifdef JPEG_ARENA_HOST
+static uint8_t s_host_arena[JPEG_ARENA_SIZE] __attribute__((aligned(JPEG_ARENA_ALIGN)));
+#endif // JPEG_ARENA_HOST
+
+static JpegArena_StatsTypeDef s_stats = { JPEG_ARENA_SIZE, 0, 0, 0, 0 };
+static uint8_t s_users;         //Codec objects alive
+
+/* Private function prototypes -----------------------------------------------*/
+static void* ArenaAlloc(size_t size);
+static void ArenaFree(void *object, size_t size);
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Drops every allocation and clears the statistics
+  * @note   Must not be called while a codec object is alive
+  * @retval None
+  */
+void JpegArena_Reset(void)
+{
+    s_stats.Used = 0;
+    s_stats.Peak = 0;
+    s_stats.Allocations = 0;
+    s_stats.Failures = 0;
+}
+
+/**
+  * @brief  Sets the most memory LibJPEG may take
+  * @param  limit: Ceiling in bytes, clipped to JPEG_ARENA_SIZE
+  * @retval None
+  */
+void JpegArena_SetLimit(uint32_t limit)
+{
+    s_stats.Limit = (limit < JPEG_ARENA_SIZE) ? limit : JPEG_ARENA_SIZE;
+}
+
+/**
+  * @brief  Gets arena usage
+  * @param  stats: Returns the statistics
+  * @retval None
+  */
+void JpegArena_GetStats(JpegArena_StatsTypeDef *stats)
+{
+    *stats = s_stats;
+}
+
+/* LibJPEG System-dependent Memory Interface ---------------------------------*/
+
+GLOBAL(void *)
+jpeg_get_small (j_common_ptr cinfo, size_t sizeofobject)
+{
+    return ArenaAlloc(sizeofobject);
+}
+
+GLOBAL(void)
+jpeg_free_small (j_common_ptr cinfo, void * object, size_t sizeofobject)
+{
+    ArenaFree(object, sizeofobject);
+}
+
+GLOBAL(void FAR *)
+jpeg_get_large (j_common_ptr cinfo, size_t sizeofobject)
+{
+    return (void FAR *)ArenaAlloc(sizeofobject);
+}
+
+GLOBAL(void)
+jpeg_free_large (j_common_ptr cinfo, void FAR * object, size_t sizeofobject)
+{
+    ArenaFree((void *)object, sizeofobject);
+}
+
+GLOBAL(long)
+jpeg_mem_available (j_common_ptr cinfo, long min_bytes_needed,
+                    long max_bytes_needed, long already_allocated)
+{
+    return s_stats.Limit - s_stats.Used;
+}
+
+GLOBAL(void)
+jpeg_open_backing_store (j_common_ptr cinfo, backing_store_ptr info,
+                         long total_bytes_needed)
+{
+    ERREXIT(cinfo, JERR_NO_BACKING_STORE);
+}
+
+GLOBAL(long)
+jpeg_mem_init (j_common_ptr cinfo)
+{
+    /* First codec object starts from an empty arena */
+    if (s_users++ == 0) {
+        JpegArena_Reset();
+    }
+    return s_stats.Limit;
+}
+
+GLOBAL(void)
+jpeg_mem_term (j_common_ptr cinfo)
+{
+    /* Keep Peak readable after the codec is gone */
+    if (s_users && --s_users == 0) {
+        s_stats.Used = 0;
+    }
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Takes a block from the top of the arena
+  * @param  size: Block size in bytes
+  * @retval Block address, NULL if the ceiling would be exceeded
+  */
+static void* ArenaAlloc(size_t size)
+{
+    size = ALIGN_SIZE(size);
+
+    if (size > s_stats.Limit - s_stats.Used) {
+        s_stats.Failures++;
+        return NULL;
+    }
+
+    void *object = ARENA_BASE + s_stats.Used;
+
+    s_stats.Used += size;
+    s_stats.Allocations++;
+    if (s_stats.Used > s_stats.Peak) {
+        s_stats.Peak = s_stats.Used;
+    }
+
+    return object;
+}
+
+/**
+  * @brief  Gives a block back, only the topmost one is reclaimed at once
+  * @param  object: Block address
+  * @param  size: Block size in bytes
+  * @retval None
+  */
+static void ArenaFree(void *object, size_t size)
+{
+    if ((uint8_t *)object + ALIGN_SIZE(size) == ARENA_BASE + s_stats.Used) {
+        s_stats.Used -= ALIGN_SIZE(size);
+    }
+}
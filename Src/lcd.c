@@ -16,11 +16,13 @@
 /* Includes ------------------------------------------------------------------*/
 #include "lcd.h"
 #include "fsmc.h"
+#include "sram.h"
 
 #include "colors.h"
 #include "ascii.h" 
 #include "big_number.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,43 +34,100 @@
 #include "ili9325.h"
 #endif
 
-#if LCD_USE_FRAMEBUFFER
 #include "frame_buffer.h"
-#endif // LCD_USE_BACKBUFFER
+#include "glyph_cache.h"
+#include "font_cache.h"
 
 #if LCD_USE_FATFS
 #include "fatfs.h"
 #endif // LCD_USE_FATFS
 
+#if LCD_USE_LIBJPEG
+#include "jpeglib.h"
+#include <setjmp.h>
+#endif // LCD_USE_LIBJPEG
+
 /* Private Marcos ------------------------------------------------------------*/
 
+/* Fills with at least this many pixels go through DMA */
+#define LCD_DMA_FILL_THRESHOLD      256
+#define LCD_GLYPH_RUN_MAX           32          //Glyphs laid out per opaque text run
+#define LCD_TEXT_LINE_MAX           (LCD_GLYPH_RUN_MAX * 20)    //Widest run, in 40px glyphs
+#define LCD_STREAM_BUFFER_SIZE      8192        //Bytes per image streaming buffer, whole sectors
+
 #if LCD_USE_FRAMEBUFFER
 
 /* You can use other memory block as framebuffer as long as
  * it's big enough to store pixels of the whole screen area (width * height * 2 bytes)
  */
-#define FRAMEBUFFER_BASE_ADDR       FSMC_SRAM_BASE_ADDR
+#define FRAMEBUFFER_BASE_ADDR       (FSMC_SRAM_BASE_ADDR + SRAM_FRAMEBUFFER_OFFSET)
+
+#if PIXEL_WIDTH * PIXEL_HEIGHT * 2 > SRAM_FRAMEBUFFER_SIZE
+#error "Full-screen framebuffer is larger than its region in the SRAM map"
+#endif
 #define WRITE_PIXEL(X, Y, COL)      FrameBuffer_WritePixel(&s_framebuffer, X, Y, COL)
 #define READ_PIXEL(X, Y)            FrameBuffer_ReadPixel(&s_framebuffer, X, Y)
+#define READ_LINE(X, Y, W, BUF)     FrameBuffer_ReadLine(&s_framebuffer, X, Y, W, BUF)
+#define LCD_WAIT_BUS()
+
+#else
+
+/* LCD bus may still be owned by a framebuffer flushing through DMA */
+#define LCD_WAIT_BUS()              FrameBuffer_WaitBus()
 
 #endif // LCD_USE_FRAMEBUFFER
 
+/* Private Types -------------------------------------------------------------*/
+#if LCD_USE_LIBJPEG
+typedef struct
+{
+    struct jpeg_error_mgr Pub;
+    jmp_buf JumpBuffer;         //Where to go back on a decoding error
+
+} LCD_JpegErrorTypeDef;
+#endif // LCD_USE_LIBJPEG
+
+#if LCD_USE_FATFS
+/* Screen area read back by LCD_SaveBmpToFile() */
+typedef struct
+{
+    uint16_t X;
+    uint16_t Y;
+    uint16_t Width;
+
+} LCD_ScreenAreaTypeDef;
+#endif // LCD_USE_FATFS
+
 /* Public variables ----------------------------------------------------------*/
 
 
 /* Private variables ---------------------------------------------------------*/
 static LCD_InfoTypeDef s_lcd_info;
 
+#if !LCD_USE_FRAMEBUFFER
+/* Last span window ends left of the screen edge, see LCD_FillSpan() */
+static _Bool s_is_span_window_narrow;
+#endif // !LCD_USE_FRAMEBUFFER
+
 #if LCD_USE_FRAMEBUFFER
 static FrameBufferTypeDef s_framebuffer;
 #endif // LCD_USE_FRAMEBUFFER
 
 #if LCD_USE_FATFS
 static uint8_t s_file_buffer[2048];
+/* Image streaming, SD card reads into one buffer while DMA drains the other to GRAM */
+static uint8_t s_stream_buffers[2][LCD_STREAM_BUFFER_SIZE] __attribute__((aligned(4)));
 #endif // LCD_USE_FATFS
 
+#if !LCD_USE_FONTLIB
+/* Opaque text lines, one is rasterized while DMA sends the other. Glyph cache
+ * lives in CCM which DMA can't read, so lines are assembled here */
+static uint16_t s_text_lines[2][LCD_TEXT_LINE_MAX] __attribute__((aligned(4)));
+#endif // !LCD_USE_FONTLIB
+
 #if LCD_USE_FONTLIB
 static FIL s_ascii_font_file, s_gb2312_font_file;
+static uint8_t s_ascii_font_size, s_gb2312_font_size;      //Size of the open file, 0 if closed
 #endif // LCD_USE_FONTLIB
 
 /* External variables --------------------------------------------------------*/
@@ -108,9 +167,14 @@ void LCD_Init(uint8_t orientation)
 
 #if LCD_USE_FRAMEBUFFER
     /* Initialize framebuffer */
-    FrameBuffer_Init(&s_framebuffer, FRAMEBUFFER_BASE_ADDR, FSMC_LCD_DATA_ADDR, 0, 0, s_lcd_info.Width, s_lcd_info.Height);
+    FrameBuffer_Init(&s_framebuffer, (__IO uint16_t *)FRAMEBUFFER_BASE_ADDR, (__IO uint16_t *)FSMC_LCD_DATA_ADDR, 0, 0, s_lcd_info.Width, s_lcd_info.Height);
 #endif // LCD_USE_FRAMEBUFFER
 
+    GlyphCache_Init();
+#if LCD_USE_FONTLIB
+    FontCache_Init();
+#endif // LCD_USE_FONTLIB
+
     /* Initialize backlight GPIO */
     LCD_BL_GPIO_CLK_ENABLE();
 
@@ -134,7 +198,10 @@ void LCD_Init(uint8_t orientation)
   */
 void LCD_SetFont(FontType font_type)
 {
+    /* SRAM font cache is keyed by font type and stays valid */
+    LCD_CloseFontFiles();
     s_lcd_info.FontType = font_type;
+    GlyphCache_Invalidate();
 }
 #endif // LCD_USE_FONTLIB 
 
@@ -145,6 +212,7 @@ void LCD_SetFont(FontType font_type)
   */
 void LCD_DisplayOn(void)
 {
+    LCD_WAIT_BUS();
     /* Driver on */
     DRIVER_ON();
     /* Backlight on */
@@ -158,12 +226,26 @@ void LCD_DisplayOn(void)
   */
 void LCD_DisplayOff(void)
 {
+    LCD_WAIT_BUS();
     /* Driver off */
     DRIVER_OFF();
     /* Backlight off */
     LCD_BL_GPIO_PORT->BSRR = (uint32_t)LCD_BL_GPIO_PIN << 16U;
 }
 
+/**
+  * @brief  Restores GRAM window to the whole screen
+  * @note   Modules streaming pixels through their own SET_WINDOW calls should
+  *         call this once when finished, instead of after every window.
+  * @param  None
+  * @retval None
+  */
+void LCD_ResetWindow(void)
+{
+    LCD_WAIT_BUS();
+    SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
+}
+
 #if LCD_USE_FRAMEBUFFER
 /**
   * @brief  Update pixels in framebuffer to whole screen
@@ -183,15 +265,11 @@ void LCD_FrameUpdate(void)
   */
 void LCD_Clear(uint16_t color)
 {
+    LCD_WAIT_BUS();
 #if LCD_USE_FRAMEBUFFER
     FrameBuffer_Clear(&s_framebuffer, color);
 #else
-    SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
-
-    PREPARE_WRITE();
-    for (size_t i = 0; i < s_lcd_info.Width * s_lcd_info.Height; i++) {
-        WRITE_GRAM(color);
-    }
+    FrameBuffer_FillGram(0, 0, s_lcd_info.Width, s_lcd_info.Height, color);
 #endif // LCD_USE_FRAMEBUFFER
 }
 
@@ -205,6 +283,7 @@ void LCD_Clear(uint16_t color)
   */
 void LCD_DrawHLine(uint16_t x, uint16_t y, uint16_t width, uint16_t color)
 {
+    LCD_WAIT_BUS();
 #if LCD_USE_FRAMEBUFFER
     for (uint16_t i = 0; i < width; i++) {
         WRITE_PIXEL(x + i, y, color);
@@ -232,6 +311,7 @@ void LCD_DrawHLine(uint16_t x, uint16_t y, uint16_t width, uint16_t color)
   */
 void LCD_DrawVLine(uint16_t x, uint16_t y, uint16_t height, uint16_t color)
 {
+    LCD_WAIT_BUS();
 #if LCD_USE_FRAMEBUFFER
     for (uint16_t i = 0; i < height; i++) {
         WRITE_PIXEL(x, y + i, color);
@@ -251,6 +331,10 @@ void LCD_DrawVLine(uint16_t x, uint16_t y, uint16_t height, uint16_t color)
 
 /**
   * @brief  Draw a straight line on screen
+  * @note   Pixels are grouped into horizontal runs (vertical for steep lines),
+  *         see LCD_FillSpan(). The line is clipped once: the major axis stops
+  *         at the screen edge and runs off screen on the minor axis are
+  *         skipped, so pixels stay where the unclipped line has them.
   * @param  x0: Start point X top-left position
   * @param  y0: Start point Y top-left position
   * @param  x1: End point X top-left position
@@ -262,6 +346,15 @@ void LCD_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t c
 {
     uint16_t temp;
     _Bool is_steep = (abs(y1 - y0) > abs(x1 - x0));
+    /* Last on screen position along the major and minor axis */
+    int16_t major_max = (is_steep ? s_lcd_info.Height : s_lcd_info.Width) - 1;
+    int16_t minor_max = (is_steep ? s_lcd_info.Width : s_lcd_info.Height) - 1;
+
+    /* Nothing to draw if the whole line is off screen */
+    if ((x0 >= s_lcd_info.Width && x1 >= s_lcd_info.Width) ||
+        (y0 >= s_lcd_info.Height && y1 >= s_lcd_info.Height)) {
+        return;
+    }
 
     if (is_steep) {
         temp = x0; x0 = y0; y0 = temp;
@@ -276,21 +369,31 @@ void LCD_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t c
     int16_t dy = abs(y1 - y0);
     int16_t err = dx / 2;
     int16_t y_step = (y0 < y1) ? 1 : -1;
+    int16_t run_start = x0;
+    int16_t x_end = (x1 > major_max) ? major_max : x1;
 
-    for (int16_t x = x0, y = y0; x <= x1; x++) {
-        if (is_steep) {
-            WRITE_PIXEL(y, x, color);
-        }
-        else {
-            WRITE_PIXEL(x, y, color);
+    for (int16_t x = x0, y = y0; x <= x_end; x++) {
+        err -= dy;
+        /* Run ends where y steps or at the last visible point */
+        if (err < 0 || x == x_end) {
+            if (y <= minor_max) {
+                if (is_steep) {
+                    LCD_FillSpan(y, run_start, 1, x - run_start + 1, color);
+                }
+                else {
+                    LCD_FillSpan(run_start, y, x - run_start + 1, 1, color);
+                }
+            }
+            run_start = x + 1;
         }
 
-        err -= dy;
         if (err < 0) {
             y += y_step;
             err += dx;
         }
     }
+
+    LCD_EndSpans();
 }
 
 /**
@@ -321,6 +424,17 @@ void LCD_DrawRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint1
   */
 void LCD_FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color)
 {
+    LCD_WAIT_BUS();
+    /* DMA setup costs more than a few dozen CPU writes */
+    if ((uint32_t)width * height >= LCD_DMA_FILL_THRESHOLD) {
+#if LCD_USE_FRAMEBUFFER
+        FrameBuffer_FillRect(&s_framebuffer, x, y, width, height, color);
+#else
+        FrameBuffer_FillGram(x, y, width, height, color);
+#endif // LCD_USE_FRAMEBUFFER
+        return;
+    }
+
 #if LCD_USE_FRAMEBUFFER
     for (size_t i = 0; i < height; i++) {
         for (size_t j = 0; j < width; j++) {
@@ -342,6 +456,10 @@ void LCD_FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint1
 
 /**
   * @brief  Draw a circle on screen
+  * @note   Steps of the midpoint algorithm along which y stays the same make
+  *         a run, drawn as horizontal runs at the top and bottom and vertical
+  *         runs at the sides, see LCD_FillSpan(). Runs are only clipped when
+  *         the circle crosses the screen edge.
   * @param  x0: Center X position
   * @param  y0: Center Y position
   * @param  radius: Circle radius
@@ -353,30 +471,52 @@ void LCD_DrawCircle(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color)
     int16_t x = 0;
     int16_t y = radius;
     int16_t di = 3 - radius / 2;
+    int16_t run_start = 0;
+    LCD_SpanFunc fill_span = LCD_GetSpanFunc(x0, y0, radius);
+
+    if (fill_span == NULL) {
+        return;
+    }
+
     while (x <= y)
     {
-        WRITE_PIXEL(x0 + x, y0 - y, color);
-        WRITE_PIXEL(x0 + y, y0 - x, color);       
-        WRITE_PIXEL(x0 + y, y0 + x, color);              
-        WRITE_PIXEL(x0 + x, y0 + y, color);
-        WRITE_PIXEL(x0 - x, y0 + y, color);      
-        WRITE_PIXEL(x0 - y, y0 + x, color);
-        WRITE_PIXEL(x0 - x, y0 - y, color);            
-        WRITE_PIXEL(x0 - y, y0 - x, color);   	         
-        x++;
-   
+        int16_t next_x = x + 1;
+        int16_t next_y = y;
+
         if (di < 0) {
-            di += 4 * x + 6;
+            di += 4 * next_x + 6;
         }
         else {
-            di += 10 + 4 * (x - y);
-            y--;
+            di += 10 + 4 * (next_x - y);
+            next_y--;
         }
+
+        if (next_y != y || next_x > next_y)
+        {
+            int16_t length = x - run_start + 1;
+
+            fill_span(x0 + run_start, y0 - y, length, 1, color);
+            fill_span(x0 - x, y0 - y, length, 1, color);
+            fill_span(x0 + run_start, y0 + y, length, 1, color);
+            fill_span(x0 - x, y0 + y, length, 1, color);
+            fill_span(x0 + y, y0 + run_start, 1, length, color);
+            fill_span(x0 + y, y0 - x, 1, length, color);
+            fill_span(x0 - y, y0 + run_start, 1, length, color);
+            fill_span(x0 - y, y0 - x, 1, length, color);
+            run_start = next_x;
+        }
+
+        x = next_x;
+        y = next_y;
     }
+
+    LCD_EndSpans();
 }
 
 /**
   * @brief  Fill a circular area on screen
+  * @note   Each row is filled once as a single span, long spans go by DMA.
+  *         Spans are only clipped when the circle crosses the screen edge.
   * @param  x0: Center X position
   * @param  y0: Center Y position
   * @param  radius: Circle radius
@@ -388,29 +528,42 @@ void LCD_FillCircle(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color)
     int16_t x = 0;
     int16_t y = radius;
     int16_t di = 3 - radius / 2;
+    LCD_SpanFunc fill_span = LCD_GetSpanFunc(x0, y0, radius);
+
+    if (fill_span == NULL) {
+        return;
+    }
+
     while (x <= y)
     {
-        if (y > 0)
-        {
-            LCD_DrawHLine(x0 - y, y0 + x, 2 * y, color);
-            LCD_DrawHLine(x0 - y, y0 - x, 2 * y, color);
-        }
-
-        if (x > 0)
-        {
-            LCD_DrawHLine(x0 - x, y0 - y, 2 * x, color);
-            LCD_DrawHLine(x0 - x, y0 + y, 2 * x, color);
-        }
-        x++;
+        int16_t next_x = x + 1;
+        int16_t next_y = y;
 
         if (di < 0) {
-            di += 4 * x + 6;
+            di += 4 * next_x + 6;
         }
         else {
-            di += 10 + 4 * (x - y);
-            y--;
+            di += 10 + 4 * (next_x - y);
+            next_y--;
         }
+
+        /* Rows at +-x are new every step */
+        fill_span(x0 - y, y0 + x, 2 * y + 1, 1, color);
+        if (x > 0) {
+            fill_span(x0 - y, y0 - x, 2 * y + 1, 1, color);
+        }
+
+        /* Rows at +-y once per run, with the widest x before y steps */
+        if ((next_y != y || next_x > next_y) && x != y) {
+            fill_span(x0 - x, y0 - y, 2 * x + 1, 1, color);
+            fill_span(x0 - x, y0 + y, 2 * x + 1, 1, color);
+        }
+
+        x = next_x;
+        y = next_y;
     }
+
+    LCD_EndSpans();
 }
 
 /**
@@ -424,15 +577,18 @@ void LCD_FillCircle(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color)
   */
 void LCD_DrawBitmapStream(const uint16_t *stream_buffer, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
 {
+    LCD_WAIT_BUS();
 #if LCD_USE_FRAMEBUFFER
     for (size_t i = 0; i < height; i++) {
-        memcpy(s_framebuffer.PixelData + s_framebuffer.Width * y + x, stream_buffer, width * 2);
+        FrameBuffer_WriteLine(&s_framebuffer, x, y + i, width, stream_buffer + width * i);
     }
+    FrameBuffer_MarkDirty(&s_framebuffer, x, y, width, height);
 #else
     SET_WINDOW(x, y, width, height);
     PREPARE_WRITE();
 
-    HAL_DMA_Start(&hdma_m2m, stream_buffer, FSMC_LCD_DATA_ADDR, width * height / 2);
+    FSMC_LCD_COUNT(DmaWrites, width * height / 2 * 2);
+    HAL_DMA_Start(&hdma_m2m, (uint32_t)stream_buffer, FSMC_LCD_DATA_ADDR, width * height / 2);
     HAL_DMA_PollForTransfer(&hdma_m2m, HAL_DMA_FULL_TRANSFER, 1000);
 
     /* Get your ass back here! */
@@ -440,9 +596,58 @@ void LCD_DrawBitmapStream(const uint16_t *stream_buffer, uint16_t x, uint16_t y,
 #endif  // LCD_USE_FRAMEBUFFER
 }
 
+/**
+  * @brief  Draw a run-length encoded sprite on screen
+  * @note   Only opaque runs are written, one GRAM window each, pixels under
+  *         transparent ones keep their color.
+  * @param  sprite: Sprite to draw
+  * @param  x: Top-left corner X position
+  * @param  y: Top-left corner Y position
+  * @retval None
+  */
+void LCD_DrawSprite(const SpriteTypeDef *sprite, uint16_t x, uint16_t y)
+{
+    LCD_WAIT_BUS();
+    const uint16_t *data = sprite->Data;
+
+    for (uint16_t row = 0; row < sprite->Height; row++)
+    {
+        uint16_t run_count = *(data++);
+        uint16_t column = 0;
+
+        for (uint16_t i = 0; i < run_count; i++)
+        {
+            column += *(data++);
+            uint16_t length = *(data++);
+
+#if LCD_USE_FRAMEBUFFER
+            for (uint16_t j = 0; j < length; j++) {
+                WRITE_PIXEL(x + column + j, y + row, data[j]);
+            }
+#else
+            SET_WINDOW(x + column, y + row, length, 1);
+            PREPARE_WRITE();
+            for (uint16_t j = 0; j < length; j++) {
+                WRITE_GRAM(data[j]);
+            }
+#endif // LCD_USE_FRAMEBUFFER
+            data += length;
+            column += length;
+        }
+    }
+
+#if !LCD_USE_FRAMEBUFFER
+    /* Get your ass back here! */
+    SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
+#endif
+}
+
 #if LCD_USE_FATFS
 /**
   * @brief  Draw a RGB565 bitmap stream on screen from binary file
+  * @note   The file is read in multi-sector blocks into two buffers in turn.
+  *         While SDIO DMA fills one, FSMC DMA drains the other through a
+  *         single GRAM window, so card latency and LCD writes overlap.
   * @param  x: Top-left corner X position
   * @param  y: Top-left corner Y position
   * @param  width:  Bitmap width
@@ -452,36 +657,53 @@ void LCD_DrawBitmapStream(const uint16_t *stream_buffer, uint16_t x, uint16_t y,
   */
 void LCD_DrawBitmapStreamFromFile(const uint8_t* file_name, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
 {
-    uint16_t *line_buffer = (uint16_t *)s_file_buffer;
+    LCD_WAIT_BUS();
+    uint32_t bytes_left = (uint32_t)width * height * 2;
+    uint8_t index = 0;
     FIL stream_file;
-    size_t read_count;
+    UINT read_count;
+
+    if (f_open(&stream_file, (const TCHAR *)file_name, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        return;
+    }
 
 #if LCD_USE_FRAMEBUFFER
-    uint16_t *fb_write_addr = s_framebuffer.PixelData + s_lcd_info.Width * y + x;
+    uint16_t row = 0, column = 0;
 #else
     SET_WINDOW(x, y, width, height);
     PREPARE_WRITE();
 #endif
 
-    if (f_open(&stream_file, file_name, FA_OPEN_EXISTING | FA_READ) == FR_OK)
+    while (bytes_left > 0)
     {
-        for (size_t i = 0; i < height; i++)
+        uint16_t *pixels = (uint16_t *)s_stream_buffers[index];
+        UINT block_size = (bytes_left < LCD_STREAM_BUFFER_SIZE) ? bytes_left : LCD_STREAM_BUFFER_SIZE;
+
+        /* DMA may still be draining the other buffer meanwhile */
+        if (f_read(&stream_file, pixels, block_size, &read_count) != FR_OK || read_count < 2) {
+            break;
+        }
+        bytes_left -= read_count;
+
+#if LCD_USE_FRAMEBUFFER
+        for (UINT i = 0; i < read_count / 2; i++)
         {
-            if (f_read(&stream_file, line_buffer, width * 2, &read_count) != FR_OK) {
-                break;
+            WRITE_PIXEL(x + column, y + row, pixels[i]);
+            if (++column == width) {
+                column = 0;
+                ++row;
             }
-#if LCD_USE_FRAMEBUFFER
-            memcpy(fb_write_addr, line_buffer, width * 2);
-            fb_write_addr += s_lcd_info.Width;
+        }
 #else
-            for (size_t j = 0; j < width; j++) {
-                WRITE_GRAM(line_buffer[j]);
-            }
+        /* Waits for the other buffer, then returns while this one is sent */
+        FrameBuffer_StreamGram(pixels, read_count / 2);
 #endif // LCD_USE_FRAMEBUFFER
-        }
+
+        index ^= 1;
     }
 
 #if !LCD_USE_FRAMEBUFFER
+    FrameBuffer_WaitBus();
     /* Get your ass back here! */
     SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
 #endif
@@ -490,6 +712,10 @@ void LCD_DrawBitmapStreamFromFile(const uint8_t* file_name, uint16_t x, uint16_t
 
 /**
   * @brief  Draw a BMP image on screen from binary file
+  * @note   16-bit (RGB565) and 24-bit images, bottom-up or top-down. As many
+  *         rows as fit are read into one of two buffers at a time, 24-bit
+  *         rows are packed to RGB565 in place, and the block is sent by DMA
+  *         through one window while the next block is read.
   * @param  x: Top-left corner X position
   * @param  y: Top-left corner Y position
   * @param  file_name: Bitmap filename
@@ -497,89 +723,309 @@ void LCD_DrawBitmapStreamFromFile(const uint8_t* file_name, uint16_t x, uint16_t
   */
 void LCD_DrawBmpFromFile(const uint8_t* file_name, uint16_t x, uint16_t y)
 {
-    uint8_t *line_buffer = (uint8_t *)s_file_buffer;
+    LCD_WAIT_BUS();
+    BmpFileHeader file_header;
+    BmpInfoHeader info_header;
     FIL bmp_file;
-    size_t read_count;
+    UINT read_count;
 
-    if (f_open(&bmp_file, file_name, FA_OPEN_EXISTING | FA_READ) == FR_OK)
-    {
-        BmpFileHeader file_header;
-        BmpInfoHeader info_header;
+    if (f_open(&bmp_file, (const TCHAR *)file_name, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        return;
+    }
 
-        f_read(&bmp_file, &file_header, sizeof(BmpFileHeader), &read_count);
+    if (f_read(&bmp_file, &file_header, sizeof(BmpFileHeader), &read_count) != FR_OK
+        || f_read(&bmp_file, &info_header, sizeof(BmpInfoHeader), &read_count) != FR_OK
+        || file_header.bfType != 0x4D42
+        || (info_header.biBitCount != 16 && info_header.biBitCount != 24)) {
+        f_close(&bmp_file);
+        return;
+    }
 
-        /* Not BMP file */
-        if (file_header.bfType != 0x4D42) {
-            return;
-        }
+    int32_t height = (int32_t)info_header.biHeight;
+    _Bool is_bottom_up = (height > 0);
+    uint16_t width = info_header.biWidth;
+    uint32_t stride = ((uint32_t)width * info_header.biBitCount + 31) / 32 * 4;
+    uint16_t block_rows = LCD_STREAM_BUFFER_SIZE / stride;
+    uint8_t index = 0;
 
-        f_read(&bmp_file, &info_header, sizeof(BmpInfoHeader), &read_count);
+    if (!is_bottom_up) {
+        height = -height;
+    }
+    if (block_rows == 0 || f_lseek(&bmp_file, file_header.bfOffBits) != FR_OK) {
+        f_close(&bmp_file);
+        return;
+    }
 
-        /* Start to write pixel data */
-#if LCD_USE_FRAMEBUFFER
-        uint16_t *fb_write_addr = s_framebuffer.PixelData + s_lcd_info.Width * y + x;
-        uint16_t *line_buffer_rgb565 = (uint16_t *)line_buffer;
-#else
-        SET_WINDOW(x, y, info_header.biWidth, info_header.biHeight);
-        PREPARE_WRITE();
-#endif
-        size_t stride = (info_header.biWidth * info_header.biBitCount + 31) / 32 * 4;
+    for (int32_t row = 0; row < height; row += block_rows)
+    {
+        uint8_t *buffer = s_stream_buffers[index];
+        uint16_t rows = (height - row < block_rows) ? height - row : block_rows;
 
-        for (size_t i = 0; i < info_header.biHeight; i++) {
-            /* Read from end of bmp file */
-            f_lseek(&bmp_file, file_header.bfOffBits + (info_header.biHeight - i - 1) * stride - 2);
-            /* Get a line of RGB888 data */
-            f_read(&bmp_file, line_buffer, stride + 2, &read_count);
+        /* DMA may still be draining the other buffer meanwhile */
+        if (f_read(&bmp_file, buffer, stride * rows, &read_count) != FR_OK || read_count < stride * rows) {
+            break;
+        }
 
-            /* RGB565 */
-            if (info_header.biBitCount == 16)
+        /* Pack to RGB565 at the start of each row, it never overtakes its source */
+        if (info_header.biBitCount == 24)
+        {
+            for (uint16_t i = 0; i < rows; i++)
             {
-                uint16_t color;
-                uint16_t *color_ptr = (uint16_t *)(line_buffer + 2);
+                const uint8_t *src = buffer + stride * i;
+                uint16_t *dst = (uint16_t *)(buffer + stride * i);
 
-                for (size_t j = 0; j < info_header.biWidth; j++)
-                {
-                    color = *(color_ptr++);
-#if LCD_USE_FRAMEBUFFER
-                    line_buffer_rgb565[j] = color;
-#else
-                    WRITE_GRAM(color);
-#endif // LCD_USE_FRAMEBUFFER
+                for (uint16_t j = 0; j < width; j++, src += 3) {
+                    dst[j] = pack_rgb565(src[2], src[1], src[0]);
                 }
             }
-            /* RGB888 */
-            else if (info_header.biBitCount == 24)
-            {
-                uint8_t r, g, b;
-                uint8_t *color_ptr = line_buffer + 2;
+        }
 
-                for (size_t j = 0; j < info_header.biWidth; j++)
-                {
-                    b = *(color_ptr++);
-                    g = *(color_ptr++);
-                    r = *(color_ptr++);
+        /* Screen rows covered by this block, and where its top row is in buffer */
+        uint16_t top = is_bottom_up ? height - row - rows : row;
+        const uint8_t *top_row = is_bottom_up ? buffer + stride * (rows - 1) : buffer;
 
 #if LCD_USE_FRAMEBUFFER
-                    line_buffer_rgb565[j] = pack_rgb565(r, g, b);
+        for (uint16_t i = 0; i < rows; i++)
+        {
+            const uint16_t *pixels = (const uint16_t *)(is_bottom_up ? top_row - stride * i : top_row + stride * i);
+            for (uint16_t j = 0; j < width; j++) {
+                WRITE_PIXEL(x + j, y + top + i, pixels[j]);
+            }
+        }
 #else
-                    WRITE_GRAM(pack_rgb565(r, g, b));
+        /* Waits for the other buffer, then returns while this one is sent */
+        FrameBuffer_WriteGramStride(x, y + top, width, rows, (const uint16_t *)top_row,
+                                    is_bottom_up ? -(int32_t)stride : (int32_t)stride);
 #endif // LCD_USE_FRAMEBUFFER
-                }
-            }
-#if LCD_USE_FRAMEBUFFER
-            memcpy(fb_write_addr, line_buffer_rgb565, info_header.biWidth * 2);
-            fb_write_addr += s_lcd_info.Width;
+
+        index ^= 1;
+    }
+
+    /* Window is reset when the last block is sent */
+    f_close(&bmp_file);
+}
+
+/**
+  * @brief  Save a screen area to a 16-bit BMP file
+  * @note   Pixels are read back one row at a time (from the framebuffer if
+  *         enabled, otherwise by a burst read of GRAM) and streamed to the
+  *         file bottom-up. The file is preallocated as one contiguous block
+  *         when the volume allows it, so the writes don't walk the FAT.
+  * @param  file_name: Bitmap filename, overwritten if exists
+  * @param  x: Top-left corner X position
+  * @param  y: Top-left corner Y position
+  * @param  width:  Area width, at most 1024 pixels
+  * @param  height: Area height
+  * @retval HAL_OK on success, HAL_ERROR if the file can't be written
+  */
+HAL_StatusTypeDef LCD_SaveBmpToFile(const uint8_t* file_name, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    const LCD_ScreenAreaTypeDef area = { .X = x, .Y = y, .Width = width };
+
+    if (x + width > s_lcd_info.Width || y + height > s_lcd_info.Height) {
+        return HAL_ERROR;
+    }
+
+    return LCD_SaveBmpLinesToFile(file_name, width, height, LCD_ReadScreenLine, &area);
+}
+
+/**
+  * @brief  Save an image read back row by row to a 16-bit BMP file
+  * @note   Lets modules that keep their own copy of an area, such as a chart
+  *         framebuffer, save it without GRAM reads. See LCD_SaveBmpToFile().
+  * @param  file_name: Bitmap filename, overwritten if exists
+  * @param  width:  Image width, at most 1024 pixels
+  * @param  height: Image height
+  * @param  read_line: Called for each row, bottom row first
+  * @param  source: Passed to read_line
+  * @retval HAL_OK on success, HAL_ERROR if the file can't be written
+  */
+HAL_StatusTypeDef LCD_SaveBmpLinesToFile(const uint8_t* file_name, uint16_t width, uint16_t height,
+                                         LCD_ReadLineFunc read_line, const void *source)
+{
+    uint16_t *line_buffer = (uint16_t *)s_file_buffer;
+    size_t stride = (width * 2 + 3) / 4 * 4;
+    UINT write_count;
+    HAL_StatusTypeDef status = HAL_OK;
+    FIL bmp_file;
+
+    if (width == 0 || height == 0 || stride > sizeof(s_file_buffer)) {
+        return HAL_ERROR;
+    }
+
+    if (f_open(&bmp_file, (const TCHAR *)file_name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        return HAL_ERROR;
+    }
+
+    BmpFileHeader file_header = {
+        .bfType = 0x4D42,
+        .bfOffBits = sizeof(BmpFileHeader) + sizeof(BmpInfoHeader) + 3 * sizeof(uint32_t),
+    };
+    file_header.bfSize = file_header.bfOffBits + stride * height;
+
+    BmpInfoHeader info_header = {
+        .biSize = sizeof(BmpInfoHeader),
+        .biWidth = width,
+        .biHeight = height,
+        .biPlanes = 1,
+        .biBitCount = 16,
+        .biCompression = 3,             //BI_BITFIELDS
+        .biSizeImage = stride * height,
+        .biXPelsPerMeter = 2835,        //72 DPI
+        .biYPelsPerMeter = 2835,
+    };
+    const uint32_t color_masks[3] = { 0xF800, 0x07E0, 0x001F };
+
+#if _USE_EXPAND
+    /* Not fatal, the file just won't be contiguous */
+    f_expand(&bmp_file, file_header.bfSize, 1);
 #endif
+
+    if (f_write(&bmp_file, &file_header, sizeof(BmpFileHeader), &write_count) != FR_OK ||
+        f_write(&bmp_file, &info_header, sizeof(BmpInfoHeader), &write_count) != FR_OK ||
+        f_write(&bmp_file, color_masks, sizeof(color_masks), &write_count) != FR_OK) {
+        status = HAL_ERROR;
+    }
+
+    LCD_WAIT_BUS();
+    /* Zero row padding once, pixel reads never touch it */
+    memset(line_buffer, 0, stride);
+
+    for (size_t i = 0; i < height && status == HAL_OK; i++)
+    {
+        read_line(source, height - i - 1, line_buffer);
+        if (f_write(&bmp_file, line_buffer, stride, &write_count) != FR_OK || write_count != stride) {
+            status = HAL_ERROR;
         }
+    }
+
 #if !LCD_USE_FRAMEBUFFER
-        /* Get your ass back here! */
-        SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
+    /* Get your ass back here! */
+    SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
 #endif
+    if (f_close(&bmp_file) != FR_OK) {
+        status = HAL_ERROR;
     }
-    f_close(&bmp_file);
+    return status;
 }
 #endif
 
+#if LCD_USE_LIBJPEG
+/**
+  * @brief  Draw a JPEG image on screen from file
+  * @note   The image is decoded one scanline at a time and streamed into
+  *         GRAM. Images bigger than the box are shrunk by DCT scaling (1/2,
+  *         1/4 or 1/8), what still doesn't fit is cropped.
+  * @param  file_name: JPEG filename
+  * @param  x: Top-left corner X position
+  * @param  y: Top-left corner Y position
+  * @param  width:  Box width
+  * @param  height: Box height
+  * @retval None
+  */
+void LCD_DrawJpegFromFile(const uint8_t* file_name, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    LCD_WAIT_BUS();
+    static struct jpeg_decompress_struct cinfo;
+    static LCD_JpegErrorTypeDef jerr;
+    static FIL jpeg_file;
+    uint16_t *line_buffer = (uint16_t *)s_file_buffer;
+    uint16_t draw_width, draw_height;
+    JSAMPARRAY scanline;
+
+    if (f_open(&jpeg_file, (const TCHAR *)file_name, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        return;
+    }
+
+    cinfo.err = jpeg_std_error(&jerr.Pub);
+    jerr.Pub.error_exit = LCD_JpegErrorExit;
+    jerr.Pub.output_message = LCD_JpegOutputMessage;
+
+    if (setjmp(jerr.JumpBuffer))
+    {
+        /* Corrupt file or out of memory, keep whatever was drawn */
+        jpeg_destroy_decompress(&cinfo);
+        f_close(&jpeg_file);
+#if !LCD_USE_FRAMEBUFFER
+        SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
+#endif
+        return;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, &jpeg_file);
+    jpeg_read_header(&cinfo, TRUE);
+
+    /* Let IDCT shrink the image until it fits the box */
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1;
+    while (cinfo.scale_denom < 8
+           && ((cinfo.image_width + cinfo.scale_denom - 1) / cinfo.scale_denom > width
+               || (cinfo.image_height + cinfo.scale_denom - 1) / cinfo.scale_denom > height)) {
+        cinfo.scale_denom <<= 1;
+    }
+
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.do_block_smoothing = FALSE;
+
+    jpeg_start_decompress(&cinfo);
+
+    draw_width = (cinfo.output_width < width) ? cinfo.output_width : width;
+    draw_height = (cinfo.output_height < height) ? cinfo.output_height : height;
+
+    /* Line buffer holds a RGB565 scanline */
+    if (draw_width > sizeof(s_file_buffer) / 2) {
+        draw_width = sizeof(s_file_buffer) / 2;
+    }
+
+    /* One RGB888 scanline, freed with the decoder */
+    scanline = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, cinfo.output_width * 3, 1);
+
+#if !LCD_USE_FRAMEBUFFER
+    SET_WINDOW(x, y, draw_width, draw_height);
+    PREPARE_WRITE();
+#endif
+
+    while (cinfo.output_scanline < draw_height)
+    {
+        jpeg_read_scanlines(&cinfo, scanline, 1);
+
+        const JSAMPLE *color_ptr = scanline[0];
+        for (size_t j = 0; j < draw_width; j++, color_ptr += 3) {
+            line_buffer[j] = pack_rgb565(color_ptr[0], color_ptr[1], color_ptr[2]);
+        }
+
+#if LCD_USE_FRAMEBUFFER
+        FrameBuffer_WriteLine(&s_framebuffer, x, y + cinfo.output_scanline - 1, draw_width, line_buffer);
+#else
+        for (size_t j = 0; j < draw_width; j++) {
+            WRITE_GRAM(line_buffer[j]);
+        }
+#endif // LCD_USE_FRAMEBUFFER
+    }
+
+#if LCD_USE_FRAMEBUFFER
+    FrameBuffer_MarkDirty(&s_framebuffer, x, y, draw_width, draw_height);
+#else
+    /* Get your ass back here! */
+    SET_WINDOW(0, 0, s_lcd_info.Width, s_lcd_info.Height);
+#endif
+
+    /* Cropped images have unread scanlines, finishing would complain */
+    if (cinfo.output_scanline < cinfo.output_height) {
+        jpeg_abort_decompress(&cinfo);
+    }
+    else {
+        jpeg_finish_decompress(&cinfo);
+    }
+
+    jpeg_destroy_decompress(&cinfo);
+    f_close(&jpeg_file);
+}
+#endif // LCD_USE_LIBJPEG
+
 /**
   * @brief  Draw a signed decimal number on screen
   * @param  x: Top-left corner X position
@@ -622,6 +1068,7 @@ void LCD_DrawNumber(int32_t num, uint8_t font_size, uint16_t x, uint16_t y, uint
   */
 void LCD_DrawBigNumber(uint8_t num, uint16_t x, uint16_t y, uint16_t color)
 {
+    LCD_WAIT_BUS();
     if (num == '.') {
         num = 10;
     }
@@ -658,93 +1105,32 @@ void LCD_DrawBigNumber(uint8_t num, uint16_t x, uint16_t y, uint16_t color)
 void LCD_DrawString(const uint8_t *str, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color)
 {
 #if LCD_USE_FONTLIB
-
-    _Bool is_ascii_font_ready;
-    _Bool is_gb2312_font_ready;
-
-    if (s_lcd_info.FontType == FONT_TYPE_SANS)
-    {
-        switch (font_size)
-        {
-            case 16:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/sans_ascii_8x16.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/sans_gb2312_16x16.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            case 24:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/sans_ascii_12x24.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/sans_gb2312_24x24.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            case 32:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/sans_ascii_16x32.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/sans_gb2312_32x32.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            case 40:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/sans_ascii_20x40.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/sans_gb2312_40x40.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            default:
-                return;
-        }
-    }
-    else if (s_lcd_info.FontType == FONT_TYPE_SERIF)
-    {
-        switch (font_size)
-        {
-            case 16:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/serif_ascii_8x16.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/serif_gb2312_16x16.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            case 24:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/serif_ascii_12x24.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/serif_gb2312_24x24.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            case 32:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/serif_ascii_16x32.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/serif_gb2312_32x32.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            case 40:
-                is_ascii_font_ready = (f_open(&s_ascii_font_file, "0:/fontlib/serif_ascii_20x40.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                is_gb2312_font_ready = (f_open(&s_gb2312_font_file, "0:/fontlib/serif_gb2312_40x40.bin", FA_OPEN_EXISTING | FA_READ) == FR_OK);
-                break;
-
-            default:
-                return;
-        }
-    }
-
     while (*str && x < s_lcd_info.Width)
     {
         if (*str < 0x80)
         {
-            if (is_ascii_font_ready) {
-                LCD_DrawCharASCII(*str, font_size, x, y, color);
-            }
+            LCD_DrawCharASCII(*str, font_size, x, y, color);
             str++;
             x += font_size / 2;
         }
         else
         {
-            if (is_gb2312_font_ready) {
-                LCD_DrawCharGB2312(str, font_size, x, y, color);
+            if (!str[1]) {
+                break;
             }
+            LCD_DrawCharGB2312((uint8_t *)str, font_size, x, y, color);
             str += 2;
             x += font_size;
         }
     }
 
-    f_close(&s_ascii_font_file);
-    f_close(&s_gb2312_font_file);
+    /* Font files are opened on cache misses only */
+    LCD_CloseFontFiles();
 #else
     while (*str)
     {
         if (*str > 0x7F) {
+            str++;
             continue;
         }
         LCD_DrawCharASCII(*str, font_size, x, y, color);
@@ -754,6 +1140,114 @@ void LCD_DrawString(const uint8_t *str, uint8_t font_size, uint16_t x, uint16_t
 #endif // LCD_USE_FONTLIB
 }
 
+/**
+  * @brief  Draw a string with its background on screen
+  * @note   The string is laid out in runs of glyphs and rasterized line by
+  *         line into a line buffer, from the glyph cache where possible. Each
+  *         line goes out through one GRAM window and a DMA burst, while the
+  *         next line is rasterized into a second buffer. This is much cheaper
+  *         than clearing the area and plotting text pixels one by one.
+  *         LCD bus may still be busy on return, see FrameBuffer_WaitBus().
+  * @param  str: Poniter to string buffer
+  * @param  font_size: Size of characters
+  * @param  x: Top-left corner X position
+  * @param  y: Top-left corner Y position
+  * @param  width: Field width, the part of it after the string is cleared
+  *                with bg_color. 0 to draw the string only
+  * @param  color: Pixel color (RGB565 format)
+  * @param  bg_color: Background color (RGB565 format)
+  * @retval None
+  */
+void LCD_DrawStringOpaque(const uint8_t *str, uint8_t font_size, uint16_t x, uint16_t y, uint16_t width, uint16_t color, uint16_t bg_color)
+{
+#if LCD_USE_FONTLIB
+    /* GB2312 glyphs are not cached */
+    if (width) {
+        LCD_FillRect(x, y, width, font_size, bg_color);
+    }
+    LCD_DrawString(str, font_size, x, y, color);
+#else
+    uint8_t char_width = font_size / 2;
+    uint16_t x_end = x + width;
+    const uint16_t *glyphs[LCD_GLYPH_RUN_MAX];
+    const uint8_t *font_data[LCD_GLYPH_RUN_MAX];
+    uint8_t line = 0;
+
+    if (x_end > s_lcd_info.Width) {
+        x_end = s_lcd_info.Width;
+    }
+
+    /* Line buffers may still be read by DMA from last call */
+    LCD_WAIT_BUS();
+
+    while (*str)
+    {
+        uint8_t count = 0;
+
+        /* Lay out a run of glyphs, cached ones stay pinned until the next run */
+        GlyphCache_BeginRun();
+        while (*str && count < LCD_GLYPH_RUN_MAX && x + (count + 1) * char_width <= s_lcd_info.Width)
+        {
+            if (*str > 0x7F) {
+                str++;
+                continue;
+            }
+            font_data[count] = LCD_GetCharASCIIData(*str, font_size);
+            if (font_data[count] == NULL) {
+                break;
+            }
+            /* NULL if cache is full, the glyph is expanded from font data then */
+            glyphs[count] = LCD_GetGlyph(*str, font_size, color, bg_color);
+            count++;
+            str++;
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        uint16_t run_width = count * char_width;
+
+        for (uint8_t i = 0; i < font_size; i++, line++)
+        {
+            uint16_t *pixels = s_text_lines[line & 1];
+
+            for (uint8_t j = 0; j < count; j++)
+            {
+                uint16_t *dst = pixels + j * char_width;
+
+                if (glyphs[j] != NULL) {
+                    memcpy(dst, glyphs[j] + i * char_width, char_width * 2);
+                    continue;
+                }
+
+                /* Font data is column-major with the LSB on top */
+                const uint8_t *column = font_data[j] + (i >> 3);
+                for (uint8_t k = 0; k < char_width; k++) {
+                    dst[k] = (column[k * (font_size >> 3)] >> (i & 7)) & 1 ? color : bg_color;
+                }
+            }
+
+#if LCD_USE_FRAMEBUFFER
+            for (uint16_t k = 0; k < run_width; k++) {
+                WRITE_PIXEL(x + k, y + i, pixels[k]);
+            }
+#else
+            /* Waits for the line before, which used the other buffer */
+            FrameBuffer_WriteGram(x, y + i, run_width, 1, pixels);
+#endif // LCD_USE_FRAMEBUFFER
+        }
+
+        x += run_width;
+    }
+
+    /* Clear the rest of the field */
+    if (x < x_end) {
+        LCD_FillRect(x, y, x_end - x, font_size, bg_color);
+    }
+#endif // LCD_USE_FONTLIB
+}
+
 /**
   * @brief  Draw a ASCII character on screen
   * @param  x: Top-left corner X position
@@ -765,21 +1259,19 @@ void LCD_DrawString(const uint8_t *str, uint8_t font_size, uint16_t x, uint16_t
   */
 void LCD_DrawCharASCII(uint8_t ch, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color)
 {
+    LCD_WAIT_BUS();
     uint8_t buffer_size = font_size * font_size >> 4;
     uint16_t y0 = y;
-    uint8_t* font_buffer;
+    const uint8_t* font_buffer;
 
     ch -= ' ';
 
 #if LCD_USE_FONTLIB
+    font_buffer = (const uint8_t *)s_file_buffer;
 
-    size_t read_count;
-    font_buffer = (uint8_t *)s_file_buffer;
-
-    /* Calculate offset in font lib file */
-    f_lseek(&s_ascii_font_file, ch * buffer_size);
-    f_read(&s_ascii_font_file, font_buffer, buffer_size, &read_count);
-
+    if (LCD_LoadFontGlyph(0, ch, font_size, (uint8_t *)s_file_buffer) != HAL_OK) {
+        return;
+    }
 #else
     switch (font_size)
     {
@@ -810,6 +1302,30 @@ void LCD_DrawCharASCII(uint8_t ch, uint8_t font_size, uint16_t x, uint16_t y, ui
     }
 }
 
+/**
+  * @brief  Gets built-in bitmap font data of an ASCII character
+  * @note   Data is column-major with the LSB on top, font_size / 8 bytes per
+  *         column and font_size / 2 columns.
+  * @param  ch: Character, non-printable ones give a space
+  * @param  font_size: Size of characters (16, 24, 32 or 40)
+  * @retval Font data, NULL if there is no font of this size
+  */
+const uint8_t* LCD_GetCharASCIIData(uint8_t ch, uint8_t font_size)
+{
+    if (ch < ' ' || ch > '~') {
+        ch = ' ';
+    }
+
+    switch (font_size)
+    {
+        case 16: return ASCII_8x16[ch - ' '];
+        case 24: return ASCII_12x24[ch - ' '];
+        case 32: return ASCII_16x32[ch - ' '];
+        case 40: return ASCII_20x40[ch - ' '];
+        default: return NULL;
+    }
+}
+
 #if LCD_USE_FONTLIB 
 /**
   * @brief  Draw a GB2312 character on screen
@@ -822,15 +1338,19 @@ void LCD_DrawCharASCII(uint8_t ch, uint8_t font_size, uint16_t x, uint16_t y, ui
   */
 void LCD_DrawCharGB2312(uint8_t* ch_ptr, uint8_t font_size, uint16_t x, uint16_t y, uint16_t color)
 {
+    LCD_WAIT_BUS();
     uint8_t buffer_size = font_size * font_size >> 3;
     uint16_t y0 = y;
 
     uint8_t *font_buffer = (uint8_t *)s_file_buffer;
-    size_t read_count;
 
-    /* Calculate offset in font lib file */
-    f_lseek(&s_gb2312_font_file, ((ch_ptr[0] - 0xA1) * 94 + (ch_ptr[1] - 0xA1)) * buffer_size);
-    f_read(&s_gb2312_font_file, font_buffer, buffer_size, &read_count);
+    if (ch_ptr[0] < 0xA1 || ch_ptr[1] < 0xA1) {
+        return;
+    }
+
+    if (LCD_LoadFontGlyph(1, (ch_ptr[0] - 0xA1) * 94 + (ch_ptr[1] - 0xA1), font_size, font_buffer) != HAL_OK) {
+        return;
+    }
 
     for (uint8_t i = 0; i < buffer_size; i++)
     {
@@ -852,4 +1372,289 @@ void LCD_DrawCharGB2312(uint8_t* ch_ptr, uint8_t font_size, uint16_t x, uint16_t
 }
 #endif
 
+/**
+  * @brief  Fills a span of pixels, used for runs of lines and circles
+  * @note   The span must be on screen. In direct mode single pixels are sent
+  *         by cursor, longer spans through a GRAM window. Windows end at the
+  *         right and bottom screen edges, so cursor writes that follow stay
+  *         valid, except after a vertical span which needs the column to wrap.
+  *         LCD_EndSpans() puts the window back after the last span.
+  *         Large spans are filled by DMA.
+  * @param  x: Top-left corner X position
+  * @param  y: Top-left corner Y position
+  * @param  width:  Span width
+  * @param  height: Span height
+  * @param  color: Pixel color (RGB565 format)
+  * @retval None
+  */
+static void LCD_FillSpan(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color)
+{
+    LCD_WAIT_BUS();
+    if ((uint32_t)width * height >= LCD_DMA_FILL_THRESHOLD) {
+#if LCD_USE_FRAMEBUFFER
+        FrameBuffer_FillRect(&s_framebuffer, x, y, width, height, color);
+#else
+        /* Window is reset when the fill completes */
+        FrameBuffer_FillGram(x, y, width, height, color);
+        s_is_span_window_narrow = 0;
+#endif // LCD_USE_FRAMEBUFFER
+        return;
+    }
+
+#if LCD_USE_FRAMEBUFFER
+    for (int16_t i = 0; i < height; i++) {
+        for (int16_t j = 0; j < width; j++) {
+            WRITE_PIXEL(x + j, y + i, color);
+        }
+    }
+#else
+    if (width == 1 && height == 1 && !s_is_span_window_narrow) {
+        WRITE_PIXEL(x, y, color);
+        return;
+    }
+
+    if (height == 1) {
+        SET_WINDOW(x, y, s_lcd_info.Width - x, s_lcd_info.Height - y);
+        s_is_span_window_narrow = 0;
+    }
+    else {
+        SET_WINDOW(x, y, width, s_lcd_info.Height - y);
+        s_is_span_window_narrow = 1;
+    }
+    PREPARE_WRITE();
+
+    for (int16_t i = width * height; i > 0; i--) {
+        WRITE_GRAM(color);
+    }
+#endif // LCD_USE_FRAMEBUFFER
+}
+
+/**
+  * @brief  Clips a span to the screen and fills it, see LCD_FillSpan()
+  * @param  x: Top-left corner X position, may be off screen
+  * @param  y: Top-left corner Y position, may be off screen
+  * @param  width:  Span width
+  * @param  height: Span height
+  * @param  color: Pixel color (RGB565 format)
+  * @retval None
+  */
+static void LCD_FillSpanClipped(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color)
+{
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if (x + width > s_lcd_info.Width) {
+        width = s_lcd_info.Width - x;
+    }
+    if (y + height > s_lcd_info.Height) {
+        height = s_lcd_info.Height - y;
+    }
+    if (width > 0 && height > 0) {
+        LCD_FillSpan(x, y, width, height, color);
+    }
+}
+
+/**
+  * @brief  Clips a circle once, picks the span fill its runs go through
+  * @param  x0: Center X position
+  * @param  y0: Center Y position
+  * @param  radius: Circle radius
+  * @retval LCD_FillSpan if the circle is on screen, LCD_FillSpanClipped if it
+  *         crosses the screen edge, NULL if it is off screen
+  */
+static LCD_SpanFunc LCD_GetSpanFunc(uint16_t x0, uint16_t y0, uint8_t radius)
+{
+    if (x0 >= s_lcd_info.Width + radius || y0 >= s_lcd_info.Height + radius) {
+        return NULL;
+    }
+    if (x0 < radius || y0 < radius || x0 + radius >= s_lcd_info.Width || y0 + radius >= s_lcd_info.Height) {
+        return LCD_FillSpanClipped;
+    }
+    return LCD_FillSpan;
+}
+
+/**
+  * @brief  Puts the right window edge back if the last spans moved it
+  * @param  None
+  * @retval None
+  */
+static void LCD_EndSpans(void)
+{
+#if !LCD_USE_FRAMEBUFFER
+    if (s_is_span_window_narrow) {
+        LCD_ResetWindow();
+        s_is_span_window_narrow = 0;
+    }
+#endif // !LCD_USE_FRAMEBUFFER
+}
+
+#if LCD_USE_FATFS
+/**
+  * @brief  Reads back a row of the screen area being saved
+  * @param  source: LCD_ScreenAreaTypeDef of the area
+  * @param  y: Row index in the area
+  * @param  buffer: Returns the row's pixels (RGB565 format)
+  * @retval None
+  */
+static void LCD_ReadScreenLine(const void *source, uint16_t y, uint16_t *buffer)
+{
+    const LCD_ScreenAreaTypeDef *area = (const LCD_ScreenAreaTypeDef *)source;
+
+    READ_LINE(area->X, area->Y + y, area->Width, buffer);
+}
+#endif // LCD_USE_FATFS
+
+#if !LCD_USE_FONTLIB
+/**
+  * @brief  Gets a rasterized ASCII glyph, expanding it into the cache on a miss
+  * @param  ch: Character, unprintable ones are drawn as spaces
+  * @param  font_size: Size of characters
+  * @param  color: Pixel color (RGB565 format)
+  * @param  bg_color: Background color (RGB565 format)
+  * @retval Row-major RGB565 glyph, NULL if it can't be cached now
+  */
+static const uint16_t* LCD_GetGlyph(uint8_t ch, uint8_t font_size, uint16_t color, uint16_t bg_color)
+{
+    uint8_t char_width = font_size / 2;
+    const uint8_t *font_buffer;
+    uint16_t *pixels;
+
+    if (ch < ' ' || ch > '~') {
+        ch = ' ';
+    }
+
+    pixels = GlyphCache_Find(ch, font_size, color, bg_color);
+    if (pixels != NULL) {
+        return pixels;
+    }
+
+    font_buffer = LCD_GetCharASCIIData(ch, font_size);
+    if (font_buffer == NULL) {
+        return NULL;
+    }
+
+    pixels = GlyphCache_Alloc(ch, font_size, color, bg_color);
+    if (pixels == NULL) {
+        return NULL;
+    }
+
+    /* Font data is column-major with the LSB on top */
+    for (uint8_t i = 0; i < char_width; i++)
+    {
+        for (uint8_t j = 0; j < font_size; j++)
+        {
+            uint8_t temp = font_buffer[i * (font_size >> 3) + (j >> 3)];
+            pixels[j * char_width + i] = (temp >> (j & 7)) & 1 ? color : bg_color;
+        }
+    }
+
+    return pixels;
+}
+#endif // !LCD_USE_FONTLIB
+
+
+#if LCD_USE_FONTLIB
+/**
+  * @brief  Gets glyph data of the font library, from SRAM cache if possible
+  * @note   The font file is only opened on a cache miss and stays open until
+  *         LCD_CloseFontFiles() is called
+  * @param  is_gb2312: 1 for the GB2312 library, 0 for ASCII
+  * @param  index: Glyph number in the font library file
+  * @param  font_size: Size of characters
+  * @param  buffer: Returns the glyph data
+  * @retval HAL_ERROR if the font file can't be read
+  */
+static HAL_StatusTypeDef LCD_LoadFontGlyph(_Bool is_gb2312, uint16_t index, uint8_t font_size, uint8_t *buffer)
+{
+    uint16_t buffer_size = font_size * font_size >> (is_gb2312 ? 3 : 4);
+    uint32_t key = FONT_CACHE_KEY(s_lcd_info.FontType, is_gb2312, font_size, index);
+    FIL *file = is_gb2312 ? &s_gb2312_font_file : &s_ascii_font_file;
+    uint8_t *file_size = is_gb2312 ? &s_gb2312_font_size : &s_ascii_font_size;
+    size_t read_count;
+
+    if (FontCache_Read(key, buffer, buffer_size) == HAL_OK) {
+        return HAL_OK;
+    }
+
+    if (*file_size != font_size)
+    {
+        char file_name[40];
+
+        switch (font_size)
+        {
+            case 16: case 24: case 32: case 40: break;
+            default: return HAL_ERROR;
+        }
+
+        if (*file_size) {
+            f_close(file);
+            *file_size = 0;
+        }
+
+        sprintf(file_name, "0:/fontlib/%s_%s_%ux%u.bin",
+            s_lcd_info.FontType == FONT_TYPE_SERIF ? "serif" : "sans",
+            is_gb2312 ? "gb2312" : "ascii",
+            is_gb2312 ? font_size : font_size / 2, font_size);
+
+        if (f_open(file, file_name, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+            return HAL_ERROR;
+        }
+        *file_size = font_size;
+    }
+
+    /* Calculate offset in font lib file */
+    f_lseek(file, (uint32_t)index * buffer_size);
+    if (f_read(file, buffer, buffer_size, &read_count) != FR_OK || read_count != buffer_size) {
+        return HAL_ERROR;
+    }
+
+    FontCache_Write(key, buffer, buffer_size);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Closes font library files left open by cache misses
+  * @retval None
+  */
+static void LCD_CloseFontFiles(void)
+{
+    if (s_ascii_font_size) {
+        f_close(&s_ascii_font_file);
+        s_ascii_font_size = 0;
+    }
+    if (s_gb2312_font_size) {
+        f_close(&s_gb2312_font_file);
+        s_gb2312_font_size = 0;
+    }
+}
+#endif // LCD_USE_FONTLIB
+
+
+#if LCD_USE_LIBJPEG
+/**
+  * @brief  LibJPEG fatal error handler, unwinds back to LCD_DrawJpegFromFile()
+  * @param  cinfo: JPEG decoder
+  * @retval None
+  */
+static void LCD_JpegErrorExit(j_common_ptr cinfo)
+{
+    LCD_JpegErrorTypeDef *jerr = (LCD_JpegErrorTypeDef *)cinfo->err;
+    longjmp(jerr->JumpBuffer, 1);
+}
+
+/**
+  * @brief  LibJPEG message handler, there is no console to print to
+  * @param  cinfo: JPEG decoder
+  * @retval None
+  */
+static void LCD_JpegOutputMessage(j_common_ptr cinfo)
+{
+}
+#endif // LCD_USE_LIBJPEG
+
 /* End of file ---------------------------------------------------------------*/
\ No newline at end of file
@@ -0,0 +1,292 @@
+/**
+  ******************************************************************************
+  * @file       norm_profile.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      Cached sweep normalization profiles
+  *
+  * @note       Profiles are keyed by sweep range, step and output amplitude.
+  *             Point data lives in external SRAM for fast reuse and every slot
+  *             is mirrored to W25Qxx flash, so profiles survive power cycles.
+  *             A request is served from an exact match, or interpolated from
+  *             a profile with the same amplitude whose range covers it. When
+  *             all slots are taken the least recently used one is replaced.
+  *
+  *             Flash slot layout: 32-byte header (magic, key, LRU sequence,
+  *             CRC-32 of point data) followed by Count little-endian int16.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "norm_profile.h"
+#include "crc32.h"
+#include "fsmc.h"
+#include "sram.h"
+#include "w25qxx.h"
+
+/* Private Marcos ------------------------------------------------------------*/
+#define HEADER_SIZE             32
+#define CHUNK_SIZE              256
+
+#define SLOT_DATA(SLOT)         ((__IO int16_t *)(FSMC_SRAM_BASE_ADDR + SRAM_NORM_PROFILE_OFFSET) \
+                                 + (SLOT) * NORM_PROFILE_MAX_POINTS)
+#define SLOT_FLASH_ADDR(SLOT)   (NORM_PROFILE_FLASH_ADDR + (SLOT) * NORM_PROFILE_FLASH_SLOT)
+
+/* Private Types -------------------------------------------------------------*/
+typedef struct
+{
+    NormProfile_KeyTypeDef Key;
+    uint32_t Sequence;      //Last use stamp, 0 marks an empty slot
+    uint32_t Crc;
+
+} ProfileSlotTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static ProfileSlotTypeDef s_slots[NORM_PROFILE_SLOTS];
+static uint32_t s_sequence;
+
+/* Staging buffer between SRAM and SPI flash, SRAM is only accessed 16 bits wide */
+static uint16_t s_chunk[CHUNK_SIZE / 2];
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef LoadSlot(uint8_t slot);
+static void SaveSlot(uint8_t slot);
+static void Touch(uint8_t slot);
+static inline _Bool IsSameKey(const NormProfile_KeyTypeDef *a, const NormProfile_KeyTypeDef *b);
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Restores all valid profiles from flash into SRAM
+  * @note   W25QXX_Init() and FSMC_Init() must be called before this
+  * @retval None
+  */
+void NormProfile_Init(void)
+{
+    s_sequence = 0;
+
+    for (uint8_t i = 0; i < NORM_PROFILE_SLOTS; i++) {
+        if (LoadSlot(i) != HAL_OK) {
+            s_slots[i].Sequence = 0;
+        }
+        else if (s_slots[i].Sequence > s_sequence) {
+            s_sequence = s_slots[i].Sequence;
+        }
+    }
+}
+
+/**
+  * @brief  Gets normalization values for a sweep setting
+  * @param  key: Wanted sweep setting
+  * @param  values: Returns key->Count points
+  * @retval HAL_ERROR if no stored profile matches or covers the setting
+  */
+HAL_StatusTypeDef NormProfile_Fetch(const NormProfile_KeyTypeDef *key, int16_t *values)
+{
+    uint8_t best = NORM_PROFILE_SLOTS;
+
+    for (uint8_t i = 0; i < NORM_PROFILE_SLOTS; i++) {
+        const NormProfile_KeyTypeDef *k = &s_slots[i].Key;
+
+        if (s_slots[i].Sequence == 0) {
+            continue;
+        }
+
+        if (IsSameKey(k, key)) {
+            __IO int16_t *data = SLOT_DATA(i);
+            for (uint16_t n = 0; n < key->Count; n++) {
+                values[n] = data[n];
+            }
+            Touch(i);
+            return HAL_OK;
+        }
+
+        /* Candidate for interpolation: same level, covers the whole range */
+        uint32_t last = key->Start + (uint32_t)(key->Count - 1) * key->Step;
+        uint32_t stored_last = k->Start + (uint32_t)(k->Count - 1) * k->Step;
+
+        if (k->Amplitude == key->Amplitude && k->Count > 1
+            && k->Start <= key->Start && stored_last >= last) {
+            /* Prefer the finest stored step */
+            if (best == NORM_PROFILE_SLOTS || k->Step < s_slots[best].Key.Step) {
+                best = i;
+            }
+        }
+    }
+
+    if (best == NORM_PROFILE_SLOTS) {
+        return HAL_ERROR;
+    }
+
+    const NormProfile_KeyTypeDef *k = &s_slots[best].Key;
+    __IO int16_t *data = SLOT_DATA(best);
+
+    for (uint16_t n = 0; n < key->Count; n++) {
+        uint32_t offset = key->Start + n * key->Step - k->Start;
+        uint16_t index = offset / k->Step;
+        uint32_t frac = offset % k->Step;
+
+        if (index >= k->Count - 1) {
+            values[n] = data[k->Count - 1];
+        }
+        else {
+            int32_t y0 = data[index];
+            int32_t y1 = data[index + 1];
+            values[n] = (int16_t)(y0 + (y1 - y0) * (int32_t)frac / (int32_t)k->Step);
+        }
+    }
+
+    Touch(best);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Stores a freshly measured profile in SRAM and flash
+  * @note   Replaces a profile with the same key, otherwise an empty slot or
+  *         the least recently used one. Blocks during the flash erase.
+  * @param  key: Sweep setting the values were measured with
+  * @param  values: key->Count points
+  * @retval HAL_ERROR if the profile is too long
+  */
+HAL_StatusTypeDef NormProfile_Store(const NormProfile_KeyTypeDef *key, const int16_t *values)
+{
+    if (key->Count == 0 || key->Count > NORM_PROFILE_MAX_POINTS) {
+        return HAL_ERROR;
+    }
+
+    uint8_t slot = 0;
+
+    for (uint8_t i = 0; i < NORM_PROFILE_SLOTS; i++) {
+        if (s_slots[i].Sequence != 0 && IsSameKey(&s_slots[i].Key, key)) {
+            slot = i;
+            break;
+        }
+        if (s_slots[i].Sequence < s_slots[slot].Sequence) {
+            slot = i;
+        }
+    }
+
+    __IO int16_t *data = SLOT_DATA(slot);
+    for (uint16_t n = 0; n < key->Count; n++) {
+        data[n] = values[n];
+    }
+
+    s_slots[slot].Key = *key;
+    s_slots[slot].Crc = CRC32_Update(CRC32_INIT_VALUE, (const uint8_t *)values, key->Count * 2);
+    Touch(slot);
+
+    SaveSlot(slot);
+    return HAL_OK;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Copies one flash slot into SRAM and validates it
+  * @param  slot: Slot index
+  * @retval HAL_ERROR if the slot is empty or corrupt
+  */
+static HAL_StatusTypeDef LoadSlot(uint8_t slot)
+{
+    ProfileSlotTypeDef *s = &s_slots[slot];
+    uint32_t header[HEADER_SIZE / 4];
+
+    W25QXX_Read(SLOT_FLASH_ADDR(slot), (uint8_t *)header, HEADER_SIZE);
+
+    if (header[0] != NORM_PROFILE_MAGIC) {
+        return HAL_ERROR;
+    }
+
+    s->Key.Start = header[1];
+    s->Key.Stop = header[2];
+    s->Key.Step = header[3];
+    s->Key.Amplitude = (uint16_t)header[4];
+    s->Key.Count = (uint16_t)(header[4] >> 16);
+    s->Sequence = header[5];
+    s->Crc = header[6];
+
+    if (s->Key.Count == 0 || s->Key.Count > NORM_PROFILE_MAX_POINTS || s->Key.Step == 0) {
+        return HAL_ERROR;
+    }
+
+    __IO int16_t *data = SLOT_DATA(slot);
+    uint32_t crc = CRC32_INIT_VALUE;
+    uint32_t addr = SLOT_FLASH_ADDR(slot) + HEADER_SIZE;
+    uint32_t remain = s->Key.Count * 2;
+
+    while (remain)
+    {
+        uint32_t size = (remain > CHUNK_SIZE) ? CHUNK_SIZE : remain;
+
+        W25QXX_Read(addr, (uint8_t *)s_chunk, size);
+        crc = CRC32_Update(crc, (const uint8_t *)s_chunk, size);
+
+        for (uint32_t n = 0; n < size / 2; n++) {
+            *(data++) = s_chunk[n];
+        }
+
+        addr += size;
+        remain -= size;
+    }
+
+    return (crc == s->Crc) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  Writes one SRAM slot back to flash
+  * @param  slot: Slot index
+  * @retval None
+  */
+static void SaveSlot(uint8_t slot)
+{
+    const ProfileSlotTypeDef *s = &s_slots[slot];
+    uint32_t header[HEADER_SIZE / 4] = { 0 };
+
+    header[0] = NORM_PROFILE_MAGIC;
+    header[1] = s->Key.Start;
+    header[2] = s->Key.Stop;
+    header[3] = s->Key.Step;
+    header[4] = s->Key.Amplitude | ((uint32_t)s->Key.Count << 16);
+    header[5] = s->Sequence;
+    header[6] = s->Crc;
+
+    for (uint32_t offset = 0; offset < NORM_PROFILE_FLASH_SLOT; offset += 0x1000) {
+        W25QXX_SectorErase(SLOT_FLASH_ADDR(slot) + offset);
+    }
+    W25QXX_Write(SLOT_FLASH_ADDR(slot), (uint8_t *)header, HEADER_SIZE);
+
+    __IO int16_t *data = SLOT_DATA(slot);
+    uint32_t addr = SLOT_FLASH_ADDR(slot) + HEADER_SIZE;
+    uint32_t remain = s->Key.Count * 2;
+
+    while (remain)
+    {
+        uint32_t size = (remain > CHUNK_SIZE) ? CHUNK_SIZE : remain;
+
+        for (uint32_t n = 0; n < size / 2; n++) {
+            s_chunk[n] = *(data++);
+        }
+        W25QXX_Write(addr, (uint8_t *)s_chunk, size);
+
+        addr += size;
+        remain -= size;
+    }
+}
+
+/**
+  * @brief  Marks a slot as most recently used
+  * @note   The stamp only reaches flash with the next store of that slot, so
+  *         LRU order after a power cycle reflects the last stores.
+  * @param  slot: Slot index
+  * @retval None
+  */
+static void Touch(uint8_t slot)
+{
+    s_slots[slot].Sequence = ++s_sequence;
+}
+
+static inline _Bool IsSameKey(const NormProfile_KeyTypeDef *a, const NormProfile_KeyTypeDef *b)
+{
+    return a->Start == b->Start && a->Stop == b->Stop && a->Step == b->Step
+        && a->Amplitude == b->Amplitude && a->Count == b->Count;
+}
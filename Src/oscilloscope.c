@@ -5,6 +5,8 @@
 #include "zlg7290.h"
 #include "lcd.h"
 #include "curve_chart.h"
+#include "text_label.h"
+#include "strip_renderer.h"
 #include "colors.h"
 #include "pattern.h"
 #include "fsmc.h"
@@ -16,6 +18,8 @@
 static uint8_t str_buffer[16];
 static uint16_t display_values[GRID_WIDTH];
 static CurveChartTypeDef graph;
+static TextLabelTypeDef freq_label, vpp_label, rms_label;
+static TextLabelTypeDef time_offset_label, volt_offset_label;
 extern TIM_HandleTypeDef htim6;
 extern TIM_HandleTypeDef htim7;
 
@@ -75,12 +79,18 @@ void Oscilloscope_Init(void)
     graph.FineGridColor = DARKGRAY;
     CurveChart_Init(&graph);
 
+    TextLabel_Init(&freq_label, GRID_X + 64, GRID_Y + GRID_HEIGHT + 16, 108, 24, PURPLE, BLACK);
+    TextLabel_Init(&vpp_label, GRID_X + 280, GRID_Y + GRID_HEIGHT + 16, 108, 24, PURPLE, BLACK);
+    TextLabel_Init(&rms_label, GRID_X + 472, GRID_Y + GRID_HEIGHT + 16, 108, 24, PURPLE, BLACK);
+    TextLabel_Init(&time_offset_label, TIMEBOX_X + 44, TIMEBOX_Y + 96, 84, 24, YELLOW, BLACK);
+    TextLabel_Init(&volt_offset_label, VOLTBOX_X + 44, VOLTBOX_Y + 96, 84, 24, YELLOW, BLACK);
+
     LCD_DrawRect(TIMEBOX_X, TIMEBOX_Y, TIMEBOX_WIDTH, TIMEBOX_HEIGHT, WHITE);
     LCD_DrawString("水平时基档位", 24, TIMEBOX_X + 12, TIMEBOX_Y + 6, WHITE);
     LCD_DrawString(time_base_tag[osc_args.TimeBase], 24, TIMEBOX_X + (TIMEBOX_WIDTH - strlen(time_base_tag[osc_args.TimeBase]) * 12) / 2, TIMEBOX_Y + 36, YELLOW);
 
     LCD_DrawString("水平偏移", 24, TIMEBOX_X + 36, TIMEBOX_Y + 66, WHITE);
-    LCD_DrawBitmapStream(down_triangle_pattern, GRID_X + GRID_WIDTH / 2 + osc_args.TimeOffset - 5, GRID_Y - 12, 11, 11);
+    LCD_DrawSprite(&down_triangle_sprite, GRID_X + GRID_WIDTH / 2 + osc_args.TimeOffset - 5, GRID_Y - 12);
     UpdateHorizontalPosInfo();
 
     LCD_DrawRect(VOLTBOX_X, VOLTBOX_Y, VOLTBOX_WIDTH, VOLTBOX_HEIGHT, WHITE);
@@ -88,7 +98,7 @@ void Oscilloscope_Init(void)
     LCD_DrawString(volt_base_tag[osc_args.VoltBase], 24, VOLTBOX_X + (VOLTBOX_WIDTH - strlen(volt_base_tag[osc_args.VoltBase]) * 12) / 2, VOLTBOX_Y + 36, YELLOW);
 
     LCD_DrawString("垂直偏移", 24, VOLTBOX_X + 36, VOLTBOX_Y + 66, WHITE);
-    LCD_DrawBitmapStream(right_triangle_pattern, GRID_X - 12, GRID_Y + GRID_HEIGHT / 2 - osc_args.VoltOffset - 5, 11, 11);
+    LCD_DrawSprite(&right_triangle_sprite, GRID_X - 12, GRID_Y + GRID_HEIGHT / 2 - osc_args.VoltOffset - 5);
     UpdateVerticalPosInfo();
 
     /*
@@ -107,7 +117,9 @@ void Oscilloscope_Init(void)
     LCD_DrawString("峰峰值", 24, GRID_X + 192, GRID_Y + GRID_HEIGHT + 16, WHITE);
     LCD_DrawString("有效值", 24, GRID_X + 384, GRID_Y + GRID_HEIGHT + 16, WHITE);
 
-    LCD_DrawImageFromFile(VOLTBOX_X + 16, VOLTBOX_Y + VOLTBOX_HEIGHT + 10, 128, 128, "0:TigerHead.rgb16");
+#if LCD_USE_FATFS
+    LCD_DrawBitmapStreamFromFile("0:TigerHead.rgb16", VOLTBOX_X + 16, VOLTBOX_Y + VOLTBOX_HEIGHT + 10, 128, 128);
+#endif // LCD_USE_FATFS
     LCD_DrawString("LG", 24, 770, 450, STEELBLUE);
 }
 
@@ -177,7 +189,6 @@ void Oscilloscope_Start(void)
             __HAL_TIM_SET_COUNTER(&htim7, 0);
 
             /* 频率计显示 */
-            LCD_FillRect(GRID_X + 64, GRID_Y + GRID_HEIGHT + 16, 108, 24, BLACK);
             if (is_freq_captured && freqmeter_clk_count > 600) {
                 if (freqmeter_clk_count > 60000) {
                     sprintf(str_buffer, "%.3fHz", 6000000.0f / freqmeter_clk_count);
@@ -185,11 +196,11 @@ void Oscilloscope_Start(void)
                 else {
                     sprintf(str_buffer, "%.2fHz", 6000000.0f / freqmeter_clk_count);
                 }
-                LCD_DrawString(str_buffer, 24, GRID_X + 64, GRID_Y + GRID_HEIGHT + 16, PURPLE);
+                TextLabel_Update(&freq_label, str_buffer);
                 is_freq_captured = 0;
             }
             else {
-                LCD_DrawString("------", 24, GRID_X + 64, GRID_Y + GRID_HEIGHT + 16, PURPLE);
+                TextLabel_Update(&freq_label, "------");
             }
             /* 峰峰值显示 */
             if (volt_pp < 1000.0f) {
@@ -198,8 +209,7 @@ void Oscilloscope_Start(void)
             else {
                 sprintf(str_buffer, "%.3fA", volt_pp * 0.001f);
             }
-            LCD_FillRect(GRID_X + 280, GRID_Y + GRID_HEIGHT + 16, 108, 24, BLACK);
-            LCD_DrawString(str_buffer, 24, GRID_X + 280, GRID_Y + GRID_HEIGHT + 16, PURPLE);
+            TextLabel_Update(&vpp_label, str_buffer);
 
             /* 有效值显示 */
             volt_pp *= 0.3535534f;
@@ -209,24 +219,23 @@ void Oscilloscope_Start(void)
             else {
                 sprintf(str_buffer, "%.3fA", volt_pp * 0.001f);
             }
-            LCD_FillRect(GRID_X + 472, GRID_Y + GRID_HEIGHT + 16, 108, 24, BLACK);
-            LCD_DrawString(str_buffer, 24, GRID_X + 472, GRID_Y + GRID_HEIGHT + 16, PURPLE);
+            TextLabel_Update(&rms_label, str_buffer);
 #if DEBUG
             printf("Extra Gain = %u, ADC Code diff = %u\n", is_extra_gain, max_val - min_val);
 #endif
         }
 
-#if CurveChart_USE_BACKBUFFER
-        LCD_BackBuffer_Update();
-#endif // CurveChart_USE_BACKBUFFER
+#if CHART_USE_FRAMEBUFFER
+        CurveChart_FrameUpdate();
+#endif // CHART_USE_FRAMEBUFFER
+        FSMC_LCD_FRAME_DONE("osc");
 
         switch (ZLG7290_ReadKey())
         {
             /* 水平时基选择 */
             case 1:
                 osc_args.TimeBase = (osc_args.TimeBase + 1) % 3;
-                LCD_FillRect(TIMEBOX_X + 12, TIMEBOX_Y + 36, 150, 24, BLACK);
-                LCD_DrawString(time_base_tag[osc_args.TimeBase], 24, TIMEBOX_X + (TIMEBOX_WIDTH - strlen(time_base_tag[osc_args.TimeBase]) * 12) / 2, TIMEBOX_Y + 36, YELLOW);
+                DrawBaseTag(TIMEBOX_X, TIMEBOX_Y, TIMEBOX_WIDTH, time_base_tag[osc_args.TimeBase]);
                 UpdateHorizontalPosInfo();
                 ConfigSamplingArgs();
                 break;
@@ -234,8 +243,7 @@ void Oscilloscope_Start(void)
                 /* 垂直电压档选择 */
             case 2:
                 osc_args.VoltBase = (osc_args.VoltBase + 1) % 6;
-                LCD_FillRect(VOLTBOX_X + 12, VOLTBOX_Y + 36, 150, 24, BLACK);
-                LCD_DrawString(volt_base_tag[osc_args.VoltBase], 24, VOLTBOX_X + (VOLTBOX_WIDTH - strlen(volt_base_tag[osc_args.VoltBase]) * 12) / 2, VOLTBOX_Y + 36, YELLOW);
+                DrawBaseTag(VOLTBOX_X, VOLTBOX_Y, VOLTBOX_WIDTH, volt_base_tag[osc_args.VoltBase]);
 
                 switch (osc_args.VoltBase)
                 {
@@ -255,16 +263,14 @@ void Oscilloscope_Start(void)
                 /*
             case 9:
                 osc_args.Coupling = !osc_args.Coupling;
-                LCD_FillRect(INPUTBOX_X + 96, INPUTBOX_Y + 8, 32, 32, BLACK);
-                LCD_DrawString((osc_args.Coupling) ? "AC" : "DC", 32, INPUTBOX_X + 96, INPUTBOX_Y + 8, CYAN);
+                LCD_DrawStringOpaque((osc_args.Coupling) ? "AC" : "DC", 32, INPUTBOX_X + 96, INPUTBOX_Y + 8, 32, CYAN, BLACK);
                 break;
                 */
                 /* 探头倍率选择 */
                 /*
             case 10:
                 osc_args.ProbeAttenuation = !osc_args.ProbeAttenuation;
-                LCD_FillRect(INPUTBOX_X + 96, INPUTBOX_Y + 56, 48, 32, BLACK);
-                LCD_DrawString((osc_args.ProbeAttenuation) ? "10x" : "1x", 32, INPUTBOX_X + 96, INPUTBOX_Y + 56, CYAN);
+                LCD_DrawStringOpaque((osc_args.ProbeAttenuation) ? "10x" : "1x", 32, INPUTBOX_X + 96, INPUTBOX_Y + 56, 48, CYAN, BLACK);
                 break;
                 */
                 /* 水平位置调整 */
@@ -345,13 +351,12 @@ static void AdjustVerticalPos(_Bool up_down_select)
     osc_args.VoltOffset += delta;
     osc_args.VoltOffset = CLAMP(osc_args.VoltOffset, -GRID_HEIGHT / 2, GRID_HEIGHT / 2);
 
-    LCD_DrawBitmapStream(right_triangle_pattern, GRID_X - 12, GRID_Y + GRID_HEIGHT / 2 - osc_args.VoltOffset - 5, 11, 11);
+    LCD_DrawSprite(&right_triangle_sprite, GRID_X - 12, GRID_Y + GRID_HEIGHT / 2 - osc_args.VoltOffset - 5);
     UpdateVerticalPosInfo();
 }
 
 static inline void UpdateVerticalPosInfo(void)
 {
-    LCD_FillRect(VOLTBOX_X + 44, VOLTBOX_Y + 96, 84, 24, BLACK);
     switch (osc_args.VoltBase)
     {
         case DIV_5mV: sprintf(str_buffer, "%+3.1fmA", osc_args.VoltOffset * 0.1f); break;
@@ -360,9 +365,11 @@ static inline void UpdateVerticalPosInfo(void)
         case DIV_100mV: sprintf(str_buffer, "%+3.0fmA", osc_args.VoltOffset * 2.0f); break;
         case DIV_500mV: sprintf(str_buffer, "%+3.2fA", osc_args.VoltOffset * 0.01f); break;
         case DIV_1V: sprintf(str_buffer, "%+3.2fA", osc_args.VoltOffset * 0.02f); break;
-        default: return;
+        default:
+            TextLabel_Update(&volt_offset_label, "");
+            return;
     }
-    LCD_DrawString(str_buffer, 24, VOLTBOX_X + 44, VOLTBOX_Y + 96, YELLOW);
+    TextLabel_Update(&volt_offset_label, str_buffer);
 }
 
 static void AdjustHorizontalPos(_Bool right_left_select)
@@ -384,22 +391,23 @@ static void AdjustHorizontalPos(_Bool right_left_select)
     osc_args.TimeOffset += delta;
     osc_args.TimeOffset = CLAMP(osc_args.TimeOffset, -GRID_WIDTH / 2, GRID_WIDTH / 2);
 
-    LCD_DrawBitmapStream(down_triangle_pattern, GRID_X + GRID_WIDTH / 2 + osc_args.TimeOffset - 5, GRID_Y - 12, 11, 11);
+    LCD_DrawSprite(&down_triangle_sprite, GRID_X + GRID_WIDTH / 2 + osc_args.TimeOffset - 5, GRID_Y - 12);
     UpdateHorizontalPosInfo();
 }
 
 static inline void UpdateHorizontalPosInfo(void)
 {
-    LCD_FillRect(TIMEBOX_X + 44, TIMEBOX_Y + 96, 84, 24, BLACK);
     switch (osc_args.TimeBase)
     {
         case DIV_1ms: sprintf(str_buffer, "%+3.2fms", osc_args.TimeOffset * 0.02f); break;
         case DIV_5ms: sprintf(str_buffer, "%+3.2fms", osc_args.TimeOffset * 0.1f); break;
         case DIV_10ms: sprintf(str_buffer, "%+3.1fms", osc_args.TimeOffset * 0.2f); break;
         case DIV_50ms: sprintf(str_buffer, "%+3.1fms", osc_args.TimeOffset); break;
-        default: return;
+        default:
+            TextLabel_Update(&time_offset_label, "");
+            return;
     }
-    LCD_DrawString(str_buffer, 24, TIMEBOX_X + 44, TIMEBOX_Y + 96, YELLOW);
+    TextLabel_Update(&time_offset_label, str_buffer);
 }
 
 static void AdjustTriggerVoltage(_Bool up_down_select)
@@ -452,6 +460,21 @@ void TIM6_DAC_IRQHandler(void)
     }
 }
 
+/* 档位文字整块重绘, 先清后写会闪烁 */
+static void DrawBaseTag(uint16_t box_x, uint16_t box_y, uint16_t box_width, const uint8_t *tag)
+{
+    int16_t x = (box_width - strlen(tag) * 12) / 2 - 12;
+
+#if LCD_USE_FRAMEBUFFER
+    LCD_FillRect(box_x + 12, box_y + 36, 150, 24, BLACK);
+    LCD_DrawString(tag, 24, box_x + 12 + x, box_y + 36, YELLOW);
+#else
+    StripRenderer_Begin(box_x + 12, box_y + 36, 150, 24, BLACK);
+    StripRenderer_DrawString(tag, 24, x, 0, YELLOW);
+    StripRenderer_End();
+#endif // LCD_USE_FRAMEBUFFER
+}
+
 static inline void ConfigSamplingArgs(void)
 {
     switch (osc_args.TimeBase)
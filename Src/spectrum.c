@@ -1,6 +1,7 @@
 #include "spectrum.h"
 #include "lcd.h"
 #include "curve_chart.h"
+#include "text_label.h"
 #include "colors.h"
 //#include "adc.h"
 #include "ads8694.h"
@@ -27,6 +28,11 @@ arm_rfft_fast_instance_f32 rfft;
 static uint8_t str_buffer[16];
 static int16_t display_values[GRID_WIDTH];
 static CurveChartTypeDef chart;
+static TextLabelTypeDef base_freq_label, cursor_label, freq_base_label;
+static TextLabelTypeDef harmonic_labels[9];
+static const uint16_t harmonic_colors[9] = {
+    RED, ORANGE, YELLOW, GREEN, OLIVE, PERRY, DODGERBLUE, MAGENTA, BROWN
+};
 
 static float scale_factor = 10.0f;
 static uint8_t freq_base;
@@ -63,6 +69,13 @@ void SpectrumDisplay_Init(void)
     chart.FineGridColor = DARKGRAY;
     CurveChart_Init(&chart);
 
+    TextLabel_Init(&base_freq_label, BASEFREQBOX_X + 20, BASEFREQBOX_Y + 36, 96, 32, LIGHTGRAY, BLACK);
+    for (uint8_t i = 0; i < 9; i++) {
+        TextLabel_Init(&harmonic_labels[i], AMPBOX_X + 80, AMPBOX_Y + 38 + 22 * i, 80, 16, harmonic_colors[i], BLACK);
+    }
+    TextLabel_Init(&freq_base_label, GRID_X + 100, GRID_Y + GRID_HEIGHT + 24, 108, 24, CYAN, BLACK);
+    TextLabel_Init(&cursor_label, GRID_X + 320, GRID_Y + GRID_HEIGHT + 24, 160, 24, GREEN, BLACK);
+
     LCD_DrawRect(BASEFREQBOX_X, BASEFREQBOX_Y, BASEFREQBOX_WIDTH, BASEFREQBOX_HEIGHT, WHITE);
     LCD_DrawString("基波频率", 24, BASEFREQBOX_X + 36, BASEFREQBOX_Y + 6, WHITE);
 
@@ -82,7 +95,9 @@ void SpectrumDisplay_Init(void)
     LCD_DrawString("水平档位", 24, GRID_X, GRID_Y + GRID_HEIGHT + 24, WHITE);
     LCD_DrawString("光标位置", 24, GRID_X + 216, GRID_Y + GRID_HEIGHT + 24, WHITE);
 
-    LCD_DrawImageFromFile(AMPBOX_X + 16, AMPBOX_Y + AMPBOX_HEIGHT + 10, 128, 128, "0:TigerHead.rgb16");
+#if LCD_USE_FATFS
+    LCD_DrawBitmapStreamFromFile("0:TigerHead.rgb16", AMPBOX_X + 16, AMPBOX_Y + AMPBOX_HEIGHT + 10, 128, 128);
+#endif // LCD_USE_FATFS
 
     LCD_DrawString("LG", 24, 770, 450, STEELBLUE);
 
@@ -129,11 +144,12 @@ void SpectrumDisplay_Start(void)
 
         /* Draw spectrum curve */
         CurveChart_DrawCurve(&chart, display_values, YELLOW);
-        CurveChart_DrawImage(&chart, cursor_pos - 8, display_values[cursor_pos] + 16, 16, 16, arrow_pattern);
+        CurveChart_DrawSprite(&chart, cursor_pos - 8, display_values[cursor_pos] + 16, &arrow_sprite);
 
-#ifdef GRAPH_USE_BACKBUFFER
-        LCD_BackBuffer_Update();
-#endif // GRAPH_USE_BACKBUFFER
+#if CHART_USE_FRAMEBUFFER
+        CurveChart_FrameUpdate();
+#endif // CHART_USE_FRAMEBUFFER
+        FSMC_LCD_FRAME_DONE("spectrum");
 
         switch (ZLG7290_ReadKey())
         {
@@ -268,8 +284,7 @@ void MeasureHarmonics(void)
     else {
         sprintf(str_buffer, "%6.2fHz", base_freq);
     }
-    LCD_FillRect(BASEFREQBOX_X + 20, BASEFREQBOX_Y + 36, 96, 32, BLACK);
-    LCD_DrawString(str_buffer, 32, BASEFREQBOX_X + 20, BASEFREQBOX_Y + 36, LIGHTGRAY);
+    TextLabel_Update(&base_freq_label, str_buffer);
 
     //printf("%f Hz, Amp factor = %f\n", base_freq, amp_factor);
 
@@ -292,10 +307,6 @@ void MeasureHarmonics(void)
 
     uint32_t peak_index;
     float peak_amp;
-    uint16_t harmonic_colors[] = {
-        RED, ORANGE, YELLOW, GREEN, OLIVE, PERRY, DODGERBLUE, MAGENTA, BROWN
-    };
-
     /* Remap the first harmonic index under the higher sampling rate */
     base_peak_index /= 4;
 
@@ -328,8 +339,7 @@ void MeasureHarmonics(void)
         else {
             sprintf(str_buffer, "%7.5fAp", peak_amp * 0.001f);
         }
-        LCD_FillRect(AMPBOX_X + 80, AMPBOX_Y + 16 + 22 * i, 80, 16, BLACK);
-        LCD_DrawString(str_buffer, 16, AMPBOX_X + 80, AMPBOX_Y + 16 + 22 * i, harmonic_colors[i - 1]);
+        TextLabel_Update(&harmonic_labels[i - 1], str_buffer);
         //printf("harmonic%u_amp = %f\n", i, peak_amp);
     }
 
@@ -365,8 +375,7 @@ static inline void UpdateCursorInfo(void)
             break;
     }
 
-    LCD_FillRect(GRID_X + 320, GRID_Y + GRID_HEIGHT + 24, 160, 24, BLACK);
-    LCD_DrawString(str_buffer, 24, GRID_X + 320, GRID_Y + GRID_HEIGHT + 24, GREEN);
+    TextLabel_Update(&cursor_label, str_buffer);
 }
 
 static void UpdateSamplingArgs(void)
@@ -399,8 +408,7 @@ static void UpdateSamplingArgs(void)
 
 static inline void UpdateFrequencyInfo(void)
 {
-    LCD_FillRect(GRID_X + 100, GRID_Y + GRID_HEIGHT + 24, 108, 24, BLACK);
-    LCD_DrawString(freq_base_tag[freq_base], 24, GRID_X + 100, GRID_Y + GRID_HEIGHT + 24, CYAN);
+    TextLabel_Update(&freq_base_label, freq_base_tag[freq_base]);
 }
 
 static void GenerateWindowFunction(float *window, uint16_t length, uint8_t type)
@@ -0,0 +1,536 @@
+/**
+  ******************************************************************************
+  * @file       strip_renderer.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.10
+  * @brief      Display list renderer drawing a screen area strip by strip
+  *
+  * @note       All coordinates are relative to the area given to
+  *             StripRenderer_Begin() and may fall partly outside of it, every
+  *             op is clipped to the strip being rasterized. Strip buffers are
+  *             DMA sources, so they must not be placed in CCM RAM.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "strip_renderer.h"
+#include "frame_buffer.h"
+#include "lcd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Private Marcos ------------------------------------------------------------*/
+#define STRIP_PIXELS                (STRIP_RENDERER_MAX_WIDTH * STRIP_RENDERER_ROWS)
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t s_strips[2][STRIP_PIXELS] __attribute__((aligned(4)));
+
+static StripRenderer_OpTypeDef s_ops[STRIP_RENDERER_MAX_OPS];
+static uint16_t s_op_count;
+static uint8_t s_text_pool[STRIP_RENDERER_TEXT_POOL];
+static uint16_t s_text_used;
+static _Bool s_is_overflowed;          //Some ops were dropped this frame
+
+static uint16_t s_x, s_y, s_width, s_height;
+static uint16_t s_bg_color;
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Starts recording a frame for a screen area
+  * @param  x: Specifies the X top-left position on screen
+  * @param  y: Specifies the Y top-left position on screen
+  * @param  width: Area width, at most STRIP_RENDERER_MAX_WIDTH
+  * @param  height: Area height
+  * @param  bg_color: Color of pixels no op covers
+  * @retval None
+  */
+void StripRenderer_Begin(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t bg_color)
+{
+    s_x = x;
+    s_y = y;
+    s_width = (width < STRIP_RENDERER_MAX_WIDTH) ? width : STRIP_RENDERER_MAX_WIDTH;
+    s_height = height;
+    s_bg_color = bg_color;
+
+    s_op_count = 0;
+    s_text_used = 0;
+    s_is_overflowed = 0;
+}
+
+/**
+  * @brief  Rasterizes the recorded frame and sends it to screen
+  * @note   Returns when the last strip has started sending, the LCD bus is
+  *         busy until FrameBuffer_WaitBus() returns.
+  *         A strip buffer is only refilled once the bus is done with it.
+  * @param  None
+  * @retval HAL_ERROR if the display list overflowed and some ops are missing,
+  *         HAL_TIMEOUT if the previous frame was stuck on the bus and aborted
+  */
+HAL_StatusTypeDef StripRenderer_End(void)
+{
+    HAL_StatusTypeDef status;
+    uint16_t rows_per_strip;
+    uint8_t index = 0;
+
+    if (s_width == 0) {
+        return HAL_OK;
+    }
+    /* Narrow areas get taller strips out of the same buffers */
+    rows_per_strip = STRIP_PIXELS / s_width;
+    /* The last strip of the previous frame may still be sending from either buffer */
+    status = FrameBuffer_WaitBus();
+
+    for (uint16_t top = 0; top < s_height; top += rows_per_strip)
+    {
+        uint16_t rows = (s_height - top < rows_per_strip) ? s_height - top : rows_per_strip;
+        uint16_t *strip = s_strips[index];
+        uint32_t fill_word = s_bg_color | ((uint32_t)s_bg_color << 16);
+        uint32_t *words = (uint32_t *)strip;
+
+        /* This buffer was sent two strips ago, the last write waited for it */
+        for (uint32_t i = 0; i < ((uint32_t)s_width * rows + 1) / 2; i++) {
+            words[i] = fill_word;
+        }
+
+        for (uint16_t i = 0; i < s_op_count; i++)
+        {
+            const StripRenderer_OpTypeDef *op = &s_ops[i];
+
+            if (op->Top < top + rows && op->Bottom > top) {
+                StripRenderer_RasterizeOp(op, strip, top, top + rows);
+            }
+        }
+
+        FrameBuffer_WriteGram(s_x, s_y + top, s_width, rows, strip);
+        index ^= 1;
+    }
+
+    return s_is_overflowed ? HAL_ERROR : status;
+}
+
+/**
+  * @brief  Records a filled rectangle
+  * @param  x: Specifies the X top-left position
+  * @param  y: Specifies the Y top-left position
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_FillRect(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    StripRenderer_OpTypeDef *op = StripRenderer_AddOp(STRIP_OP_FILL_RECT, y, y + height);
+
+    if (op != NULL) {
+        op->Color = color;
+        op->X0 = x;
+        op->Y0 = y;
+        op->X1 = x + width;
+        op->Y1 = y + height;
+    }
+}
+
+/**
+  * @brief  Records a rectangle outline
+  * @param  x: Specifies the X top-left position
+  * @param  y: Specifies the Y top-left position
+  * @param  width: Rectangle width
+  * @param  height: Rectangle height
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_DrawRect(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    StripRenderer_FillRect(x, y, width, 1, color);
+    StripRenderer_FillRect(x, y + height - 1, width, 1, color);
+    StripRenderer_FillRect(x, y, 1, height, color);
+    StripRenderer_FillRect(x + width - 1, y, 1, height, color);
+}
+
+/**
+  * @brief  Records a horizontal line
+  * @param  x: Specifies the X left position
+  * @param  y: Specifies the Y position
+  * @param  width: Line width
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_DrawHLine(int16_t x, int16_t y, uint16_t width, uint16_t color)
+{
+    StripRenderer_FillRect(x, y, width, 1, color);
+}
+
+/**
+  * @brief  Records a vertical line
+  * @param  x: Specifies the X position
+  * @param  y: Specifies the Y top position
+  * @param  height: Line height
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_DrawVLine(int16_t x, int16_t y, uint16_t height, uint16_t color)
+{
+    StripRenderer_FillRect(x, y, 1, height, color);
+}
+
+/**
+  * @brief  Records a line between two points
+  * @param  x0: Specifies the X position of one end
+  * @param  y0: Specifies the Y position of one end
+  * @param  x1: Specifies the X position of the other end
+  * @param  y1: Specifies the Y position of the other end
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_DrawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+    /* Keep the top end first */
+    if (y0 > y1) {
+        int16_t temp;
+        temp = x0; x0 = x1; x1 = temp;
+        temp = y0; y0 = y1; y1 = temp;
+    }
+
+    StripRenderer_OpTypeDef *op = StripRenderer_AddOp(STRIP_OP_LINE, y0, y1 + 1);
+
+    if (op != NULL) {
+        op->Color = color;
+        op->X0 = x0;
+        op->Y0 = y0;
+        op->X1 = x1;
+        op->Y1 = y1;
+    }
+}
+
+/**
+  * @brief  Records a RGB565 bitmap
+  * @param  x: Specifies the X top-left position
+  * @param  y: Specifies the Y top-left position
+  * @param  width: Bitmap width
+  * @param  height: Bitmap height
+  * @param  pixels: Row major pixels, referenced until StripRenderer_End()
+  * @retval None
+  */
+void StripRenderer_DrawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint16_t *pixels)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    StripRenderer_OpTypeDef *op = StripRenderer_AddOp(STRIP_OP_BITMAP, y, y + height);
+
+    if (op != NULL) {
+        op->X0 = x;
+        op->Y0 = y;
+        op->X1 = x + width;
+        op->Y1 = y + height;
+        op->Data = pixels;
+    }
+}
+
+/**
+  * @brief  Records a curve of one value per column
+  * @note   Values count up from the bottom of the box, like chart data. Each
+  *         column is filled between its value and the next one, values above
+  *         the box are clipped.
+  * @param  x: Specifies the X top-left position of the box
+  * @param  y: Specifies the Y top-left position of the box
+  * @param  width: Number of values
+  * @param  height: Box height
+  * @param  values: Curve values, referenced until StripRenderer_End()
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_DrawCurve(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint16_t *values, uint16_t color)
+{
+    if (width < 2 || height == 0) {
+        return;
+    }
+
+    StripRenderer_OpTypeDef *op = StripRenderer_AddOp(STRIP_OP_CURVE, y, y + height);
+
+    if (op != NULL) {
+        op->Color = color;
+        op->X0 = x;
+        op->Y0 = y;
+        op->X1 = x + width;
+        op->Y1 = y + height;
+        op->Data = values;
+    }
+}
+
+/**
+  * @brief  Records a string of ASCII characters with transparent background
+  * @param  str: String to draw, copied into the display list
+  * @param  font_size: Size of characters (16, 24, 32 or 40)
+  * @param  x: Specifies the X top-left position
+  * @param  y: Specifies the Y top-left position
+  * @param  color: RGB565 format color
+  * @retval None
+  */
+void StripRenderer_DrawString(const uint8_t *str, uint8_t font_size, int16_t x, int16_t y, uint16_t color)
+{
+    size_t length = strlen((const char *)str);
+
+    if (length == 0) {
+        return;
+    }
+    if (s_text_used + length + 1 > STRIP_RENDERER_TEXT_POOL) {
+        s_is_overflowed = 1;
+        return;
+    }
+
+    StripRenderer_OpTypeDef *op = StripRenderer_AddOp(STRIP_OP_TEXT, y, y + font_size);
+
+    if (op != NULL) {
+        memcpy(s_text_pool + s_text_used, str, length + 1);
+        op->Data = s_text_pool + s_text_used;
+        s_text_used += length + 1;
+
+        op->FontSize = font_size;
+        op->Color = color;
+        op->X0 = x;
+        op->Y0 = y;
+        op->X1 = x + length * (font_size / 2);
+        op->Y1 = y + font_size;
+    }
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Appends an op to the display list
+  * @param  type: Op type
+  * @param  top: First row the op covers
+  * @param  bottom: Row after the last one the op covers
+  * @retval The new op, NULL if the list is full or the op misses the area
+  */
+static StripRenderer_OpTypeDef* StripRenderer_AddOp(uint8_t type, int16_t top, int16_t bottom)
+{
+    if (bottom <= 0 || top >= (int16_t)s_height) {
+        return NULL;
+    }
+    if (s_op_count >= STRIP_RENDERER_MAX_OPS) {
+        s_is_overflowed = 1;
+        return NULL;
+    }
+
+    StripRenderer_OpTypeDef *op = &s_ops[s_op_count++];
+    op->Type = type;
+    op->Top = top;
+    op->Bottom = bottom;
+    return op;
+}
+
+/**
+  * @brief  Draws the part of an op that falls into a strip
+  * @param  op: Op to draw
+  * @param  strip: Strip pixels, s_width pixels per row
+  * @param  top: Area row of the first strip row
+  * @param  bottom: Area row after the last strip row
+  * @retval None
+  */
+static void StripRenderer_RasterizeOp(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom)
+{
+    int16_t x0 = (op->X0 > 0) ? op->X0 : 0;
+    int16_t x1 = (op->X1 < (int16_t)s_width) ? op->X1 : s_width;
+    int16_t y0 = (op->Y0 > top) ? op->Y0 : top;
+    int16_t y1 = (op->Y1 < bottom) ? op->Y1 : bottom;
+
+    switch (op->Type)
+    {
+        case STRIP_OP_FILL_RECT:
+            for (int16_t y = y0; y < y1; y++) {
+                uint16_t *row = strip + (y - top) * s_width;
+                for (int16_t x = x0; x < x1; x++) {
+                    row[x] = op->Color;
+                }
+            }
+            break;
+
+        case STRIP_OP_BITMAP:
+            if (x0 >= x1) {
+                break;
+            }
+            for (int16_t y = y0; y < y1; y++) {
+                const uint16_t *src = (const uint16_t *)op->Data + (y - op->Y0) * (op->X1 - op->X0) + (x0 - op->X0);
+                memcpy(strip + (y - top) * s_width + x0, src, (x1 - x0) * 2);
+            }
+            break;
+
+        case STRIP_OP_LINE:
+            StripRenderer_RasterizeLine(op, strip, top, bottom);
+            break;
+
+        case STRIP_OP_CURVE:
+            StripRenderer_RasterizeCurve(op, strip, top, bottom);
+            break;
+
+        case STRIP_OP_TEXT:
+            StripRenderer_RasterizeText(op, strip, top, bottom);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+  * @brief  Draws the part of a line that falls into a strip
+  * @note   Each pixel is computed from the line equation with rounding, so a
+  *         line split over strips has no seams. Steep lines are walked along
+  *         the strip rows only.
+  * @param  op: Line op, Y0 <= Y1
+  * @param  strip: Strip pixels, s_width pixels per row
+  * @param  top: Area row of the first strip row
+  * @param  bottom: Area row after the last strip row
+  * @retval None
+  */
+static void StripRenderer_RasterizeLine(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom)
+{
+    int32_t dx = op->X1 - op->X0;
+    int32_t dy = op->Y1 - op->Y0;
+    int32_t adx = abs(dx);
+
+    if (dy >= adx)
+    {
+        int16_t y0 = (op->Y0 > top) ? op->Y0 : top;
+        int16_t y1 = (op->Y1 < bottom - 1) ? op->Y1 : bottom - 1;
+
+        for (int16_t y = y0; y <= y1; y++)
+        {
+            int32_t x = op->X0;
+            if (dy > 0) {
+                x += ((y - op->Y0) * dx * 2 + (dx >= 0 ? dy : -dy)) / (dy * 2);
+            }
+            if (x >= 0 && x < s_width) {
+                strip[(y - top) * s_width + x] = op->Color;
+            }
+        }
+    }
+    else
+    {
+        int16_t step = (dx > 0) ? 1 : -1;
+
+        for (int32_t t = 0; t <= adx; t++)
+        {
+            int32_t x = op->X0 + t * step;
+            int32_t y = op->Y0 + (t * dy * 2 + adx) / (adx * 2);
+
+            if (y >= bottom) {
+                break;
+            }
+            if (y >= top && x >= 0 && x < s_width) {
+                strip[(y - top) * s_width + x] = op->Color;
+            }
+        }
+    }
+}
+
+/**
+  * @brief  Draws the part of a curve that falls into a strip
+  * @param  op: Curve op
+  * @param  strip: Strip pixels, s_width pixels per row
+  * @param  top: Area row of the first strip row
+  * @param  bottom: Area row after the last strip row
+  * @retval None
+  */
+static void StripRenderer_RasterizeCurve(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom)
+{
+    const uint16_t *values = (const uint16_t *)op->Data;
+    int16_t height = op->Y1 - op->Y0;
+    int16_t count = op->X1 - op->X0;
+
+    for (int16_t i = 0; i < count - 1; i++)
+    {
+        int16_t x = op->X0 + i;
+        uint16_t low, high;
+
+        if (x < 0 || x >= (int16_t)s_width) {
+            continue;
+        }
+
+        if (values[i] < values[i + 1]) {
+            low = values[i];
+            high = values[i + 1];
+        }
+        else {
+            low = values[i + 1];
+            high = values[i];
+        }
+        if (low >= height) {
+            continue;
+        }
+        if (high >= height) {
+            high = height - 1;
+        }
+
+        /* Flip to screen rows and clip to strip */
+        int16_t y0 = op->Y1 - 1 - high;
+        int16_t y1 = op->Y1 - 1 - low;
+        if (y0 < top) {
+            y0 = top;
+        }
+        if (y1 >= bottom) {
+            y1 = bottom - 1;
+        }
+
+        for (int16_t y = y0; y <= y1; y++) {
+            strip[(y - top) * s_width + x] = op->Color;
+        }
+    }
+}
+
+/**
+  * @brief  Draws the part of a string that falls into a strip
+  * @param  op: Text op
+  * @param  strip: Strip pixels, s_width pixels per row
+  * @param  top: Area row of the first strip row
+  * @param  bottom: Area row after the last strip row
+  * @retval None
+  */
+static void StripRenderer_RasterizeText(const StripRenderer_OpTypeDef *op, uint16_t *strip, int16_t top, int16_t bottom)
+{
+    uint8_t font_size = op->FontSize;
+    uint8_t char_width = font_size / 2;
+    uint8_t column_bytes = font_size >> 3;
+    int16_t j0 = (op->Y0 < top) ? top - op->Y0 : 0;
+    int16_t j1 = (op->Y1 > bottom) ? bottom - op->Y0 : font_size;
+    int16_t x = op->X0;
+
+    for (const uint8_t *ch = op->Data; *ch != '\0'; ch++, x += char_width)
+    {
+        const uint8_t *font_buffer = LCD_GetCharASCIIData(*ch, font_size);
+
+        if (font_buffer == NULL || x + char_width <= 0) {
+            continue;
+        }
+        if (x >= (int16_t)s_width) {
+            break;
+        }
+
+        /* Font data is column-major with the LSB on top */
+        for (uint8_t i = 0; i < char_width; i++)
+        {
+            if (x + i < 0 || x + i >= (int16_t)s_width) {
+                continue;
+            }
+            for (int16_t j = j0; j < j1; j++)
+            {
+                if ((font_buffer[i * column_bytes + (j >> 3)] >> (j & 7)) & 1) {
+                    strip[(op->Y0 + j - top) * s_width + x + i] = op->Color;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file       sweep_export.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.8
+  * @brief      Streams sweep results over USB CDC as framed binary packets
+  *
+  * @note       See sweep_export.h for the packet layout. Tools/sweep_receiver
+  *             is the matching host side.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sweep_export.h"
+#include "usbd_cdc_if.h"
+#include "crc32.h"
+
+/* Private Marcos ------------------------------------------------------------*/
+#define HEADER_SIZE         8
+#define CRC_SIZE            4
+#define POINTS_HEADER_SIZE  8
+#define MAX_PAYLOAD_SIZE    (POINTS_HEADER_SIZE + SWEEP_EXPORT_POINTS_PER_PACKET * SWEEP_EXPORT_POINT_SIZE)
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t s_packet[HEADER_SIZE + MAX_PAYLOAD_SIZE + CRC_SIZE];
+static uint16_t s_sequence;
+static uint32_t s_sweep_id;
+static uint32_t s_dropped;
+static uint32_t s_dropped_in_sweep;
+
+/* Points waiting to be sent */
+static uint16_t s_point_index;
+static uint16_t s_first_index;
+static uint8_t s_pending_count;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SendPacket(uint8_t type, uint16_t payload_length);
+static void FlushPoints(void);
+static inline void PutU16(uint8_t *buffer, uint16_t value);
+static inline void PutU32(uint8_t *buffer, uint32_t value);
+static inline int16_t ToFixed(float value);
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Announces a new sweep
+  * @param  info: Sweep settings
+  * @retval None
+  */
+void SweepExport_Begin(const SweepExport_InfoTypeDef *info)
+{
+    uint8_t *payload = s_packet + HEADER_SIZE;
+
+    ++s_sweep_id;
+    s_dropped_in_sweep = 0;
+    s_point_index = 0;
+    s_first_index = 0;
+    s_pending_count = 0;
+
+    PutU32(payload + 0, s_sweep_id);
+    PutU32(payload + 4, info->Start);
+    PutU32(payload + 8, info->Stop);
+    PutU32(payload + 12, info->Step);
+    PutU16(payload + 16, info->Count);
+    PutU16(payload + 18, info->Amplitude);
+    payload[20] = info->Mode;
+    payload[21] = 0;
+
+    SendPacket(SWEEP_PACKET_BEGIN, 22);
+}
+
+/**
+  * @brief  Appends one measured point, sends a packet when a batch is full
+  * @param  freq: Point frequency (Hz)
+  * @param  raw: Raw detector ADC code, 0 if not applicable
+  * @param  gain_db: Normalized gain (dB)
+  * @param  phase_deg: Phase (degree), 0 in magnitude mode
+  * @retval None
+  */
+void SweepExport_AddPoint(uint32_t freq, uint16_t raw, float gain_db, float phase_deg)
+{
+    uint8_t *point = s_packet + HEADER_SIZE + POINTS_HEADER_SIZE
+        + s_pending_count * SWEEP_EXPORT_POINT_SIZE;
+
+    if (s_pending_count == 0) {
+        s_first_index = s_point_index;
+    }
+
+    PutU32(point + 0, freq);
+    PutU16(point + 4, raw);
+    PutU16(point + 6, (uint16_t)ToFixed(gain_db));
+    PutU16(point + 8, (uint16_t)ToFixed(phase_deg));
+
+    ++s_point_index;
+
+    if (++s_pending_count >= SWEEP_EXPORT_POINTS_PER_PACKET) {
+        FlushPoints();
+    }
+}
+
+/**
+  * @brief  Sends the remaining points and closes the sweep
+  * @retval None
+  */
+void SweepExport_End(void)
+{
+    FlushPoints();
+
+    uint8_t *payload = s_packet + HEADER_SIZE;
+
+    PutU32(payload + 0, s_sweep_id);
+    PutU16(payload + 4, s_point_index);
+    PutU16(payload + 6, (s_dropped_in_sweep > 0xFFFF) ? 0xFFFF : (uint16_t)s_dropped_in_sweep);
+
+    SendPacket(SWEEP_PACKET_END, 8);
+}
+
+/**
+  * @brief  Gets total number of packets dropped on a full TX queue
+  * @retval Dropped packets since power on
+  */
+uint32_t SweepExport_GetDroppedCount(void)
+{
+    return s_dropped;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Frames the payload already placed in s_packet and queues it
+  * @param  type: Packet type
+  * @param  payload_length: Payload length in bytes
+  * @retval None
+  */
+static void SendPacket(uint8_t type, uint16_t payload_length)
+{
+    PutU16(s_packet + 0, SWEEP_PACKET_SYNC);
+    s_packet[2] = type;
+    s_packet[3] = 0;
+    PutU16(s_packet + 4, s_sequence++);
+    PutU16(s_packet + 6, payload_length);
+
+    uint16_t length = HEADER_SIZE + payload_length;
+    PutU32(s_packet + length, CRC32_Update(CRC32_INIT_VALUE, s_packet + 2, length - 2));
+    length += CRC_SIZE;
+
+    if (VCP_TransmitAsync(s_packet, length) != length) {
+        ++s_dropped;
+        ++s_dropped_in_sweep;
+    }
+}
+
+/**
+  * @brief  Sends pending points, if any
+  * @retval None
+  */
+static void FlushPoints(void)
+{
+    if (s_pending_count == 0) {
+        return;
+    }
+
+    uint8_t *payload = s_packet + HEADER_SIZE;
+
+    PutU32(payload + 0, s_sweep_id);
+    PutU16(payload + 4, s_first_index);
+    PutU16(payload + 6, s_pending_count);
+
+    SendPacket(SWEEP_PACKET_POINTS, POINTS_HEADER_SIZE + s_pending_count * SWEEP_EXPORT_POINT_SIZE);
+    s_pending_count = 0;
+}
+
+static inline void PutU16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static inline void PutU32(uint8_t *buffer, uint32_t value)
+{
+    PutU16(buffer, (uint16_t)value);
+    PutU16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+/**
+  * @brief  Converts to signed 0.01 units with saturation
+  */
+static inline int16_t ToFixed(float value)
+{
+    value *= 100.0f;
+    value += (value < 0.0f) ? -0.5f : 0.5f;
+    return (value > 32767.0f) ? 32767 : (value < -32768.0f) ? -32768 : (int16_t)value;
+}
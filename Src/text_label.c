@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file       text_label.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.5
+  * @brief      Retained text label UI control
+  *
+  * @note       You need to initialize LCD driver before use this module.
+  *             A label remembers the string last drawn in it, and an update
+  *             only redraws the character cells that changed, without
+  *             clearing the whole field first. Labels are meant for ASCII
+  *             readouts, where every character takes one cell.
+  *             Call TextLabel_Invalidate() after the screen under a label was
+  *             drawn over or its colors were changed.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "text_label.h"
+
+#include <string.h>
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Initializes a text label, nothing is drawn until the first update
+  * @param  label: Pointer to text label struct
+  * @param  x: Top-left corner X position
+  * @param  y: Top-left corner Y position
+  * @param  width: Field width, cleared with bg_color on a full redraw
+  * @param  font_size: Size of characters
+  * @param  color: Text color (RGB565 format)
+  * @param  bg_color: Background color (RGB565 format)
+  * @retval None
+  */
+void TextLabel_Init(TextLabelTypeDef *label, uint16_t x, uint16_t y, uint16_t width, uint8_t font_size,
+                    uint16_t color, uint16_t bg_color)
+{
+    label->X = x;
+    label->Y = y;
+    label->Width = width;
+    label->FontSize = font_size;
+    label->Color = color;
+    label->BgColor = bg_color;
+
+    TextLabel_Invalidate(label);
+}
+
+/**
+  * @brief  Shows a new string in the label
+  * @note   Runs of changed cells are drawn opaque, cells no longer covered by
+  *         the string are cleared. Strings are cut at TEXT_LABEL_MAX_LENGTH.
+  * @param  label: Pointer to text label struct
+  * @param  str: String to be shown
+  * @retval None
+  */
+void TextLabel_Update(TextLabelTypeDef *label, const uint8_t *str)
+{
+    uint8_t length = strnlen((const char *)str, TEXT_LABEL_MAX_LENGTH);
+
+    if (!label->IsValid)
+    {
+        memcpy(label->Text, str, length);
+        label->Text[length] = '\0';
+        label->Length = length;
+        label->IsValid = 1;
+
+        LCD_DrawStringOpaque(label->Text, label->FontSize, label->X, label->Y, label->Width, label->Color, label->BgColor);
+        return;
+    }
+
+    uint8_t char_width = label->FontSize / 2;
+    uint8_t cell_count = (length > label->Length) ? length : label->Length;
+    uint8_t run[TEXT_LABEL_MAX_LENGTH + 1];
+    uint8_t i = 0;
+
+    while (i < cell_count)
+    {
+        if (TextLabel_GetCell(str, length, i) == TextLabel_GetCell(label->Text, label->Length, i)) {
+            i++;
+            continue;
+        }
+
+        /* Collect a run of changed cells, cleared cells become spaces */
+        uint8_t start = i;
+        uint8_t n = 0;
+
+        while (i < cell_count && TextLabel_GetCell(str, length, i) != TextLabel_GetCell(label->Text, label->Length, i)) {
+            run[n++] = TextLabel_GetCell(str, length, i++);
+        }
+        run[n] = '\0';
+
+        LCD_DrawStringOpaque(run, label->FontSize, label->X + start * char_width, label->Y, 0, label->Color, label->BgColor);
+    }
+
+    memcpy(label->Text, str, length);
+    label->Text[length] = '\0';
+    label->Length = length;
+}
+
+/**
+  * @brief  Forces the whole field to be redrawn on next update
+  * @param  label: Pointer to text label struct
+  * @retval None
+  */
+void TextLabel_Invalidate(TextLabelTypeDef *label)
+{
+    label->Text[0] = '\0';
+    label->Length = 0;
+    label->IsValid = 0;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Gets the character shown in a cell
+  * @param  str: String of the label
+  * @param  length: Length of the string
+  * @param  i: Cell index
+  * @retval Character, a space past the end of the string
+  */
+static inline uint8_t TextLabel_GetCell(const uint8_t *str, uint8_t length, uint8_t i)
+{
+    return (i < length) ? str[i] : ' ';
+}
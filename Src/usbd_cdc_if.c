@@ -6,9 +6,10 @@ static uint8_t s_vcp_rx_packet_buffer[USB_FS_MAX_PACKET_SIZE];
 
 static uint8_t s_vcp_rx_buffer[VCP_RX_BUFFER_SIZE];
 static uint8_t s_vcp_tx_buffer[VCP_TX_BUFFER_SIZE];
+static uint8_t s_vcp_tx_packet_buffer[VCP_TX_PACKET_SIZE];
 
 RingBufferTypeDef s_vcp_rx_fifo;
-//VCP_RingBufferTypeDef s_txbuffer;
+RingBufferTypeDef s_vcp_tx_fifo;
 
 USBD_CDC_LineCodingTypeDef s_linecoding = {
     .bitrate = 115200,      //baud rate
@@ -44,16 +45,21 @@ size_t VCP_Transmit(const uint8_t* buffer, size_t length)
 
     uint32_t tick_start = HAL_GetTick();
 
-    while (hcdc->TxState != 0) {
+    for (;;) {
+        /* The SOF interrupt may start a queued transfer at any time */
+        __disable_irq();
+        if (hcdc->TxState == 0) {
+            USBD_CDC_SetTxBuffer(&hUsbDeviceFS, buffer, length);
+            USBD_CDC_TransmitPacket(&hUsbDeviceFS);
+            __enable_irq();
+            return length;
+        }
+        __enable_irq();
+
         if (HAL_GetTick() - tick_start > VCP_TIMEOUT) {
             return 0;
         }
     }
-
-    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, buffer, length);
-    USBD_CDC_TransmitPacket(&hUsbDeviceFS);
-
-    return length;
 }
 
 size_t VCP_Recieve(uint8_t* buffer, size_t length)
@@ -61,6 +67,54 @@ size_t VCP_Recieve(uint8_t* buffer, size_t length)
     return RingBuffer_ReadBytes(&s_vcp_rx_fifo, buffer, length);
 }
 
+/**
+  * @brief  Queues data for transmission without waiting for the host
+  * @note   Data is queued all-or-nothing so framed packets are never split.
+  *         Nothing is queued while the device is not configured. The queue
+  *         is drained by VCP_PollTransmit() from the SOF interrupt, so this
+  *         is the only producer and the interrupt the only consumer.
+  * @param  buffer: Data to send
+  * @param  length: Number of bytes
+  * @retval Number of bytes queued, 0 if the queue is full
+  */
+size_t VCP_TransmitAsync(const uint8_t* buffer, size_t length)
+{
+    if (hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED || VCP_GetTxFreeSpace() < length) {
+        return 0;
+    }
+
+    return RingBuffer_WriteBytes(&s_vcp_tx_fifo, buffer, length);
+}
+
+/**
+  * @brief  Gets free space of the TX queue
+  * @retval Number of bytes that can be queued
+  */
+size_t VCP_GetTxFreeSpace(void)
+{
+    return s_vcp_tx_fifo.Capacity - RingBuffer_GetBytesCount(&s_vcp_tx_fifo);
+}
+
+/**
+  * @brief  Starts the next IN transfer from the TX queue if the endpoint is idle
+  * @note   Called every 1ms from HAL_PCD_SOFCallback()
+  * @retval None
+  */
+void VCP_PollTransmit(void)
+{
+    USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+
+    if (hcdc == NULL || hcdc->TxState != 0 || s_vcp_tx_fifo.Capacity == 0) {
+        return;
+    }
+
+    size_t length = RingBuffer_ReadBytes(&s_vcp_tx_fifo, s_vcp_tx_packet_buffer, VCP_TX_PACKET_SIZE);
+
+    if (length > 0) {
+        CDC_Transmit_FS(s_vcp_tx_packet_buffer, length);
+    }
+}
+
 /* Private functions ---------------------------------------------------------*/
 /**
   * @brief  Initializes the CDC media low layer over the FS USB IP
@@ -73,6 +127,7 @@ static int8_t CDC_Init_FS(void)
     USBD_CDC_ReceivePacket(&hUsbDeviceFS);
 
     RingBuffer_Init(&s_vcp_rx_fifo, s_vcp_rx_buffer, VCP_RX_BUFFER_SIZE);
+    RingBuffer_Init(&s_vcp_tx_fifo, s_vcp_tx_buffer, VCP_TX_BUFFER_SIZE);
     return (USBD_OK);
 }
 
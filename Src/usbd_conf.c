@@ -73,7 +73,7 @@ extern void Error_Handler(void);
 extern void SystemClock_Config(void);
 
 /* USER CODE BEGIN 0 */
-
+extern void VCP_PollTransmit(void);
 /* USER CODE END 0 */
 
 /* USER CODE BEGIN PFP */
@@ -203,6 +203,8 @@ void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 {
     USBD_LL_SOF((USBD_HandleTypeDef*)hpcd->pData);
+    /* Drain the VCP TX queue once per frame */
+    VCP_PollTransmit();
 }
 
 /**
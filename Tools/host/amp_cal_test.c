@@ -0,0 +1,356 @@
+/**
+  ******************************************************************************
+  * @file       amp_cal_test.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Host tests for the amplitude calibration store (amp_calibration.c)
+  *
+  * @note       Build and run:  make -C Tools/host test
+  *
+  *             Covers the flash image format (layout, CRC, rejection of
+  *             damaged or inconsistent images, save / load through a RAM
+  *             model of the W25Qxx) and the lookup interpolation across
+  *             levels and between bands. Output amplitudes are checked with
+  *             the same chain model the table describes:
+  *             amp = code * 10^(-att / 40) * gain.
+  ******************************************************************************
+  */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "amp_calibration.h"
+#include "crc32.h"
+
+#define FLASH_SIZE          0x200000U       //W25Q16
+#define FLASH_SECTOR_SIZE   0x1000U
+
+static uint8_t flash[FLASH_SIZE];
+static int failures;
+
+#define CHECK(COND) do { \
+        if (!(COND)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            ++failures; \
+        } \
+    } while (0)
+
+/* W25Qxx model, NOR semantics: erase sets bits, programming only clears them */
+void W25QXX_Read(uint32_t addr, uint8_t *buffer, uint32_t count)
+{
+    memcpy(buffer, flash + addr, count);
+}
+
+void W25QXX_Write(uint32_t addr, uint8_t *buffer, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        flash[addr + i] &= buffer[i];
+    }
+}
+
+void W25QXX_SectorErase(uint32_t addr)
+{
+    memset(flash + (addr & ~(FLASH_SECTOR_SIZE - 1)), 0xFF, FLASH_SECTOR_SIZE);
+}
+
+static float level_mv(uint8_t level)
+{
+    return AMP_CAL_MAX_LEVEL - AMP_CAL_LEVEL_STEP * level;
+}
+
+static float att_linear(uint8_t att)
+{
+    return powf(10.0f, -att / 40.0f);
+}
+
+/* Output per unit of DDS code at 0dB attenuation, as stored at one level */
+static float entry_gain(uint16_t entry, uint8_t level)
+{
+    return level_mv(level) / (AMP_CAL_ENTRY_CODE(entry) * att_linear(AMP_CAL_ENTRY_ATT(entry)));
+}
+
+/* Chain gain the lookup should use for an amplitude within one band */
+static float band_gain(const AmpCal_BandTypeDef *band, float amp_mv)
+{
+    float pos = (AMP_CAL_MAX_LEVEL - amp_mv) / AMP_CAL_LEVEL_STEP;
+    uint8_t level = (uint8_t)pos;
+    float t = pos - level;
+
+    if (level >= AMP_CAL_LEVEL_COUNT - 1) {
+        level = AMP_CAL_LEVEL_COUNT - 2;
+        t = 1.0f;
+    }
+    return entry_gain(band->Entries[level], level) * (1.0f - t)
+        + entry_gain(band->Entries[level + 1], level + 1) * t;
+}
+
+/* Checks that a looked up setting reproduces amp_mv with the expected gain */
+static void check_output(uint32_t freq, float amp_mv, float gain)
+{
+    uint8_t att;
+    uint16_t code;
+
+    AmpCal_Lookup(freq, amp_mv, &att, &code);
+
+    float out = code * att_linear(att) * gain;
+
+    /* Code is rounded, so the error is at most half a code step */
+    if (fabsf(out - amp_mv) > 0.5f * att_linear(att) * gain + 1e-3f) {
+        printf("freq %u kHz, %.2f mV: att %u code %u gives %.3f mV\n", freq, amp_mv, att, code, out);
+        ++failures;
+    }
+}
+
+static int same_bands(const AmpCal_TableTypeDef *a, const AmpCal_TableTypeDef *b)
+{
+    if (a->BandCount != b->BandCount) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < a->BandCount; i++) {
+        if (a->Bands[i].Frequency != b->Bands[i].Frequency
+            || memcmp(a->Bands[i].Entries, b->Bands[i].Entries, sizeof(a->Bands[i].Entries)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void test_crc32(void)
+{
+    CHECK(CRC32_Update(CRC32_INIT_VALUE, (const uint8_t *)"123456789", 9) == 0xCBF43926U);
+}
+
+static void make_table(AmpCal_TableTypeDef *table)
+{
+    AmpCal_LoadDefaults(table);
+    table->BandCount = 3;
+    table->Bands[1] = table->Bands[0];
+    table->Bands[2] = table->Bands[0];
+    table->Bands[0].Frequency = 1000;
+    table->Bands[1].Frequency = 20000;
+    table->Bands[2].Frequency = 150000;
+    table->Bands[2].Entries[7] = AMP_CAL_ENTRY(5, 0x3AB);
+}
+
+static void test_serialize_layout(void)
+{
+    AmpCal_TableTypeDef table;
+    uint8_t image[AMP_CAL_IMAGE_MAX_SIZE];
+
+    make_table(&table);
+    uint32_t size = AmpCal_Serialize(&table, image, sizeof(image));
+    uint32_t payload = 3 * AMP_CAL_BAND_SIZE;
+
+    CHECK(size == AMP_CAL_HEADER_SIZE + payload);
+    CHECK(memcmp(image, "ACAL", 4) == 0);
+    CHECK(image[4] == AMP_CAL_VERSION && image[5] == 0);
+    CHECK(image[6] == 3);
+    CHECK(image[7] == AMP_CAL_LEVEL_COUNT);
+    CHECK((image[8] | (image[9] << 8) | (image[10] << 16) | ((uint32_t)image[11] << 24)) == payload);
+    CHECK((image[12] | (image[13] << 8) | (image[14] << 16) | ((uint32_t)image[15] << 24))
+        == CRC32_Update(CRC32_INIT_VALUE, image + AMP_CAL_HEADER_SIZE, payload));
+
+    /* Band 2 frequency 150000 = 0x000249F0, then level 7 entry little-endian */
+    const uint8_t *band2 = image + AMP_CAL_HEADER_SIZE + 2 * AMP_CAL_BAND_SIZE;
+    CHECK(band2[0] == 0xF0 && band2[1] == 0x49 && band2[2] == 0x02 && band2[3] == 0x00);
+    CHECK(band2[4 + 2 * 7] == 0xAB && band2[5 + 2 * 7] == (5 << 2 | 0x03));
+
+    /* Too small a buffer or an empty table gives no image */
+    CHECK(AmpCal_Serialize(&table, image, size - 1) == 0);
+    table.BandCount = 0;
+    CHECK(AmpCal_Serialize(&table, image, sizeof(image)) == 0);
+}
+
+static void test_deserialize(void)
+{
+    AmpCal_TableTypeDef table, loaded;
+    uint8_t image[AMP_CAL_IMAGE_MAX_SIZE];
+    uint8_t damaged[AMP_CAL_IMAGE_MAX_SIZE];
+
+    make_table(&table);
+    uint32_t size = AmpCal_Serialize(&table, image, sizeof(image));
+
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(AmpCal_Deserialize(&loaded, image, size) == HAL_OK);
+    CHECK(same_bands(&loaded, &table));
+
+    /* Every single payload bit flip is caught by the CRC */
+    for (uint32_t i = AMP_CAL_HEADER_SIZE; i < size; i++) {
+        memcpy(damaged, image, size);
+        damaged[i] ^= 0x10;
+        CHECK(AmpCal_Deserialize(&loaded, damaged, size) == HAL_ERROR);
+    }
+
+    /* Header fields */
+    memcpy(damaged, image, size);
+    damaged[0] = 'X';
+    CHECK(AmpCal_Deserialize(&loaded, damaged, size) == HAL_ERROR);
+    memcpy(damaged, image, size);
+    damaged[4] = AMP_CAL_VERSION + 1;
+    CHECK(AmpCal_Deserialize(&loaded, damaged, size) == HAL_ERROR);
+    memcpy(damaged, image, size);
+    damaged[6] = 2;
+    CHECK(AmpCal_Deserialize(&loaded, damaged, size) == HAL_ERROR);
+    memcpy(damaged, image, size);
+    damaged[7] = AMP_CAL_LEVEL_COUNT - 1;
+    CHECK(AmpCal_Deserialize(&loaded, damaged, size) == HAL_ERROR);
+    CHECK(AmpCal_Deserialize(&loaded, image, size - 1) == HAL_ERROR);
+    CHECK(AmpCal_Deserialize(&loaded, image, AMP_CAL_HEADER_SIZE - 1) == HAL_ERROR);
+
+    /* Erased flash */
+    memset(damaged, 0xFF, sizeof(damaged));
+    CHECK(AmpCal_Deserialize(&loaded, damaged, sizeof(damaged)) == HAL_ERROR);
+
+    /* Bands out of order are refused even with a valid CRC */
+    table.Bands[2].Frequency = 15000;
+    size = AmpCal_Serialize(&table, image, sizeof(image));
+    loaded.BandCount = 0;
+    CHECK(AmpCal_Deserialize(&loaded, image, size) == HAL_ERROR);
+    CHECK(loaded.BandCount == 0);
+}
+
+static void test_save_load(void)
+{
+    AmpCal_TableTypeDef *table = AmpCal_GetTable();
+    AmpCal_TableTypeDef saved;
+
+    /* Blank flash falls back to the factory band */
+    memset(flash, 0xFF, sizeof(flash));
+    AmpCal_Init();
+    CHECK(table->BandCount == 1 && table->Bands[0].Frequency == 20000);
+    CHECK(AmpCal_Load() == HAL_ERROR);
+
+    make_table(table);
+    saved = *table;
+    CHECK(AmpCal_Save() == HAL_OK);
+
+    AmpCal_LoadDefaults(table);
+    CHECK(AmpCal_Load() == HAL_OK);
+    CHECK(same_bands(table, &saved));
+
+    /* Saving again over a programmed sector must erase it first */
+    table->Bands[1].Entries[0] = AMP_CAL_ENTRY(1, 1);
+    saved = *table;
+    CHECK(AmpCal_Save() == HAL_OK);
+    AmpCal_Init();
+    CHECK(same_bands(table, &saved));
+}
+
+static void test_set_band(void)
+{
+    AmpCal_TableTypeDef *table = AmpCal_GetTable();
+    uint16_t entries[AMP_CAL_LEVEL_COUNT];
+
+    AmpCal_LoadDefaults(table);
+    memcpy(entries, table->Bands[0].Entries, sizeof(entries));
+
+    /* Inserted in frequency order */
+    CHECK(AmpCal_SetBand(80000, entries) == HAL_OK);
+    CHECK(AmpCal_SetBand(5000, entries) == HAL_OK);
+    CHECK(table->BandCount == 3);
+    CHECK(table->Bands[0].Frequency == 5000);
+    CHECK(table->Bands[1].Frequency == 20000);
+    CHECK(table->Bands[2].Frequency == 80000);
+
+    /* Same frequency replaces */
+    entries[3] = AMP_CAL_ENTRY(2, 3);
+    CHECK(AmpCal_SetBand(20000, entries) == HAL_OK);
+    CHECK(table->BandCount == 3 && table->Bands[1].Entries[3] == AMP_CAL_ENTRY(2, 3));
+
+    /* Full table refuses new bands but still accepts replacements */
+    for (uint32_t freq = 1000; table->BandCount < AMP_CAL_MAX_BANDS; freq += 1000) {
+        CHECK(AmpCal_SetBand(freq, entries) == HAL_OK);
+    }
+    CHECK(AmpCal_SetBand(190000, entries) == HAL_ERROR);
+    CHECK(AmpCal_SetBand(80000, entries) == HAL_OK);
+    CHECK(table->BandCount == AMP_CAL_MAX_BANDS);
+
+    for (uint8_t i = 1; i < table->BandCount; i++) {
+        CHECK(table->Bands[i].Frequency > table->Bands[i - 1].Frequency);
+    }
+}
+
+static void test_lookup_levels(void)
+{
+    AmpCal_TableTypeDef *table = AmpCal_GetTable();
+    const AmpCal_BandTypeDef *band = &table->Bands[0];
+    uint8_t att;
+    uint16_t code;
+
+    AmpCal_LoadDefaults(table);
+
+    /* Calibrated levels give back the stored entries at any frequency */
+    for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+        AmpCal_Lookup(20000, level_mv(i), &att, &code);
+        CHECK(att == AMP_CAL_ENTRY_ATT(band->Entries[i]) && code == AMP_CAL_ENTRY_CODE(band->Entries[i]));
+        AmpCal_Lookup(150000, level_mv(i), &att, &code);
+        CHECK(att == AMP_CAL_ENTRY_ATT(band->Entries[i]) && code == AMP_CAL_ENTRY_CODE(band->Entries[i]));
+    }
+
+    /* In between, gain is interpolated and the output is continuous */
+    for (float amp = 4.0f; amp <= 100.0f; amp += 0.25f) {
+        check_output(20000, amp, band_gain(band, amp));
+    }
+
+    /* Out of range amplitudes clamp to the end levels' gain */
+    check_output(20000, 2.0f, band_gain(band, 4.0f));
+    check_output(20000, 104.0f, band_gain(band, 100.0f));
+}
+
+static void test_lookup_bands(void)
+{
+    AmpCal_TableTypeDef *table = AmpCal_GetTable();
+    uint16_t entries[AMP_CAL_LEVEL_COUNT];
+
+    /* Second band needs 6dB less attenuation for the same output */
+    AmpCal_LoadDefaults(table);
+    table->Bands[0].Frequency = 10000;
+    for (uint8_t i = 0; i < AMP_CAL_LEVEL_COUNT; i++) {
+        uint16_t entry = table->Bands[0].Entries[i];
+        uint8_t att = AMP_CAL_ENTRY_ATT(entry);
+        entries[i] = AMP_CAL_ENTRY(att >= 12 ? att - 12 : 0, AMP_CAL_ENTRY_CODE(entry));
+    }
+    CHECK(AmpCal_SetBand(30000, entries) == HAL_OK);
+
+    const AmpCal_BandTypeDef *low = &table->Bands[0];
+    const AmpCal_BandTypeDef *high = &table->Bands[1];
+
+    for (float amp = 4.0f; amp <= 100.0f; amp += 1.5f)
+    {
+        float g0 = band_gain(low, amp);
+        float g1 = band_gain(high, amp);
+
+        /* Outside the bands the nearest band holds */
+        check_output(1000, amp, g0);
+        check_output(10000, amp, g0);
+        check_output(30000, amp, g1);
+        check_output(200000, amp, g1);
+
+        /* Linear in frequency between them */
+        check_output(15000, amp, g0 + (g1 - g0) * 0.25f);
+        check_output(20000, amp, g0 + (g1 - g0) * 0.5f);
+        check_output(27500, amp, g0 + (g1 - g0) * 0.875f);
+    }
+}
+
+int main(void)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    AmpCal_Init();
+
+    test_crc32();
+    test_serialize_layout();
+    test_deserialize();
+    test_save_load();
+    test_set_band();
+    test_lookup_levels();
+    test_lookup_bands();
+
+    if (failures) {
+        printf("amp_cal_test: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("amp_cal_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * @file       bmp_test.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Host tests for LCD_SaveBmpToFile() on the simulated panel
+  *
+  * @note       Build and run:  make -C Tools/host test
+  *
+  *             A known pattern is drawn on the simulated NT35510, saved
+  *             through the GRAM read back path (READ_LINE), and the file is
+  *             decoded again byte by byte, without the BMP types of lcd.h.
+  *             Checks the file and info header fields, the BI_BITFIELDS
+  *             RGB565 masks, zeroed row padding for odd widths and bottom-up
+  *             row order against the simulator's GRAM.
+  *             A chart is also saved with CurveChart_SaveBmpToFile(), which
+  *             must not read GRAM back when the chart has a framebuffer.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lcd_sim.h"
+#include "lcd.h"
+#include "curve_chart.h"
+#include "colors.h"
+
+#define BMP_PATH            "build/bmp_test.bmp"
+#define PATTERN_X           100
+#define PATTERN_Y           60
+#define PATTERN_WIDTH       64
+#define PATTERN_HEIGHT      40
+
+static uint16_t pattern[PATTERN_WIDTH * PATTERN_HEIGHT];
+static uint8_t file_data[256 * 1024];
+static int failures;
+
+#define CHECK(COND) do { \
+        if (!(COND)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            ++failures; \
+        } \
+    } while (0)
+
+static uint32_t read_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Every pixel differs from its neighbours in all three channels */
+static void draw_pattern(void)
+{
+    for (uint16_t y = 0; y < PATTERN_HEIGHT; y++) {
+        for (uint16_t x = 0; x < PATTERN_WIDTH; x++) {
+            pattern[y * PATTERN_WIDTH + x] = (uint16_t)((x * 0x0841 + y * 0x1863) ^ (x << 11) ^ y);
+        }
+    }
+
+    LCD_Clear(0x0000);
+    LCD_DrawBitmapStream(pattern, PATTERN_X, PATTERN_Y, PATTERN_WIDTH, PATTERN_HEIGHT);
+    LCDSim_RunDma();
+}
+
+static size_t load_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    size_t size;
+
+    if (file == NULL) {
+        return 0;
+    }
+    size = fread(file_data, 1, sizeof(file_data), file);
+    fclose(file);
+    return size;
+}
+
+/* Decodes the saved file again and compares it with a GRAM area */
+static void check_bmp_file(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    uint32_t stride = (width * 2 + 3) / 4 * 4;
+    size_t size;
+
+    size = load_file(BMP_PATH);
+    CHECK(size == 66 + stride * height);
+    if (size < 66) {
+        return;
+    }
+
+    /* BITMAPFILEHEADER */
+    CHECK(file_data[0] == 'B' && file_data[1] == 'M');
+    CHECK(read_le32(file_data + 2) == size);
+    CHECK(read_le32(file_data + 6) == 0);
+    CHECK(read_le32(file_data + 10) == 66);
+
+    /* BITMAPINFOHEADER, positive height means bottom-up rows */
+    CHECK(read_le32(file_data + 14) == 40);
+    CHECK(read_le32(file_data + 18) == width);
+    CHECK(read_le32(file_data + 22) == height);
+    CHECK(read_le16(file_data + 26) == 1);
+    CHECK(read_le16(file_data + 28) == 16);
+    CHECK(read_le32(file_data + 30) == 3);
+    CHECK(read_le32(file_data + 34) == stride * height);
+
+    /* BI_BITFIELDS masks right after the info header */
+    CHECK(read_le32(file_data + 54) == 0xF800);
+    CHECK(read_le32(file_data + 58) == 0x07E0);
+    CHECK(read_le32(file_data + 62) == 0x001F);
+
+    if (size != 66 + stride * height) {
+        return;
+    }
+
+    uint32_t pixel_errors = 0, padding_errors = 0;
+
+    for (uint16_t row = 0; row < height; row++)
+    {
+        const uint8_t *line = file_data + 66 + stride * (height - 1 - row);
+
+        for (uint16_t j = 0; j < width; j++) {
+            if (read_le16(line + j * 2) != LCDSim_GetPixel(x + j, y + row)) {
+                ++pixel_errors;
+            }
+        }
+        for (uint32_t j = width * 2; j < stride; j++) {
+            if (line[j] != 0) {
+                ++padding_errors;
+            }
+        }
+    }
+    CHECK(pixel_errors == 0);
+    CHECK(padding_errors == 0);
+}
+
+static void check_saved_area(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    CHECK(LCD_SaveBmpToFile((const uint8_t *)BMP_PATH, x, y, width, height) == HAL_OK);
+    check_bmp_file(x, y, width, height);
+}
+
+static void test_even_width(void)
+{
+    check_saved_area(PATTERN_X, PATTERN_Y, PATTERN_WIDTH, PATTERN_HEIGHT);
+}
+
+static void test_odd_width(void)
+{
+    /* Row of 2 mod 4 bytes, crossing the pattern's edge into background */
+    check_saved_area(PATTERN_X + 3, PATTERN_Y - 2, 37, 23);
+    check_saved_area(PATTERN_X, PATTERN_Y, 1, 1);
+}
+
+static void test_screen_corner(void)
+{
+    check_saved_area(LCDSim_GetWidth() - 51, LCDSim_GetHeight() - 9, 51, 9);
+}
+
+static void test_chart_area(void)
+{
+    static uint16_t values[301];
+    CurveChartTypeDef chart = {
+        .X = 120, .Y = 140, .Width = 301, .Height = 120,
+        .CoarseGridWidth = 50, .CoarseGridHeight = 30, .FineGridWidth = 10, .FineGridHeight = 10,
+        .BorderColor = WHITE, .BackgroudColor = BLACK, .CoarseGridColor = GRAY, .FineGridColor = DARKGRAY,
+    };
+    LCDSim_StatsTypeDef stats;
+
+    LCD_Clear(0x0000);
+    CurveChart_Init(&chart);
+    for (uint16_t i = 0; i < chart.Width; i++) {
+        values[i] = (i * 7) % chart.Height;
+    }
+    CurveChart_DrawCurve(&chart, values, RED);
+    CurveChart_DrawDashedLineX(&chart, 150, YELLOW);
+#if CHART_USE_FRAMEBUFFER
+    CurveChart_FrameUpdate();
+#endif // CHART_USE_FRAMEBUFFER
+    LCDSim_RunDma();
+
+    LCDSim_ResetStats();
+    CHECK(CurveChart_SaveBmpToFile(&chart, (const uint8_t *)BMP_PATH) == HAL_OK);
+    LCDSim_GetStats(&stats);
+#if CHART_USE_FRAMEBUFFER || CHART_USE_SHADOW
+    CHECK(stats.DataReads == 0);
+#endif
+
+    check_bmp_file(chart.X, chart.Y, chart.Width, chart.Height);
+}
+
+static void test_rejects_bad_area(void)
+{
+    CHECK(LCD_SaveBmpToFile((const uint8_t *)BMP_PATH, 0, 0, 0, 10) == HAL_ERROR);
+    CHECK(LCD_SaveBmpToFile((const uint8_t *)BMP_PATH, LCDSim_GetWidth() - 10, 0, 11, 10) == HAL_ERROR);
+    CHECK(LCD_SaveBmpToFile((const uint8_t *)"build/no_such_dir/x.bmp", 0, 0, 10, 10) == HAL_ERROR);
+}
+
+int main(void)
+{
+    LCDSim_Init();
+    LCD_Init(LCD_ORIENTATION_90_DEGREE);
+    draw_pattern();
+
+    test_even_width();
+    test_odd_width();
+    test_screen_corner();
+    test_chart_area();
+    test_rejects_bad_area();
+
+    remove(BMP_PATH);
+
+    if (failures) {
+        printf("bmp_test: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("bmp_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file       ff_host.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      FatFs file calls on host files, see stubs/ff.h
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ff.h"
+
+#include <stdio.h>
+
+/* Public Function Definitions -----------------------------------------------*/
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+    const char *host_mode = "rb";
+
+    if (mode & (FA_CREATE_ALWAYS | FA_CREATE_NEW)) {
+        host_mode = (mode & FA_READ) ? "w+b" : "wb";
+    }
+    else if (mode & FA_WRITE) {
+        host_mode = "r+b";
+    }
+
+    fp->HostFile = fopen(path, host_mode);
+    return (fp->HostFile != NULL) ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_close(FIL *fp)
+{
+    FRESULT result = (fclose(fp->HostFile) == 0) ? FR_OK : FR_DISK_ERR;
+
+    fp->HostFile = NULL;
+    return result;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+    *br = fread(buff, 1, btr, fp->HostFile);
+    return ferror(fp->HostFile) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    *bw = fwrite(buff, 1, btw, fp->HostFile);
+    return (*bw == btw) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    return (fseek(fp->HostFile, ofs, SEEK_SET) == 0) ? FR_OK : FR_DISK_ERR;
+}
@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file       jpeg_arena_bench.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Peak LibJPEG arena use of encoding and decoding on the host
+  *
+  * @note       Build:  make -C Tools/host jpeg_arena_bench
+  *             Usage:  ./jpeg_arena_bench [jpeg directory]
+  *
+  *             The vendored LibJPEG is built with jmemsram.c and
+  *             JPEG_ARENA_HOST, so the arena is a static array of
+  *             JPEG_ARENA_SIZE and the statistics are the ones the target
+  *             would see. Synthetic images are encoded as baseline 4:2:0
+  *             JPEG files, then decoded with the settings of
+  *             LCD_DrawJpegFromFile() at full and 1/8 scale.
+  *             Exits with 1 if a decode does not fit in the arena.
+  ******************************************************************************
+  */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "jpeglib.h"
+#include "jmemsram.h"
+
+#define JPEG_QUALITY        85
+
+typedef struct
+{
+    struct jpeg_error_mgr Pub;
+    jmp_buf JumpBuffer;
+
+} BenchErrorTypeDef;
+
+static const uint16_t s_sizes[][2] = { { 320, 240 }, { 640, 480 }, { 800, 480 } };
+
+static void bench_error_exit(j_common_ptr cinfo)
+{
+    longjmp(((BenchErrorTypeDef *)cinfo->err)->JumpBuffer, 1);
+}
+
+static void bench_output_message(j_common_ptr cinfo)
+{
+    (void)cinfo;
+}
+
+/* Smooth gradients with sharp stripes, so every MCU has some detail */
+static void fill_scanline(JSAMPLE *line, uint16_t width, uint16_t row)
+{
+    for (uint16_t x = 0; x < width; x++, line += 3) {
+        line[0] = (JSAMPLE)(x * 255 / width);
+        line[1] = (JSAMPLE)(row * 255 / 480);
+        line[2] = ((x / 8 + row / 8) & 1) ? 220 : 40;
+    }
+}
+
+static void print_stats(uint16_t width, uint16_t height, const char *mode)
+{
+    JpegArena_StatsTypeDef stats;
+
+    JpegArena_GetStats(&stats);
+    printf("%4ux%-4u %-12s %10u %12u\n", width, height, mode, stats.Peak, stats.Allocations);
+}
+
+static int encode_image(const char *path, uint16_t width, uint16_t height)
+{
+    static struct jpeg_compress_struct cinfo;
+    static BenchErrorTypeDef jerr;
+    static JSAMPLE line[800 * 3];
+    JSAMPROW row_pointer = line;
+    FIL file;
+
+    if (f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        fprintf(stderr, "Can't write %s\n", path);
+        return -1;
+    }
+
+    cinfo.err = jpeg_std_error(&jerr.Pub);
+    jerr.Pub.error_exit = bench_error_exit;
+    jerr.Pub.output_message = bench_output_message;
+
+    if (setjmp(jerr.JumpBuffer)) {
+        jpeg_destroy_compress(&cinfo);
+        f_close(&file);
+        print_stats(width, height, "encode fail");
+        return -1;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, &file);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, JPEG_QUALITY, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < height) {
+        fill_scanline(line, width, cinfo.next_scanline);
+        jpeg_write_scanlines(&cinfo, &row_pointer, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    f_close(&file);
+
+    print_stats(width, height, "encode");
+    return 0;
+}
+
+/* Same decoder setup as LCD_DrawJpegFromFile() */
+static int decode_image(const char *path, uint16_t width, uint16_t height, uint8_t scale_denom)
+{
+    static struct jpeg_decompress_struct cinfo;
+    static BenchErrorTypeDef jerr;
+    JSAMPARRAY scanline;
+    char mode[16];
+    FIL file;
+
+    snprintf(mode, sizeof(mode), "decode 1/%u", scale_denom);
+
+    if (f_open(&file, path, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        fprintf(stderr, "Can't read %s\n", path);
+        return -1;
+    }
+
+    cinfo.err = jpeg_std_error(&jerr.Pub);
+    jerr.Pub.error_exit = bench_error_exit;
+    jerr.Pub.output_message = bench_output_message;
+
+    if (setjmp(jerr.JumpBuffer)) {
+        jpeg_destroy_decompress(&cinfo);
+        f_close(&file);
+        printf("%4ux%-4u %-12s %10s\n", width, height, mode, "failed");
+        return -1;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, &file);
+    jpeg_read_header(&cinfo, TRUE);
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale_denom;
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.do_block_smoothing = FALSE;
+
+    jpeg_start_decompress(&cinfo);
+    scanline = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, cinfo.output_width * 3, 1);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        jpeg_read_scanlines(&cinfo, scanline, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    f_close(&file);
+
+    print_stats(width, height, mode);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = (argc > 1) ? argv[1] : ".";
+    int result = 0;
+
+    printf("arena: %u bytes, quality %u\n", JPEG_ARENA_SIZE, JPEG_QUALITY);
+    printf("%-9s %-12s %10s %12s\n", "image", "mode", "peak", "allocations");
+
+    for (uint8_t i = 0; i < sizeof(s_sizes) / sizeof(s_sizes[0]); i++)
+    {
+        uint16_t width = s_sizes[i][0], height = s_sizes[i][1];
+        char path[256];
+
+        snprintf(path, sizeof(path), "%s/%ux%u.jpg", dir, width, height);
+
+        if (encode_image(path, width, height) != 0) {
+            result = 1;
+            continue;
+        }
+        if (decode_image(path, width, height, 1) != 0 || decode_image(path, width, height, 8) != 0) {
+            result = 1;
+        }
+    }
+
+    return result;
+}
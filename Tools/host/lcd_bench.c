@@ -0,0 +1,563 @@
+/**
+  ******************************************************************************
+  * @file       lcd_bench.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      LCD bus benchmark, runs the app draw loops on the simulated panel
+  *
+  * @note       Build:  make -C Tools/host bench
+  *             Usage:  lcd_bench [frames] [ppm prefix]
+  *
+  *             Each scene repeats one app's per-frame drawing (chart layout,
+  *             colors and calls as in oscilloscope.c and spectrum.c), a bare
+  *             trace of a given shape or UI shapes, and
+  *             reports the average LCD bus traffic per frame: register
+  *             selects, CPU data writes, DMA writes, reads and HCLK cycles
+  *             (see FSMC_LCD_WRITE_CYCLES), and the host CPU time per frame,
+  *             which includes the simulator's work. Traces are synthetic but
+  *             deterministic, so runs are comparable. The last frame of each
+  *             scene is written to <prefix><scene>.ppm.
+  *             Shape scenes clear their area before each frame, outside the
+  *             measurement. Their *_px twins draw the same shapes the way the
+  *             driver did before runs were batched: lines and outlines pixel
+  *             by pixel through the cursor, discs row by row with
+  *             LCD_DrawHLine(), overlapping rows drawn again. Both must give
+  *             the same frames.
+  *             The cursor scene moves an XOR crosshair over the sine8 trace.
+  *             Before each frame, the vertical line is toggled off and on
+  *             again and CurveChart_ReadPixel() must see the pixels inverted.
+  *             Exits with 1 when a CPU access hits the bus while a DMA transfer
+  *             is pending or a cursor pixel reads back wrong.
+  ******************************************************************************
+  */
+
+#include "lcd_sim.h"
+#include "lcd.h"
+#include "nt35510.h"
+#include "curve_chart.h"
+#include "text_label.h"
+#include "colors.h"
+#include "pattern.h"
+/* Tag tables in oscilloscope.h point const uint8_t at string literals */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpointer-sign"
+#include "oscilloscope.h"
+#pragma GCC diagnostic pop
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_FRAMES      64
+#define LABEL_PERIOD        8       //Frames between label updates, ~200ms in oscilloscope.c
+
+#define PI                  3.14159265f
+
+#define SHAPES_X            400     //Center of the shape scenes
+#define SHAPES_Y            240
+
+typedef struct
+{
+    const char *Name;
+    void (*Init)(void);
+    void (*PrepareFrame)(uint32_t frame);     //Not measured, may be NULL
+    void (*DrawFrame)(uint32_t frame);
+
+} Scene;
+
+static CurveChartTypeDef s_chart;
+static uint16_t s_values[GRID_WIDTH];
+static TextLabelTypeDef s_labels[3];
+static uint32_t s_seed;
+
+/* XOR crosshair of the cursor scene, column and height from chart bottom */
+static uint16_t s_cursor_x, s_cursor_y;
+static uint32_t s_cursor_errors;
+
+/* Fixed LCG so every run draws the same frames */
+static int16_t Noise(int16_t amplitude)
+{
+    s_seed = s_seed * 1103515245U + 12345U;
+    return (int16_t)((s_seed >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+static uint16_t ClampRow(int32_t y)
+{
+    return (y < 0) ? 0 : (y >= GRID_HEIGHT) ? GRID_HEIGHT - 1 : y;
+}
+
+static void InitChart(void)
+{
+    LCD_Clear(BLACK);
+
+    s_chart.X = GRID_X;
+    s_chart.Y = GRID_Y;
+    s_chart.Width = GRID_WIDTH;
+    s_chart.Height = GRID_HEIGHT;
+    s_chart.CoarseGridWidth = 100;
+    s_chart.CoarseGridHeight = 50;
+    s_chart.FineGridWidth = 10;
+    s_chart.FineGridHeight = 10;
+    s_chart.BorderColor = WHITE;
+    s_chart.BackgroudColor = BLACK;
+    s_chart.CoarseGridColor = GRAY;
+    s_chart.FineGridColor = DARKGRAY;
+    CurveChart_Init(&s_chart);
+
+    memset(s_values, 0, sizeof(s_values));
+    s_seed = 1;
+}
+
+static void FinishChartFrame(void)
+{
+#if CHART_USE_FRAMEBUFFER
+    CurveChart_FrameUpdate();
+#endif // CHART_USE_FRAMEBUFFER
+}
+
+/* Oscilloscope: 2.5 periods of a drifting sine with ADC noise, 3 measurement labels */
+static void InitOscilloscope(void)
+{
+    InitChart();
+
+    TextLabel_Init(&s_labels[0], GRID_X + 64, GRID_Y + GRID_HEIGHT + 16, 108, 24, PURPLE, BLACK);
+    TextLabel_Init(&s_labels[1], GRID_X + 280, GRID_Y + GRID_HEIGHT + 16, 108, 24, PURPLE, BLACK);
+    TextLabel_Init(&s_labels[2], GRID_X + 472, GRID_Y + GRID_HEIGHT + 16, 108, 24, PURPLE, BLACK);
+
+    LCD_DrawRect(TIMEBOX_X, TIMEBOX_Y, TIMEBOX_WIDTH, TIMEBOX_HEIGHT, WHITE);
+    LCD_DrawString(time_base_tag[DIV_1ms], 24, TIMEBOX_X + 36, TIMEBOX_Y + 36, YELLOW);
+    LCD_DrawRect(VOLTBOX_X, VOLTBOX_Y, VOLTBOX_WIDTH, VOLTBOX_HEIGHT, WHITE);
+    LCD_DrawString(volt_base_tag[DIV_1V], 24, VOLTBOX_X + 48, VOLTBOX_Y + 36, YELLOW);
+    LCD_DrawSprite(&down_triangle_sprite, GRID_X + GRID_WIDTH / 2 - 5, GRID_Y - 12);
+    LCD_DrawSprite(&right_triangle_sprite, GRID_X - 12, GRID_Y + GRID_HEIGHT / 2 - 5);
+}
+
+static void DrawOscilloscopeFrame(uint32_t frame)
+{
+    uint8_t str_buffer[16];
+
+    CurveChart_RecoverGrid(&s_chart, s_values);
+
+    for (uint16_t i = 0; i < GRID_WIDTH; i++) {
+        float phase = 2.0f * PI * (i * 2.5f / GRID_WIDTH + frame * 0.013f);
+        s_values[i] = ClampRow(GRID_HEIGHT / 2 + 150.0f * sinf(phase) + Noise(2));
+    }
+
+    CurveChart_DrawCurve(&s_chart, s_values, RED);
+
+    if (frame % LABEL_PERIOD == 0) {
+        sprintf((char *)str_buffer, "%.2fHz", 1000.0f + frame * 0.37f);
+        TextLabel_Update(&s_labels[0], str_buffer);
+        sprintf((char *)str_buffer, "%.1fmA", 612.0f + Noise(20) * 0.1f);
+        TextLabel_Update(&s_labels[1], str_buffer);
+        sprintf((char *)str_buffer, "%.2fmA", 216.4f + Noise(20) * 0.05f);
+        TextLabel_Update(&s_labels[2], str_buffer);
+    }
+
+    FinishChartFrame();
+}
+
+/* Spectrum: harmonic peaks over a noise floor and the cursor marker */
+static void InitSpectrum(void)
+{
+    InitChart();
+}
+
+static void DrawSpectrumFrame(uint32_t frame)
+{
+    static const float harmonics[] = { 320.0f, 150.0f, 96.0f, 60.0f, 44.0f, 30.0f, 22.0f, 15.0f, 10.0f };
+    const uint16_t cursor_pos = GRID_WIDTH / 2;
+
+    CurveChart_RecoverGrid(&s_chart, s_values);
+    CurveChart_RecoverRect(&s_chart, cursor_pos - 5, s_values[cursor_pos] + 16, 11, 11);
+
+    for (uint16_t i = 0; i < GRID_WIDTH; i++) {
+        float value = 12.0f + Noise(6);
+        for (uint8_t h = 0; h < sizeof(harmonics) / sizeof(harmonics[0]); h++) {
+            float d = (i - 60.0f * (h + 1) - (frame & 0x03)) / 2.5f;
+            value += harmonics[h] / (1.0f + d * d);
+        }
+        s_values[i] = ClampRow(value);
+    }
+
+    CurveChart_DrawCurve(&s_chart, s_values, YELLOW);
+    CurveChart_DrawSprite(&s_chart, cursor_pos - 5, s_values[cursor_pos] + 16, &down_triangle_sprite);
+
+    FinishChartFrame();
+}
+
+/* Bare traces: erase and redraw only, by segment length */
+static void InitTrace(void)
+{
+    InitChart();
+}
+
+static void DrawTraceFrame(uint16_t (*value)(uint16_t i, uint32_t frame), uint32_t frame)
+{
+    CurveChart_RecoverGrid(&s_chart, s_values);
+    for (uint16_t i = 0; i < GRID_WIDTH; i++) {
+        s_values[i] = value(i, frame);
+    }
+    CurveChart_DrawCurve(&s_chart, s_values, RED);
+
+    FinishChartFrame();
+}
+
+static uint16_t FlatValue(uint16_t i, uint32_t frame)
+{
+    (void)i;
+    return GRID_HEIGHT / 2 + frame % 5;
+}
+
+/* 8 periods of 150 rows amplitude, segments average 8 pixels */
+static uint16_t SineValue(uint16_t i, uint32_t frame)
+{
+    return ClampRow(GRID_HEIGHT / 2 + 150.0f * sinf(2.0f * PI * (i * 8.0f / GRID_WIDTH + frame * 0.013f)));
+}
+
+/* Alternating rows, every segment is 1 pixel */
+static uint16_t ZigzagValue(uint16_t i, uint32_t frame)
+{
+    return GRID_HEIGHT / 2 + ((i + frame) & 0x01);
+}
+
+static void DrawFlatFrame(uint32_t frame)
+{
+    DrawTraceFrame(FlatValue, frame);
+}
+
+static void DrawSineFrame(uint32_t frame)
+{
+    DrawTraceFrame(SineValue, frame);
+}
+
+static void DrawZigzagFrame(uint32_t frame)
+{
+    DrawTraceFrame(ZigzagValue, frame);
+}
+
+/* Erases the same sine8 trace every frame, nothing is drawn after the first */
+static void DrawEraseFrame(uint32_t frame)
+{
+    if (frame == 0) {
+        DrawTraceFrame(SineValue, frame);
+        return;
+    }
+    CurveChart_RecoverGrid(&s_chart, s_values);
+
+    FinishChartFrame();
+}
+
+/* Cursor: XOR crosshair over sine8, taken off before the trace is erased */
+static void InitCursor(void)
+{
+    InitChart();
+    s_cursor_errors = 0;
+}
+
+static void CheckCursor(uint32_t frame)
+{
+    uint16_t row = (s_cursor_x * 3) % GRID_HEIGHT;
+
+    if (frame == 0 || row == GRID_HEIGHT - s_cursor_y) {
+        return;
+    }
+
+    /* Off and on again, the pixel must read back inverted */
+    CurveChart_XorLineX(&s_chart, s_cursor_x);
+    uint16_t under = CurveChart_ReadPixel(&s_chart, s_cursor_x, row);
+    CurveChart_XorLineX(&s_chart, s_cursor_x);
+
+    if (CurveChart_ReadPixel(&s_chart, s_cursor_x, row) != (uint16_t)~under) {
+        ++s_cursor_errors;
+    }
+}
+
+static void DrawCursorFrame(uint32_t frame)
+{
+    if (frame > 0) {
+        CurveChart_XorLineX(&s_chart, s_cursor_x);
+        CurveChart_XorLineY(&s_chart, s_cursor_y);
+    }
+
+    CurveChart_RecoverGrid(&s_chart, s_values);
+    for (uint16_t i = 0; i < GRID_WIDTH; i++) {
+        s_values[i] = SineValue(i, frame);
+    }
+    CurveChart_DrawCurve(&s_chart, s_values, RED);
+
+    s_cursor_x = (frame * 7) % GRID_WIDTH;
+    s_cursor_y = 1 + (frame * 5) % GRID_HEIGHT;
+    CurveChart_XorLineX(&s_chart, s_cursor_x);
+    CurveChart_XorLineY(&s_chart, s_cursor_y);
+
+    FinishChartFrame();
+}
+
+/* UI shapes: lines at every octant, outlined and filled circles */
+static void InitShapes(void)
+{
+    LCD_Clear(BLACK);
+}
+
+static void ClearShapes(uint32_t frame)
+{
+    (void)frame;
+    LCD_FillRect(SHAPES_X - 200, SHAPES_Y - 200, 400, 400, BLACK);
+}
+
+/* Per-pixel line, as LCD_DrawLine() was before runs */
+static void PixelLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color)
+{
+    uint16_t temp;
+    _Bool is_steep = (abs(y1 - y0) > abs(x1 - x0));
+
+    if (is_steep) {
+        temp = x0; x0 = y0; y0 = temp;
+        temp = x1; x1 = y1; y1 = temp;
+    }
+    if (x0 > x1) {
+        temp = x0; x0 = x1; x1 = temp;
+        temp = y0; y0 = y1; y1 = temp;
+    }
+
+    int16_t dx = x1 - x0;
+    int16_t dy = abs(y1 - y0);
+    int16_t err = dx / 2;
+    int16_t y_step = (y0 < y1) ? 1 : -1;
+
+    for (int16_t x = x0, y = y0; x <= x1; x++) {
+        if (is_steep) {
+            WRITE_PIXEL(y, x, color);
+        }
+        else {
+            WRITE_PIXEL(x, y, color);
+        }
+
+        err -= dy;
+        if (err < 0) {
+            y += y_step;
+            err += dx;
+        }
+    }
+}
+
+/* Per-pixel circle, as LCD_DrawCircle() was before runs */
+static void PixelCircle(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color)
+{
+    int16_t x = 0;
+    int16_t y = radius;
+    int16_t di = 3 - radius / 2;
+
+    while (x <= y)
+    {
+        WRITE_PIXEL(x0 + x, y0 - y, color);
+        WRITE_PIXEL(x0 + y, y0 - x, color);
+        WRITE_PIXEL(x0 + y, y0 + x, color);
+        WRITE_PIXEL(x0 + x, y0 + y, color);
+        WRITE_PIXEL(x0 - x, y0 + y, color);
+        WRITE_PIXEL(x0 - y, y0 + x, color);
+        WRITE_PIXEL(x0 - x, y0 - y, color);
+        WRITE_PIXEL(x0 - y, y0 - x, color);
+        x++;
+
+        if (di < 0) {
+            di += 4 * x + 6;
+        }
+        else {
+            di += 10 + 4 * (x - y);
+            y--;
+        }
+    }
+}
+
+/* Disc of rows, as LCD_FillCircle() was before spans, with full width rows */
+static void RowDisc(uint16_t x0, uint16_t y0, uint8_t radius, uint16_t color)
+{
+    int16_t x = 0;
+    int16_t y = radius;
+    int16_t di = 3 - radius / 2;
+
+    while (x <= y)
+    {
+        LCD_DrawHLine(x0 - y, y0 + x, 2 * y + 1, color);
+        LCD_DrawHLine(x0 - y, y0 - x, 2 * y + 1, color);
+        LCD_DrawHLine(x0 - x, y0 - y, 2 * x + 1, color);
+        LCD_DrawHLine(x0 - x, y0 + y, 2 * x + 1, color);
+        x++;
+
+        if (di < 0) {
+            di += 4 * x + 6;
+        }
+        else {
+            di += 10 + 4 * (x - y);
+            y--;
+        }
+    }
+}
+
+static void DrawLines(uint32_t frame, void (*draw_line)(uint16_t, uint16_t, uint16_t, uint16_t, uint16_t))
+{
+    for (uint8_t i = 0; i < 16; i++) {
+        float angle = 2.0f * PI * (i / 16.0f + frame * 0.004f);
+        draw_line(SHAPES_X, SHAPES_Y, SHAPES_X + 190.0f * cosf(angle), SHAPES_Y + 190.0f * sinf(angle), CYAN);
+    }
+    /* Crossing the right and bottom screen edges */
+    draw_line(700, 300 + (frame & 0x0F), 900, 560, CYAN);
+    draw_line(620 + (frame & 0x0F), 400, 700, 600, CYAN);
+}
+
+static void DrawCircles(uint32_t frame, void (*draw_circle)(uint16_t, uint16_t, uint8_t, uint16_t))
+{
+    for (uint8_t r = 20; r <= 120; r += 25) {
+        draw_circle(SHAPES_X, SHAPES_Y, r + (frame & 0x07), YELLOW);
+    }
+    /* Crossing the screen edges */
+    draw_circle(20, 30, 40 + (frame & 0x07), YELLOW);
+    draw_circle(780, 460, 50, YELLOW);
+}
+
+static void DrawDiscs(uint32_t frame, void (*fill_circle)(uint16_t, uint16_t, uint8_t, uint16_t))
+{
+    fill_circle(SHAPES_X - 140, SHAPES_Y + 140, 40, RED);
+    fill_circle(SHAPES_X + 140, SHAPES_Y - 140, 24 + (frame & 0x0F), GREEN);
+}
+
+static void DrawLinesFrame(uint32_t frame)
+{
+    DrawLines(frame, LCD_DrawLine);
+}
+
+static void DrawPixelLinesFrame(uint32_t frame)
+{
+    DrawLines(frame, PixelLine);
+}
+
+static void DrawCirclesFrame(uint32_t frame)
+{
+    DrawCircles(frame, LCD_DrawCircle);
+}
+
+static void DrawPixelCirclesFrame(uint32_t frame)
+{
+    DrawCircles(frame, PixelCircle);
+}
+
+static void DrawDiscsFrame(uint32_t frame)
+{
+    DrawDiscs(frame, LCD_FillCircle);
+}
+
+static void DrawRowDiscsFrame(uint32_t frame)
+{
+    DrawDiscs(frame, RowDisc);
+}
+
+static void AddStats(LCDSim_StatsTypeDef *total, const LCDSim_StatsTypeDef *stats)
+{
+    total->RegSelects += stats->RegSelects;
+    total->DataWrites += stats->DataWrites;
+    total->DmaWrites += stats->DmaWrites;
+    total->DataReads += stats->DataReads;
+    total->Conflicts += stats->Conflicts;
+    total->PixelWrites += stats->PixelWrites;
+}
+
+static const Scene s_scenes[] = {
+    { "osc", InitOscilloscope, NULL, DrawOscilloscopeFrame },
+    { "spectrum", InitSpectrum, NULL, DrawSpectrumFrame },
+    { "flat", InitTrace, NULL, DrawFlatFrame },
+    { "sine8", InitTrace, NULL, DrawSineFrame },
+    { "zigzag", InitTrace, NULL, DrawZigzagFrame },
+    { "erase", InitTrace, NULL, DrawEraseFrame },
+    { "cursor", InitCursor, CheckCursor, DrawCursorFrame },
+    { "lines", InitShapes, ClearShapes, DrawLinesFrame },
+    { "lines_px", InitShapes, ClearShapes, DrawPixelLinesFrame },
+    { "circles", InitShapes, ClearShapes, DrawCirclesFrame },
+    { "circles_px", InitShapes, ClearShapes, DrawPixelCirclesFrame },
+    { "discs", InitShapes, ClearShapes, DrawDiscsFrame },
+    { "discs_px", InitShapes, ClearShapes, DrawRowDiscsFrame },
+};
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_FRAMES;
+    const char *prefix = (argc > 2) ? argv[2] : "";
+    uint32_t failures = 0;
+
+    if (frames == 0) {
+        fprintf(stderr, "Usage: %s [frames] [ppm prefix]\n", argv[0]);
+        return 2;
+    }
+
+#if CHART_USE_FRAMEBUFFER && CHART_FRAMEBUFFER_INDEX_BITS
+    printf("chart: %u-bit indexed framebuffer, %u frames per scene\n", CHART_FRAMEBUFFER_INDEX_BITS, frames);
+#elif CHART_USE_FRAMEBUFFER
+    printf("chart: framebuffer, %u frames per scene\n", frames);
+#elif CHART_USE_SHADOW
+    printf("chart: direct with shadow, %u frames per scene\n", frames);
+#else
+    printf("chart: direct, %u frames per scene\n", frames);
+#endif // CHART_USE_FRAMEBUFFER
+    printf("%-10s %10s %10s %10s %10s %12s %10s\n", "scene", "cmd", "write", "dma", "read", "cycles", "host ns");
+
+    for (uint8_t i = 0; i < sizeof(s_scenes) / sizeof(s_scenes[0]); i++)
+    {
+        const Scene *scene = &s_scenes[i];
+        LCDSim_StatsTypeDef stats = { 0 }, frame_stats;
+        unsigned long long elapsed_ns = 0;
+        char path[256];
+
+        LCDSim_Init();
+        LCD_Init(LCD_ORIENTATION_90_DEGREE);
+        scene->Init();
+
+        /* First frame also erases nothing, keep it out of the average */
+        for (uint32_t frame = 0; frame <= frames; frame++)
+        {
+            struct timespec start, end;
+
+            if (scene->PrepareFrame != NULL) {
+                scene->PrepareFrame(frame);
+                LCDSim_RunDma();
+                LCDSim_GetStats(&frame_stats);
+                stats.Conflicts += frame_stats.Conflicts;
+            }
+            LCDSim_ResetStats();
+
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+            scene->DrawFrame(frame);
+            LCDSim_RunDma();
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+            if (frame > 0) {
+                LCDSim_GetStats(&frame_stats);
+                AddStats(&stats, &frame_stats);
+                elapsed_ns += (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+            }
+        }
+
+        printf("%-10s %10u %10u %10u %10u %12u %10llu\n", scene->Name,
+               stats.RegSelects / frames, stats.DataWrites / frames, stats.DmaWrites / frames,
+               stats.DataReads / frames, LCDSim_GetBusCycles(&stats) / frames, elapsed_ns / frames);
+        if (stats.Conflicts) {
+            printf("%-10s %u bus conflicts\n", scene->Name, stats.Conflicts);
+        }
+        failures += stats.Conflicts;
+        if (s_cursor_errors) {
+            printf("%-10s %u cursor pixels read back wrong\n", scene->Name, s_cursor_errors);
+            failures += s_cursor_errors;
+            s_cursor_errors = 0;
+        }
+
+        snprintf(path, sizeof(path), "%s%s.ppm", prefix, scene->Name);
+        if (LCDSim_DumpPPM(path) != 0) {
+            fprintf(stderr, "Can't write %s\n", path);
+            return 1;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
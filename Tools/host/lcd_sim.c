@@ -0,0 +1,474 @@
+/**
+  ******************************************************************************
+  * @file       lcd_sim.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Simulated NT35510 panel, FSMC SRAM and memory-to-memory DMA
+  *             for host builds of the LCD modules
+  *
+  * @note       See lcd_sim.h. Also provides the HAL tick, GPIO and DMA calls
+  *             and hdma_m2m, which live in the target's HAL and dma.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "lcd_sim.h"
+#include "fsmc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* Private Marcos ------------------------------------------------------------*/
+#define REG_COLUMN_START_HI         0x2A00
+#define REG_COLUMN_START_LO         0x2A01
+#define REG_COLUMN_END_HI           0x2A02
+#define REG_COLUMN_END_LO           0x2A03
+#define REG_PAGE_START_HI           0x2B00
+#define REG_PAGE_START_LO           0x2B01
+#define REG_PAGE_END_HI             0x2B02
+#define REG_PAGE_END_LO             0x2B03
+#define REG_WRITE_GRAM              0x2C00
+#define REG_READ_GRAM               0x2E00
+#define REG_MADCTL                  0x3600
+#define REG_ID_LO                   0xDA00
+#define REG_ID_HI                   0xDB00
+
+#define MADCTL_MV                   0x20
+
+#define DRIVER_ID                   0x8000          //NT35510, see lcd.h
+
+#define SET_HI(VAR, DATA)           ((VAR) = ((VAR) & 0x00FF) | (((DATA) & 0xFF) << 8))
+#define SET_LO(VAR, DATA)           ((VAR) = ((VAR) & 0xFF00) | ((DATA) & 0xFF))
+
+/* Private Types -------------------------------------------------------------*/
+typedef struct
+{
+    DMA_HandleTypeDef *Handle;
+    uint32_t SrcAddr;
+    uint32_t DstAddr;
+    uint32_t Length;            //Words
+    uint8_t SrcInc;
+    uint8_t DstInc;
+    uint8_t Interrupt;
+
+} LCDSim_DmaJobTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t s_gram[LCD_SIM_NATIVE_WIDTH * LCD_SIM_NATIVE_HEIGHT];
+static uint16_t s_width = LCD_SIM_NATIVE_WIDTH;
+static uint16_t s_height = LCD_SIM_NATIVE_HEIGHT;
+
+static uint16_t s_reg;
+static uint16_t s_column_start, s_column_end;
+static uint16_t s_page_start, s_page_end;
+static uint16_t s_x, s_y;
+
+/* GRAM read back streams R, G, B bytes, two per bus read */
+static uint8_t s_read_dummy;
+static uint8_t s_read_component;
+
+static LCDSim_StatsTypeDef s_stats;
+
+static LCDSim_DmaJobTypeDef s_dma_job;
+static uint8_t s_is_dma_pending;
+static uint8_t s_is_dma_running;
+
+static uint32_t s_tick;
+
+/* Public variables ----------------------------------------------------------*/
+static DMA_Stream_TypeDef s_dma_stream = { DMA_SxCR_PINC };
+DMA_HandleTypeDef hdma_m2m = { &s_dma_stream, NULL, NULL };
+GPIO_TypeDef host_gpiob;
+
+/* Private Function Prototypes -----------------------------------------------*/
+static void LCDSim_WritePixel(uint16_t color);
+static uint8_t LCDSim_ReadByte(void);
+static void LCDSim_CheckBus(void);
+static HAL_StatusTypeDef LCDSim_StartDma(DMA_HandleTypeDef *hdma, uint32_t src_addr, uint32_t dst_addr,
+                                         uint32_t length, uint8_t interrupt);
+
+/* Public Function Definitions -----------------------------------------------*/
+
+/**
+  * @brief  Maps the external SRAM and resets the panel
+  * @note   Exits when the SRAM address range is taken
+  * @retval None
+  */
+void LCDSim_Init(void)
+{
+    static void *sram;
+
+    if (sram == NULL)
+    {
+        sram = mmap((void *)(uintptr_t)FSMC_SRAM_BASE_ADDR, LCD_SIM_SRAM_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (sram != (void *)(uintptr_t)FSMC_SRAM_BASE_ADDR) {
+            fprintf(stderr, "lcd_sim: can't map SRAM at 0x%08X\n", FSMC_SRAM_BASE_ADDR);
+            exit(EXIT_FAILURE);
+        }
+    }
+    memset(sram, 0, LCD_SIM_SRAM_SIZE);
+    memset(s_gram, 0, sizeof(s_gram));
+
+    s_width = LCD_SIM_NATIVE_WIDTH;
+    s_height = LCD_SIM_NATIVE_HEIGHT;
+    s_column_start = s_page_start = 0;
+    s_column_end = s_width - 1;
+    s_page_end = s_height - 1;
+    s_x = s_y = 0;
+    s_reg = 0;
+
+    s_is_dma_pending = 0;
+    LCDSim_ResetStats();
+}
+
+/**
+  * @brief  Register select (command) write
+  * @param  reg: Register address
+  * @retval None
+  */
+void LCDSim_WriteReg(uint16_t reg)
+{
+    LCDSim_CheckBus();
+    s_stats.RegSelects++;
+    s_reg = reg;
+
+    if (reg == REG_WRITE_GRAM || reg == REG_READ_GRAM) {
+        s_x = s_column_start;
+        s_y = s_page_start;
+        s_read_dummy = 1;
+        s_read_component = 0;
+    }
+}
+
+/**
+  * @brief  Data write by CPU
+  * @param  data: Data to write
+  * @retval None
+  */
+void LCDSim_WriteData(uint16_t data)
+{
+    LCDSim_CheckBus();
+    s_stats.DataWrites++;
+
+    switch (s_reg)
+    {
+        case REG_COLUMN_START_HI: SET_HI(s_column_start, data); break;
+        case REG_COLUMN_START_LO: SET_LO(s_column_start, data); break;
+        case REG_COLUMN_END_HI: SET_HI(s_column_end, data); break;
+        case REG_COLUMN_END_LO: SET_LO(s_column_end, data); break;
+        case REG_PAGE_START_HI: SET_HI(s_page_start, data); break;
+        case REG_PAGE_START_LO: SET_LO(s_page_start, data); break;
+        case REG_PAGE_END_HI: SET_HI(s_page_end, data); break;
+        case REG_PAGE_END_LO: SET_LO(s_page_end, data); break;
+
+        case REG_WRITE_GRAM:
+            LCDSim_WritePixel(data);
+            break;
+
+        case REG_MADCTL:
+            s_width = (data & MADCTL_MV) ? LCD_SIM_NATIVE_HEIGHT : LCD_SIM_NATIVE_WIDTH;
+            s_height = (data & MADCTL_MV) ? LCD_SIM_NATIVE_WIDTH : LCD_SIM_NATIVE_HEIGHT;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+  * @brief  Data read by CPU
+  * @retval Data from the selected register, GRAM bytes after READ_GRAM
+  */
+uint16_t LCDSim_ReadData(void)
+{
+    LCDSim_CheckBus();
+    s_stats.DataReads++;
+
+    switch (s_reg)
+    {
+        case REG_READ_GRAM:
+            if (s_read_dummy) {
+                s_read_dummy = 0;
+                return 0;
+            }
+            else {
+                uint16_t hi = LCDSim_ReadByte();
+                return (hi << 8) | LCDSim_ReadByte();
+            }
+
+        case REG_ID_LO:
+            return DRIVER_ID & 0xFF;
+
+        case REG_ID_HI:
+            return DRIVER_ID >> 8;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+  * @brief  Runs pending DMA transfers, including ones started from their
+  *         transfer complete callbacks
+  * @retval None
+  */
+void LCDSim_RunDma(void)
+{
+    if (s_is_dma_running) {
+        return;
+    }
+    s_is_dma_running = 1;
+
+    while (s_is_dma_pending)
+    {
+        LCDSim_DmaJobTypeDef job = s_dma_job;
+
+        for (uint32_t i = 0; i < job.Length; i++)
+        {
+            uint32_t word = *(__IO uint32_t *)(uintptr_t)job.SrcAddr;
+
+            if (job.DstAddr == FSMC_LCD_DATA_ADDR) {
+                /* 32-bit access to the 16-bit bank goes out low half first */
+                s_stats.DmaWrites += 2;
+                if (s_reg == REG_WRITE_GRAM) {
+                    LCDSim_WritePixel(word & 0xFFFF);
+                    LCDSim_WritePixel(word >> 16);
+                }
+            }
+            else {
+                *(__IO uint32_t *)(uintptr_t)job.DstAddr = word;
+            }
+
+            job.SrcAddr += job.SrcInc ? 4 : 0;
+            job.DstAddr += job.DstInc ? 4 : 0;
+        }
+
+        /* Stream is free again when the callback runs, it may start the next one */
+        s_is_dma_pending = 0;
+        if (job.Interrupt && job.Handle->XferCpltCallback != NULL) {
+            job.Handle->XferCpltCallback(job.Handle);
+        }
+    }
+
+    s_is_dma_running = 0;
+}
+
+/**
+  * @brief  Clears bus counters
+  * @retval None
+  */
+void LCDSim_ResetStats(void)
+{
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+/**
+  * @brief  Gets bus counters since the last reset
+  * @param  stats: Returns the counters
+  * @retval None
+  */
+void LCDSim_GetStats(LCDSim_StatsTypeDef *stats)
+{
+    *stats = s_stats;
+}
+
+/**
+  * @brief  Converts bus counters to HCLK cycles with the FSMC timing model
+  * @param  stats: Bus counters
+  * @retval Bus cycles
+  */
+uint32_t LCDSim_GetBusCycles(const LCDSim_StatsTypeDef *stats)
+{
+    return (stats->RegSelects + stats->DataWrites + stats->DmaWrites) * FSMC_LCD_WRITE_CYCLES
+        + stats->DataReads * FSMC_LCD_READ_CYCLES;
+}
+
+uint16_t LCDSim_GetWidth(void)
+{
+    return s_width;
+}
+
+uint16_t LCDSim_GetHeight(void)
+{
+    return s_height;
+}
+
+/**
+  * @brief  Reads a pixel without touching bus state or counters
+  * @param  x, y: Position in drawing coordinates
+  * @retval Pixel color (RGB565 format)
+  */
+uint16_t LCDSim_GetPixel(uint16_t x, uint16_t y)
+{
+    return s_gram[(uint32_t)s_width * y + x];
+}
+
+/**
+  * @brief  Writes the panel contents as a binary PPM image
+  * @param  path: Output file
+  * @retval 0 on success
+  */
+int LCDSim_DumpPPM(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", s_width, s_height);
+    for (uint32_t i = 0; i < (uint32_t)s_width * s_height; i++)
+    {
+        uint16_t color = s_gram[i];
+        uint8_t r = color >> 11, g = (color >> 5) & 0x3F, b = color & 0x1F;
+        uint8_t rgb[3] = { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+        fwrite(rgb, 1, 3, file);
+    }
+
+    return fclose(file);
+}
+
+/* HAL Function Definitions --------------------------------------------------*/
+
+/**
+  * @brief  Tick in ms, every call counts as 1ms of waiting
+  * @note   Waiting code polls this, so pending DMA transfers complete here
+  */
+uint32_t HAL_GetTick(void)
+{
+    LCDSim_RunDma();
+    return ++s_tick;
+}
+
+void HAL_Delay(uint32_t delay)
+{
+    LCDSim_RunDma();
+    s_tick += delay;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *gpio, GPIO_InitTypeDef *init)
+{
+    (void)gpio;
+    (void)init;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t src_addr, uint32_t dst_addr, uint32_t length)
+{
+    return LCDSim_StartDma(hdma, src_addr, dst_addr, length, 0);
+}
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t src_addr, uint32_t dst_addr, uint32_t length)
+{
+    return LCDSim_StartDma(hdma, src_addr, dst_addr, length, 1);
+}
+
+/**
+  * @brief  Drops the pending transfer without calling its callbacks
+  */
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+
+    s_is_dma_pending = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_PollForTransfer(DMA_HandleTypeDef *hdma, HAL_DMA_LevelCompleteTypeDef level, uint32_t timeout)
+{
+    (void)hdma;
+    (void)level;
+    (void)timeout;
+
+    LCDSim_RunDma();
+    return HAL_OK;
+}
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+  * @brief  Writes a pixel at the GRAM write position and advances it
+  * @note   The position wraps to the next row at the window's right edge and
+  *         back to the top at its bottom edge. Pixels off the panel are lost.
+  * @param  color: Pixel color (RGB565 format)
+  * @retval None
+  */
+static void LCDSim_WritePixel(uint16_t color)
+{
+    if (s_x < s_width && s_y < s_height) {
+        s_gram[(uint32_t)s_width * s_y + s_x] = color;
+    }
+    s_stats.PixelWrites++;
+
+    if (++s_x > s_column_end) {
+        s_x = s_column_start;
+        if (++s_y > s_page_end) {
+            s_y = s_page_start;
+        }
+    }
+}
+
+/**
+  * @brief  Takes the next byte of the GRAM read stream (R, G, B per pixel)
+  * @retval Color component in the upper bits of the byte
+  */
+static uint8_t LCDSim_ReadByte(void)
+{
+    uint16_t color = (s_x < s_width && s_y < s_height) ? s_gram[(uint32_t)s_width * s_y + s_x] : 0;
+    uint8_t byte;
+
+    switch (s_read_component)
+    {
+        case 0: byte = (color >> 11) << 3; break;
+        case 1: byte = ((color >> 5) & 0x3F) << 2; break;
+        default: byte = (color & 0x1F) << 3; break;
+    }
+
+    if (++s_read_component == 3)
+    {
+        s_read_component = 0;
+        if (++s_x > s_column_end) {
+            s_x = s_column_start;
+            if (++s_y > s_page_end) {
+                s_y = s_page_start;
+            }
+        }
+    }
+
+    return byte;
+}
+
+/**
+  * @brief  Counts a CPU bus access made while a DMA transfer is still pending
+  * @note   The access is not delayed, it lands ahead of the transfer's data
+  *         just as it would interleave with it on target
+  * @retval None
+  */
+static void LCDSim_CheckBus(void)
+{
+    if (s_is_dma_pending && !s_is_dma_running) {
+        s_stats.Conflicts++;
+    }
+}
+
+static HAL_StatusTypeDef LCDSim_StartDma(DMA_HandleTypeDef *hdma, uint32_t src_addr, uint32_t dst_addr,
+                                         uint32_t length, uint8_t interrupt)
+{
+    if (s_is_dma_pending) {
+        return HAL_BUSY;
+    }
+
+    /* Memory to memory mode, the peripheral port is the source */
+    s_dma_job.Handle = hdma;
+    s_dma_job.SrcAddr = src_addr;
+    s_dma_job.DstAddr = dst_addr;
+    s_dma_job.Length = length;
+    s_dma_job.SrcInc = (hdma->Instance->CR & DMA_SxCR_PINC) != 0;
+    s_dma_job.DstInc = (hdma->Instance->CR & DMA_SxCR_MINC) != 0;
+    s_dma_job.Interrupt = interrupt;
+    s_is_dma_pending = 1;
+
+    return HAL_OK;
+}
@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file       lcd_sim.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Simulated NT35510 panel, FSMC SRAM and memory-to-memory DMA
+  *             for host builds of the LCD modules
+  *
+  * @note       Modules built with FSMC_LCD_HOST send their LCD bus accesses
+  *             here (see fsmc.h). The panel keeps a virtual GRAM with the
+  *             window and write/read position, and decodes the column/page
+  *             address, GRAM write/read and MADCTL commands. Other registers
+  *             are accepted and ignored. MADCTL only swaps rows and columns,
+  *             mirroring is not modelled, so frames come out in drawing
+  *             coordinates.
+  *             External SRAM is mapped at FSMC_SRAM_BASE_ADDR, so modules can
+  *             keep using it through fixed addresses. Programs must be linked
+  *             without PIE, DMA addresses are kept in 32-bit variables.
+  *             DMA transfers started through the HAL calls run when the CPU
+  *             waits for them (HAL_GetTick, HAL_DMA_PollForTransfer), so a
+  *             buffer changed before the wait is sent changed, like on target.
+  *             A CPU access to the LCD bus while a transfer is still pending
+  *             is counted as a conflict.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define LCD_SIM_NATIVE_WIDTH        480
+#define LCD_SIM_NATIVE_HEIGHT       800
+
+#define LCD_SIM_SRAM_SIZE           0x00100000U     //1MB
+
+/* Public Types --------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t RegSelects;        //Command (register select) writes
+    uint32_t DataWrites;        //Data writes by CPU
+    uint32_t DmaWrites;         //Data writes by DMA, in 16-bit bus accesses
+    uint32_t DataReads;         //Data reads, including dummy reads
+    uint32_t Conflicts;         //CPU accesses while a DMA transfer was pending
+    uint32_t PixelWrites;       //GRAM pixels written by CPU or DMA
+
+} LCDSim_StatsTypeDef;
+
+/* Public Function Prototypes ------------------------------------------------*/
+void LCDSim_Init(void);
+
+void LCDSim_WriteReg(uint16_t reg);
+void LCDSim_WriteData(uint16_t data);
+uint16_t LCDSim_ReadData(void);
+
+void LCDSim_RunDma(void);
+
+void LCDSim_ResetStats(void);
+void LCDSim_GetStats(LCDSim_StatsTypeDef *stats);
+uint32_t LCDSim_GetBusCycles(const LCDSim_StatsTypeDef *stats);
+
+uint16_t LCDSim_GetWidth(void);
+uint16_t LCDSim_GetHeight(void);
+uint16_t LCDSim_GetPixel(uint16_t x, uint16_t y);
+int LCDSim_DumpPPM(const char *path);
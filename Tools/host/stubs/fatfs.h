@@ -0,0 +1,14 @@
+/**
+  ******************************************************************************
+  * @file       fatfs.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Stand-in for the CubeMX FatFs glue header in host builds
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include "ff.h"
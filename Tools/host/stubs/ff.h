@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file       ff.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Minimal stand-in for the FatFs header in host builds
+  *
+  * @note       Types, result codes and open mode flags keep the FatFs values.
+  *             Files are host files opened relative to the working directory,
+  *             see ff_host.c. Only the calls made by the modules built in
+  *             Tools/host are provided.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define FA_READ                     0x01
+#define FA_WRITE                    0x02
+#define FA_OPEN_EXISTING            0x00
+#define FA_CREATE_NEW               0x04
+#define FA_CREATE_ALWAYS            0x08
+#define FA_OPEN_ALWAYS              0x10
+
+/* Public Types --------------------------------------------------------------*/
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef char TCHAR;
+typedef DWORD FSIZE_t;
+
+typedef enum
+{
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+
+} FRESULT;
+
+typedef struct
+{
+    void *HostFile;             //stdio stream
+
+} FIL;
+
+/* Public Function Prototypes ------------------------------------------------*/
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file       stm32f4xx_hal.h
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.12
+  * @brief      Minimal stand-in for the STM32F4 HAL header in host builds
+  *
+  * @note       Only what the modules built in Tools/host need: HAL status,
+  *             integer types, and the GPIO, DMA and tick calls made by the LCD
+  *             modules. The DMA and tick functions are implemented by the LCD
+  *             simulator (lcd_sim.c), GPIO calls do nothing.
+  ******************************************************************************
+  */
+
+/* Preprocessor Directives ---------------------------------------------------*/
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public Marcos -------------------------------------------------------------*/
+#define __IO                        volatile
+
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) \
+                                    ((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+
+/* FSMC banks, same values as the HAL so address mapping in fsmc.h holds */
+#define FSMC_NORSRAM_BANK1          0x00000000U
+#define FSMC_NORSRAM_BANK2          0x00000002U
+#define FSMC_NORSRAM_BANK3          0x00000004U
+#define FSMC_NORSRAM_BANK4          0x00000006U
+
+/* GPIO */
+#define GPIO_PIN_15                 ((uint16_t)0x8000)
+#define GPIO_MODE_OUTPUT_PP         0x00000001U
+#define GPIO_PULLUP                 0x00000001U
+#define GPIO_SPEED_FREQ_LOW         0x00000000U
+#define GPIOB                       (&host_gpiob)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()
+
+/* DMA stream configuration bits used by the framebuffer */
+#define DMA_SxCR_PINC               (1U << 9)
+#define DMA_SxCR_MINC               (1U << 10)
+
+/* Public Types --------------------------------------------------------------*/
+typedef enum
+{
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+    __IO uint32_t BSRR;
+
+} GPIO_TypeDef;
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+
+} GPIO_InitTypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR;
+
+} DMA_Stream_TypeDef;
+
+typedef enum
+{
+    HAL_DMA_FULL_TRANSFER = 0x00U,
+    HAL_DMA_HALF_TRANSFER = 0x01U
+
+} HAL_DMA_LevelCompleteTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+    DMA_Stream_TypeDef *Instance;
+    void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    void (*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+
+} DMA_HandleTypeDef;
+
+/* Public variables ----------------------------------------------------------*/
+extern GPIO_TypeDef host_gpiob;
+
+/* Public Function Prototypes ------------------------------------------------*/
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+
+void HAL_GPIO_Init(GPIO_TypeDef *gpio, GPIO_InitTypeDef *init);
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t src_addr, uint32_t dst_addr, uint32_t length);
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t src_addr, uint32_t dst_addr, uint32_t length);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_PollForTransfer(DMA_HandleTypeDef *hdma, HAL_DMA_LevelCompleteTypeDef level, uint32_t timeout);
@@ -0,0 +1,247 @@
+/**
+  ******************************************************************************
+  * @file       sprite_converter.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.11
+  * @brief      Converts bitmaps into run-length encoded sprites (see sprite.h)
+  *
+  * @note       Build:  gcc -O2 -o sprite_converter sprite_converter.c
+  *             Usage:  sprite_converter <in.bmp> <name> [-t 0xRRRR] > out.h
+  *                     sprite_converter <in.bin> <name> -s WxH [-t 0xRRRR] > out.h
+  *
+  *             Input is a 16-bit (RGB565 bitfields) or 24/32-bit BMP, or with
+  *             -s a raw little-endian RGB565 stream as LCD_DrawBitmapStream()
+  *             takes. Pixels equal to the transparent color (-t, black by
+  *             default) are skipped. Output is a C header defining
+  *             <name>_data[] and the SpriteTypeDef <name>.
+  ******************************************************************************
+  */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SIZE            1024
+
+static uint16_t pixels[MAX_SIZE * MAX_SIZE];
+static uint16_t encoded[MAX_SIZE * MAX_SIZE * 2];
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t pack_rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+}
+
+static uint8_t *read_file(const char *path, long *size)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *buffer;
+
+    if (fp == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    buffer = malloc(*size > 0 ? *size : 1);
+    if (buffer == NULL || fread(buffer, 1, *size, fp) != (size_t)*size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(fp);
+        free(buffer);
+        return NULL;
+    }
+    fclose(fp);
+    return buffer;
+}
+
+static int load_raw(const uint8_t *file, long size, int width, int height)
+{
+    if (size < (long)width * height * 2) {
+        fprintf(stderr, "raw input holds %ld bytes, %dx%d needs %d\n", size, width, height, width * height * 2);
+        return -1;
+    }
+    for (int i = 0; i < width * height; i++) {
+        pixels[i] = get_le16(file + i * 2);
+    }
+    return 0;
+}
+
+static int load_bmp(const uint8_t *file, long size, int *width, int *height)
+{
+    if (size < 54 || file[0] != 'B' || file[1] != 'M') {
+        fprintf(stderr, "not a BMP file\n");
+        return -1;
+    }
+
+    uint32_t data_offset = get_le32(file + 10);
+    int32_t w = (int32_t)get_le32(file + 18);
+    int32_t h = (int32_t)get_le32(file + 22);
+    uint16_t bit_count = get_le16(file + 28);
+    uint32_t compression = get_le32(file + 30);
+    int bottom_up = (h > 0);
+
+    if (h < 0) {
+        h = -h;
+    }
+    if (w <= 0 || w > MAX_SIZE || h == 0 || h > MAX_SIZE) {
+        fprintf(stderr, "unsupported size %dx%d\n", w, h);
+        return -1;
+    }
+    if (!((bit_count == 16 && compression == 3) ||
+          ((bit_count == 24 || bit_count == 32) && compression == 0))) {
+        fprintf(stderr, "unsupported format: %u bpp, compression %u\n", bit_count, compression);
+        return -1;
+    }
+    if (bit_count == 16 && get_le32(file + 54) != 0xF800) {
+        fprintf(stderr, "16-bit BMP must use RGB565 bitfields\n");
+        return -1;
+    }
+
+    long stride = ((long)w * bit_count + 31) / 32 * 4;
+    if (data_offset + (unsigned long)(stride * h) > (unsigned long)size) {
+        fprintf(stderr, "BMP pixel data truncated\n");
+        return -1;
+    }
+
+    for (int y = 0; y < h; y++)
+    {
+        const uint8_t *row = file + data_offset + stride * (bottom_up ? h - 1 - y : y);
+
+        for (int x = 0; x < w; x++)
+        {
+            if (bit_count == 16) {
+                pixels[y * w + x] = get_le16(row + x * 2);
+            }
+            else {
+                const uint8_t *p = row + x * (bit_count / 8);
+                pixels[y * w + x] = pack_rgb565(p[2], p[1], p[0]);
+            }
+        }
+    }
+
+    *width = w;
+    *height = h;
+    return 0;
+}
+
+/* Returns number of words written to encoded[] */
+static size_t encode(int width, int height, uint16_t transparent)
+{
+    size_t n = 0;
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint16_t *row = pixels + y * width;
+        size_t count_pos = n++;
+        int runs = 0;
+        int x = 0, last_end = 0;
+
+        while (x < width)
+        {
+            if (row[x] == transparent) {
+                x++;
+                continue;
+            }
+
+            int start = x;
+            while (x < width && row[x] != transparent) {
+                x++;
+            }
+
+            encoded[n++] = start - last_end;
+            encoded[n++] = x - start;
+            memcpy(encoded + n, row + start, (x - start) * 2);
+            n += x - start;
+            last_end = x;
+            runs++;
+        }
+        encoded[count_pos] = runs;
+    }
+    return n;
+}
+
+static void print_header(const char *source, const char *name, int width, int height, uint16_t transparent, size_t n)
+{
+    size_t i = 0;
+
+    printf("/* Generated by sprite_converter from %s, do not edit\n", source);
+    printf(" * %dx%d, transparent 0x%04X, %zu bytes (raw %d bytes)\n */\n", width, height, transparent, n * 2, width * height * 2);
+    printf("static const uint16_t %s_data[] =\n{\n", name);
+
+    /* One line per row: run count, then each run */
+    for (int y = 0; y < height; y++)
+    {
+        uint16_t runs = encoded[i++];
+        printf("\t%u,", runs);
+        for (uint16_t r = 0; r < runs; r++)
+        {
+            uint16_t skip = encoded[i++];
+            uint16_t length = encoded[i++];
+            printf("  %u, %u,", skip, length);
+            for (uint16_t k = 0; k < length; k++) {
+                printf(" 0x%04X,", encoded[i++]);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("};\n\n");
+    printf("static const SpriteTypeDef %s = { %d, %d, %s_data };\n", name, width, height, name);
+}
+
+int main(int argc, char **argv)
+{
+    int width = 0, height = 0;
+    unsigned int transparent = 0x0000;
+    long size;
+    uint8_t *file;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <in.bmp|in.bin> <name> [-s WxH] [-t 0xRRRR]\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-s") == 0) {
+            if (sscanf(argv[i + 1], "%dx%d", &width, &height) != 2 ||
+                width <= 0 || width > MAX_SIZE || height <= 0 || height > MAX_SIZE) {
+                fprintf(stderr, "bad size %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-t") == 0) {
+            transparent = strtoul(argv[i + 1], NULL, 0) & 0xFFFF;
+        }
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    file = read_file(argv[1], &size);
+    if (file == NULL) {
+        return 1;
+    }
+
+    if ((width ? load_raw(file, size, width, height) : load_bmp(file, size, &width, &height)) != 0) {
+        free(file);
+        return 1;
+    }
+    free(file);
+
+    print_header(argv[1], argv[2], width, height, transparent, encode(width, height, transparent));
+    return 0;
+}
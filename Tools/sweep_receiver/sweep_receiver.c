@@ -0,0 +1,300 @@
+/**
+  ******************************************************************************
+  * @file       sweep_receiver.c
+  * @author     Weng Xiaoran, SICEIEC-UESTC
+  * @date       2019.3.8
+  * @brief      Linux receiver for the sweep export stream (see sweep_export.h)
+  *
+  * @note       Build:  gcc -O2 -o sweep_receiver sweep_receiver.c
+  *             Usage:  sweep_receiver <tty> [-c out.csv] [-b out.bin]
+  *
+  *             CSV columns: sweep,index,freq_hz,raw,gain_db,phase_deg
+  *             Binary records (16 bytes, little-endian): uint32 sweep,
+  *             uint16 index, uint32 freq_hz, uint16 raw, int16 gain (0.01dB),
+  *             int16 phase (0.01deg)
+  *
+  *             Throughput, CRC errors and sequence gaps are reported on
+  *             stderr once per second.
+  ******************************************************************************
+  */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SYNC_LO             0x5A
+#define SYNC_HI             0xA5
+#define HEADER_SIZE         8
+#define CRC_SIZE            4
+#define MAX_PAYLOAD         1024
+
+#define PACKET_BEGIN        0x01
+#define PACKET_POINTS       0x02
+#define PACKET_END          0x03
+
+#define POINT_SIZE          10
+
+typedef struct
+{
+    uint64_t Bytes;
+    uint64_t Packets;
+    uint64_t Points;
+    uint64_t CrcErrors;
+    uint64_t SequenceGaps;
+    uint64_t DeviceDropped;
+} Statistics;
+
+static volatile sig_atomic_t s_running = 1;
+
+static void OnSignal(int sig)
+{
+    (void)sig;
+    s_running = 0;
+}
+
+static uint32_t Crc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (length--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static uint16_t GetU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t GetU32(const uint8_t *p) { return GetU16(p) | ((uint32_t)GetU16(p + 2) << 16); }
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int OpenTty(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 1;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static void HandlePacket(const uint8_t *packet, uint16_t length, FILE *csv, FILE *bin, Statistics *stats)
+{
+    uint8_t type = packet[2];
+    const uint8_t *payload = packet + HEADER_SIZE;
+
+    switch (type)
+    {
+        case PACKET_BEGIN:
+            if (length >= 22) {
+                fprintf(stderr, "sweep %u: %u..%u Hz step %u, %u points, %u mV, %s\n",
+                        GetU32(payload), GetU32(payload + 4), GetU32(payload + 8), GetU32(payload + 12),
+                        GetU16(payload + 16), GetU16(payload + 18), payload[20] ? "vector" : "magnitude");
+            }
+            break;
+
+        case PACKET_POINTS:
+        {
+            if (length < 8) {
+                break;
+            }
+
+            uint32_t sweep = GetU32(payload);
+            uint16_t first = GetU16(payload + 4);
+            uint16_t count = GetU16(payload + 6);
+
+            if (8u + count * POINT_SIZE > length) {
+                break;
+            }
+
+            for (uint16_t i = 0; i < count; i++) {
+                const uint8_t *pt = payload + 8 + i * POINT_SIZE;
+                uint32_t freq = GetU32(pt);
+                uint16_t raw = GetU16(pt + 4);
+                int16_t gain = (int16_t)GetU16(pt + 6);
+                int16_t phase = (int16_t)GetU16(pt + 8);
+
+                if (csv) {
+                    fprintf(csv, "%u,%u,%u,%u,%.2f,%.2f\n", sweep, first + i, freq, raw, gain / 100.0, phase / 100.0);
+                }
+                if (bin) {
+                    uint8_t rec[16];
+                    uint16_t index = first + i;
+                    memcpy(rec + 0, &sweep, 4);     /* Host is little-endian */
+                    memcpy(rec + 4, &index, 2);
+                    memcpy(rec + 6, &freq, 4);
+                    memcpy(rec + 10, &raw, 2);
+                    memcpy(rec + 12, &gain, 2);
+                    memcpy(rec + 14, &phase, 2);
+                    fwrite(rec, sizeof(rec), 1, bin);
+                }
+            }
+            stats->Points += count;
+            break;
+        }
+
+        case PACKET_END:
+            if (length >= 8) {
+                stats->DeviceDropped += GetU16(payload + 6);
+                if (csv) {
+                    fflush(csv);
+                }
+                if (bin) {
+                    fflush(bin);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *tty = NULL;
+    FILE *csv = NULL, *bin = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            csv = fopen(argv[++i], "w");
+            if (!csv) {
+                perror(argv[i]);
+                return 1;
+            }
+            fprintf(csv, "sweep,index,freq_hz,raw,gain_db,phase_deg\n");
+        }
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            bin = fopen(argv[++i], "wb");
+            if (!bin) {
+                perror(argv[i]);
+                return 1;
+            }
+        }
+        else {
+            tty = argv[i];
+        }
+    }
+
+    if (!tty) {
+        fprintf(stderr, "usage: %s <tty> [-c out.csv] [-b out.bin]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = OpenTty(tty);
+    if (fd < 0) {
+        perror(tty);
+        return 1;
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    static uint8_t buffer[2 * (HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE)];
+    size_t fill = 0;
+    int have_sequence = 0;
+    uint16_t expected_sequence = 0;
+    Statistics stats = { 0 }, last = { 0 };
+    double t_start = Now(), t_report = t_start;
+
+    while (s_running)
+    {
+        ssize_t n = read(fd, buffer + fill, sizeof(buffer) - fill);
+        if (n < 0 && errno != EINTR && errno != EAGAIN) {
+            perror("read");
+            break;
+        }
+        if (n > 0) {
+            fill += n;
+            stats.Bytes += n;
+        }
+
+        /* Parse every complete packet in the buffer */
+        size_t pos = 0;
+        while (fill - pos >= HEADER_SIZE)
+        {
+            if (buffer[pos] != SYNC_LO || buffer[pos + 1] != SYNC_HI) {
+                ++pos;
+                continue;
+            }
+
+            uint16_t length = GetU16(buffer + pos + 6);
+            if (length > MAX_PAYLOAD) {
+                ++pos;
+                continue;
+            }
+
+            size_t total = HEADER_SIZE + length + CRC_SIZE;
+            if (fill - pos < total) {
+                break;
+            }
+
+            const uint8_t *packet = buffer + pos;
+            if (Crc32(packet + 2, HEADER_SIZE + length - 2) != GetU32(packet + HEADER_SIZE + length)) {
+                ++stats.CrcErrors;
+                ++pos;
+                continue;
+            }
+
+            uint16_t sequence = GetU16(packet + 4);
+            if (have_sequence && sequence != expected_sequence) {
+                stats.SequenceGaps += (uint16_t)(sequence - expected_sequence);
+            }
+            expected_sequence = sequence + 1;
+            have_sequence = 1;
+
+            ++stats.Packets;
+            HandlePacket(packet, length, csv, bin, &stats);
+            pos += total;
+        }
+
+        memmove(buffer, buffer + pos, fill - pos);
+        fill -= pos;
+
+        double t = Now();
+        if (t - t_report >= 1.0) {
+            double dt = t - t_report;
+            fprintf(stderr, "%.1f kB/s, %.0f points/s, packets %llu, crc errors %llu, lost %llu (device dropped %llu)\n",
+                    (stats.Bytes - last.Bytes) / dt / 1000.0, (stats.Points - last.Points) / dt,
+                    (unsigned long long)stats.Packets, (unsigned long long)stats.CrcErrors,
+                    (unsigned long long)stats.SequenceGaps, (unsigned long long)stats.DeviceDropped);
+            last = stats;
+            t_report = t;
+        }
+    }
+
+    double elapsed = Now() - t_start;
+    fprintf(stderr, "total %llu bytes in %.1f s (%.1f kB/s), %llu points\n",
+            (unsigned long long)stats.Bytes, elapsed, stats.Bytes / elapsed / 1000.0,
+            (unsigned long long)stats.Points);
+
+    if (csv) {
+        fclose(csv);
+    }
+    if (bin) {
+        fclose(bin);
+    }
+    close(fd);
+    return 0;
+}